@@ -0,0 +1,1834 @@
+/* LzmaEnc.c -- LZMA Encoder
+Encoder with the LZMA SDK interface, written for osu-replay to pair with
+LzmaDec.c. It follows the SDK encoder's design: a binary tree match finder
+(bt4) and a price driven optimal parser. Public domain, like the rest of
+this directory. */
+
+#include "Precomp.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "LzmaEnc.h"
+
+#define kNumTopBits 24
+#define kTopValue ((UInt32)1 << kNumTopBits)
+
+#define kNumBitModelTotalBits 11
+#define kBitModelTotal (1 << kNumBitModelTotalBits)
+#define kNumMoveBits 5
+#define kProbInitValue (kBitModelTotal >> 1)
+
+#define kNumMoveReducingBits 4
+#define kNumBitPriceShiftBits 4
+
+#define kNumStates 12
+#define kNumLitStates 7
+#define kNumReps 4
+
+#define kNumPosBitsMax 4
+#define kNumPosStatesMax (1 << kNumPosBitsMax)
+
+#define kNumLenToPosStates 4
+#define kNumPosSlotBits 6
+#define kDicLogSizeMax 32
+#define kDistTableSizeMax (kDicLogSizeMax * 2)
+#define kStartPosModelIndex 4
+#define kEndPosModelIndex 14
+#define kNumFullDistances (1 << (kEndPosModelIndex >> 1))
+#define kNumAlignBits 4
+#define kAlignTableSize (1 << kNumAlignBits)
+#define kAlignMask (kAlignTableSize - 1)
+
+#define kLenNumLowBits 3
+#define kLenNumLowSymbols (1 << kLenNumLowBits)
+#define kLenNumHighBits 8
+#define kLenNumHighSymbols (1 << kLenNumHighBits)
+#define kLenNumSymbolsTotal (kLenNumLowSymbols * 2 + kLenNumHighSymbols)
+
+#define kMatchMinLen 2
+#define kMatchMaxLen (kMatchMinLen + kLenNumSymbolsTotal - 1)
+
+#define kNumOpts (1 << 12)
+#define kInfinityPrice ((UInt32)1 << 30)
+
+#define kHash2Size ((UInt32)1 << 10)
+#define kHash3Size ((UInt32)1 << 16)
+#define kFix3HashSize kHash2Size
+#define kFix4HashSize (kHash2Size + kHash3Size)
+#define kBtMinLen 4
+#define kEmptyHashValue 0
+#define kCrcPoly 0xEDB88320
+
+#define kProgressInterval (1 << 16)
+
+typedef UInt16 CLzmaProb;
+
+void LzmaEncProps_Init(CLzmaEncProps *p)
+{
+  p->level = 5;
+  p->dictSize = p->mc = 0;
+  p->reduceSize = (UInt64)(Int64)-1;
+  p->lc = p->lp = p->pb = p->algo = p->fb = -1;
+}
+
+void LzmaEncProps_Normalize(CLzmaEncProps *p)
+{
+  int level = p->level;
+  if (level < 0) level = 5;
+  if (level > 9) level = 9;
+  p->level = level;
+
+  if (p->dictSize == 0)
+    p->dictSize = (level <= 5 ? ((UInt32)1 << (level * 2 + 14)) :
+                  (level <= 7 ? ((UInt32)1 << 25) : ((UInt32)1 << 26)));
+  if (p->dictSize > p->reduceSize)
+  {
+    unsigned i;
+    for (i = 12; i < 32; i++)
+      if (((UInt32)1 << i) >= p->reduceSize)
+      {
+        p->dictSize = (UInt32)1 << i;
+        break;
+      }
+  }
+
+  if (p->lc < 0) p->lc = 3;
+  if (p->lp < 0) p->lp = 0;
+  if (p->pb < 0) p->pb = 2;
+  if (p->algo < 0) p->algo = (level < 5 ? 0 : 1);
+  if (p->fb < 0) p->fb = (level < 7 ? 32 : 64);
+  if (p->mc == 0) p->mc = (UInt32)(16 + (p->fb >> 1));
+}
+
+
+/* ---------- Match Finder ---------- */
+
+/* Binary tree match finder over the whole input, which stays addressable,
+   so no sliding window is copied. Positions are biased by cyclicBufferSize
+   so that kEmptyHashValue is always out of reach. */
+typedef struct
+{
+  const Byte *buffer;
+  UInt32 pos;
+  UInt32 streamPos;
+  UInt32 cyclicBufferPos;
+  UInt32 cyclicBufferSize;
+  UInt32 matchMaxLen;
+  UInt32 cutValue;
+  UInt32 hashMask;
+  UInt32 *hash;
+  UInt32 *son;
+  UInt32 crc[256];
+} CMatchFinder;
+
+static UInt32 MatchFinder_GetNumAvailableBytes(const CMatchFinder *p)
+{
+  return p->streamPos - p->pos;
+}
+
+static const Byte *MatchFinder_GetPointerToCurrentPos(const CMatchFinder *p)
+{
+  return p->buffer;
+}
+
+static void MatchFinder_MovePos(CMatchFinder *p)
+{
+  if (++p->cyclicBufferPos == p->cyclicBufferSize)
+    p->cyclicBufferPos = 0;
+  p->buffer++;
+  p->pos++;
+}
+
+static UInt32 *GetMatchesSpec1(UInt32 lenLimit, UInt32 curMatch, UInt32 pos,
+    const Byte *cur, UInt32 *son, UInt32 cyclicBufferPos, UInt32 cyclicBufferSize,
+    UInt32 cutValue, UInt32 *distances, UInt32 maxLen)
+{
+  UInt32 *ptr0 = son + (cyclicBufferPos << 1) + 1;
+  UInt32 *ptr1 = son + (cyclicBufferPos << 1);
+  UInt32 len0 = 0, len1 = 0;
+  for (;;)
+  {
+    UInt32 delta = pos - curMatch;
+    if (cutValue-- == 0 || delta >= cyclicBufferSize)
+    {
+      *ptr0 = *ptr1 = kEmptyHashValue;
+      return distances;
+    }
+    {
+      UInt32 *pair = son + ((cyclicBufferPos - delta +
+          ((delta > cyclicBufferPos) ? cyclicBufferSize : 0)) << 1);
+      const Byte *pb = cur - delta;
+      UInt32 len = (len0 < len1 ? len0 : len1);
+      if (pb[len] == cur[len])
+      {
+        if (++len != lenLimit && pb[len] == cur[len])
+          while (++len != lenLimit)
+            if (pb[len] != cur[len])
+              break;
+        if (maxLen < len)
+        {
+          *distances++ = maxLen = len;
+          *distances++ = delta - 1;
+          if (len == lenLimit)
+          {
+            *ptr1 = pair[0];
+            *ptr0 = pair[1];
+            return distances;
+          }
+        }
+      }
+      if (pb[len] < cur[len])
+      {
+        *ptr1 = curMatch;
+        ptr1 = pair + 1;
+        curMatch = *ptr1;
+        len1 = len;
+      }
+      else
+      {
+        *ptr0 = curMatch;
+        ptr0 = pair;
+        curMatch = *ptr0;
+        len0 = len;
+      }
+    }
+  }
+}
+
+static void SkipMatchesSpec(UInt32 lenLimit, UInt32 curMatch, UInt32 pos,
+    const Byte *cur, UInt32 *son, UInt32 cyclicBufferPos, UInt32 cyclicBufferSize,
+    UInt32 cutValue)
+{
+  UInt32 *ptr0 = son + (cyclicBufferPos << 1) + 1;
+  UInt32 *ptr1 = son + (cyclicBufferPos << 1);
+  UInt32 len0 = 0, len1 = 0;
+  for (;;)
+  {
+    UInt32 delta = pos - curMatch;
+    if (cutValue-- == 0 || delta >= cyclicBufferSize)
+    {
+      *ptr0 = *ptr1 = kEmptyHashValue;
+      return;
+    }
+    {
+      UInt32 *pair = son + ((cyclicBufferPos - delta +
+          ((delta > cyclicBufferPos) ? cyclicBufferSize : 0)) << 1);
+      const Byte *pb = cur - delta;
+      UInt32 len = (len0 < len1 ? len0 : len1);
+      if (pb[len] == cur[len])
+      {
+        while (++len != lenLimit)
+          if (pb[len] != cur[len])
+            break;
+        if (len == lenLimit)
+        {
+          *ptr1 = pair[0];
+          *ptr0 = pair[1];
+          return;
+        }
+      }
+      if (pb[len] < cur[len])
+      {
+        *ptr1 = curMatch;
+        ptr1 = pair + 1;
+        curMatch = *ptr1;
+        len1 = len;
+      }
+      else
+      {
+        *ptr0 = curMatch;
+        ptr0 = pair;
+        curMatch = *ptr0;
+        len0 = len;
+      }
+    }
+  }
+}
+
+/* Hashes of the 2, 3 and 4 bytes at cur. A 2 or 3 byte hash hit whose first
+   byte matches guarantees that the whole 2 or 3 bytes match. */
+#define HASH4_CALC \
+  { \
+    UInt32 temp = p->crc[cur[0]] ^ cur[1]; \
+    h2 = temp & (kHash2Size - 1); \
+    temp ^= ((UInt32)cur[2] << 8); \
+    h3 = temp & (kHash3Size - 1); \
+    hv = (temp ^ (p->crc[cur[3]] << 5)) & p->hashMask; \
+  }
+
+/* Writes (length, distance - 1) pairs of strictly increasing length for the
+   current position to distances, advances by one byte and returns the
+   number of UInt32s written. */
+static UInt32 Bt4_MatchFinder_GetMatches(CMatchFinder *p, UInt32 *distances)
+{
+  UInt32 h2, h3, hv, d2, d3, maxLen, offset, pos, curMatch;
+  UInt32 *hash;
+  const Byte *cur = p->buffer;
+  UInt32 lenLimit = p->matchMaxLen;
+  if (lenLimit > p->streamPos - p->pos)
+    lenLimit = p->streamPos - p->pos;
+  if (lenLimit < kBtMinLen)
+  {
+    MatchFinder_MovePos(p);
+    return 0;
+  }
+
+  hash = p->hash;
+  pos = p->pos;
+  HASH4_CALC;
+  d2 = pos - hash[h2];
+  d3 = pos - hash[kFix3HashSize + h3];
+  curMatch = hash[kFix4HashSize + hv];
+  hash[h2] = pos;
+  hash[kFix3HashSize + h3] = pos;
+  hash[kFix4HashSize + hv] = pos;
+
+  maxLen = 0;
+  offset = 0;
+  if (d2 < p->cyclicBufferSize && *(cur - d2) == *cur)
+  {
+    distances[0] = maxLen = 2;
+    distances[1] = d2 - 1;
+    offset = 2;
+  }
+  if (d2 != d3 && d3 < p->cyclicBufferSize && *(cur - d3) == *cur)
+  {
+    maxLen = 3;
+    distances[offset + 1] = d3 - 1;
+    offset += 2;
+    d2 = d3;
+  }
+  if (offset != 0)
+  {
+    for (; maxLen != lenLimit; maxLen++)
+      if (cur[(ptrdiff_t)maxLen - d2] != cur[maxLen])
+        break;
+    distances[offset - 2] = maxLen;
+    if (maxLen == lenLimit)
+    {
+      SkipMatchesSpec(lenLimit, curMatch, pos, cur, p->son,
+          p->cyclicBufferPos, p->cyclicBufferSize, p->cutValue);
+      MatchFinder_MovePos(p);
+      return offset;
+    }
+  }
+  if (maxLen < 3)
+    maxLen = 3;
+  offset = (UInt32)(GetMatchesSpec1(lenLimit, curMatch, pos, cur, p->son,
+      p->cyclicBufferPos, p->cyclicBufferSize, p->cutValue,
+      distances + offset, maxLen) - distances);
+  MatchFinder_MovePos(p);
+  return offset;
+}
+
+static void Bt4_MatchFinder_Skip(CMatchFinder *p, UInt32 num)
+{
+  do
+  {
+    UInt32 h2, h3, hv, curMatch;
+    UInt32 *hash;
+    const Byte *cur = p->buffer;
+    UInt32 lenLimit = p->matchMaxLen;
+    if (lenLimit > p->streamPos - p->pos)
+      lenLimit = p->streamPos - p->pos;
+    if (lenLimit < kBtMinLen)
+    {
+      MatchFinder_MovePos(p);
+      continue;
+    }
+    hash = p->hash;
+    HASH4_CALC;
+    curMatch = hash[kFix4HashSize + hv];
+    hash[h2] = p->pos;
+    hash[kFix3HashSize + h3] = p->pos;
+    hash[kFix4HashSize + hv] = p->pos;
+    SkipMatchesSpec(lenLimit, curMatch, p->pos, cur, p->son,
+        p->cyclicBufferPos, p->cyclicBufferSize, p->cutValue);
+    MatchFinder_MovePos(p);
+  }
+  while (--num != 0);
+}
+
+static size_t MatchFinder_HashSize(UInt32 historySize)
+{
+  UInt32 hs = historySize - 1;
+  hs |= (hs >> 1);
+  hs |= (hs >> 2);
+  hs |= (hs >> 4);
+  hs |= (hs >> 8);
+  hs >>= 1;
+  hs |= 0xFFFF;
+  if (hs > ((UInt32)1 << 24))
+    hs >>= 1;
+  return (size_t)hs + 1;
+}
+
+static void MatchFinder_Init(CMatchFinder *p, const Byte *src, UInt32 srcLen)
+{
+  UInt32 i;
+  for (i = 0; i < 256; i++)
+  {
+    UInt32 r = i;
+    unsigned j;
+    for (j = 0; j < 8; j++)
+      r = (r >> 1) ^ (kCrcPoly & (0 - (r & 1)));
+    p->crc[i] = r;
+  }
+  p->buffer = src;
+  p->cyclicBufferPos = 0;
+  p->pos = p->cyclicBufferSize;
+  p->streamPos = p->pos + srcLen;
+}
+
+
+/* ---------- Range Encoder ---------- */
+
+typedef struct
+{
+  UInt32 range;
+  Byte cache;
+  UInt64 low;
+  UInt64 cacheSize;
+  Byte *bufBase;
+  Byte *buf;
+  Byte *bufLim;
+  int overflow;
+} CRangeEnc;
+
+static void RangeEnc_Init(CRangeEnc *p, Byte *buf, SizeT size)
+{
+  p->range = 0xFFFFFFFF;
+  p->cache = 0;
+  p->low = 0;
+  p->cacheSize = 1;
+  p->bufBase = p->buf = buf;
+  p->bufLim = buf + size;
+  p->overflow = 0;
+}
+
+static void RangeEnc_WriteByte(CRangeEnc *p, Byte b)
+{
+  if (p->buf == p->bufLim)
+  {
+    p->overflow = 1;
+    return;
+  }
+  *p->buf++ = b;
+}
+
+static void RangeEnc_ShiftLow(CRangeEnc *p)
+{
+  UInt32 low = (UInt32)p->low;
+  unsigned high = (unsigned)(p->low >> 32);
+  p->low = (UInt32)(low << 8);
+  if (low < (UInt32)0xFF000000 || high != 0)
+  {
+    Byte temp = p->cache;
+    do
+    {
+      RangeEnc_WriteByte(p, (Byte)(temp + high));
+      temp = 0xFF;
+    }
+    while (--p->cacheSize != 0);
+    p->cache = (Byte)(low >> 24);
+  }
+  p->cacheSize++;
+}
+
+static void RangeEnc_FlushData(CRangeEnc *p)
+{
+  int i;
+  for (i = 0; i < 5; i++)
+    RangeEnc_ShiftLow(p);
+}
+
+static void RangeEnc_EncodeBit(CRangeEnc *p, CLzmaProb *prob, UInt32 bit)
+{
+  UInt32 ttt = *prob;
+  UInt32 newBound = (p->range >> kNumBitModelTotalBits) * ttt;
+  if (bit == 0)
+  {
+    p->range = newBound;
+    ttt += (kBitModelTotal - ttt) >> kNumMoveBits;
+  }
+  else
+  {
+    p->low += newBound;
+    p->range -= newBound;
+    ttt -= ttt >> kNumMoveBits;
+  }
+  *prob = (CLzmaProb)ttt;
+  if (p->range < kTopValue)
+  {
+    p->range <<= 8;
+    RangeEnc_ShiftLow(p);
+  }
+}
+
+static void RangeEnc_EncodeDirectBits(CRangeEnc *p, UInt32 value, unsigned numBits)
+{
+  do
+  {
+    p->range >>= 1;
+    p->low += p->range & (0 - ((value >> --numBits) & 1));
+    if (p->range < kTopValue)
+    {
+      p->range <<= 8;
+      RangeEnc_ShiftLow(p);
+    }
+  }
+  while (numBits != 0);
+}
+
+static void RcTree_Encode(CRangeEnc *rc, CLzmaProb *probs, unsigned numBits, UInt32 symbol)
+{
+  UInt32 m = 1;
+  do
+  {
+    UInt32 bit;
+    numBits--;
+    bit = (symbol >> numBits) & 1;
+    RangeEnc_EncodeBit(rc, probs + m, bit);
+    m = (m << 1) | bit;
+  }
+  while (numBits != 0);
+}
+
+static void RcTree_ReverseEncode(CRangeEnc *rc, CLzmaProb *probs, unsigned numBits, UInt32 symbol)
+{
+  UInt32 m = 1;
+  do
+  {
+    UInt32 bit = symbol & 1;
+    symbol >>= 1;
+    RangeEnc_EncodeBit(rc, probs + m, bit);
+    m = (m << 1) | bit;
+  }
+  while (--numBits != 0);
+}
+
+static void LitEnc_Encode(CRangeEnc *p, CLzmaProb *probs, UInt32 symbol)
+{
+  symbol |= 0x100;
+  do
+  {
+    RangeEnc_EncodeBit(p, probs + (symbol >> 8), (symbol >> 7) & 1);
+    symbol <<= 1;
+  }
+  while (symbol < 0x10000);
+}
+
+static void LitEnc_EncodeMatched(CRangeEnc *p, CLzmaProb *probs, UInt32 symbol, UInt32 matchByte)
+{
+  UInt32 offs = 0x100;
+  symbol |= 0x100;
+  do
+  {
+    matchByte <<= 1;
+    RangeEnc_EncodeBit(p, probs + (offs + (matchByte & offs) + (symbol >> 8)), (symbol >> 7) & 1);
+    symbol <<= 1;
+    offs &= ~(matchByte ^ symbol);
+  }
+  while (symbol < 0x10000);
+}
+
+
+/* ---------- Prices ---------- */
+
+/* Price of coding a bit, in 1/16 bits, indexed by the probability of a 0
+   bit with the low kNumMoveReducingBits dropped. */
+static void LzmaEnc_InitPriceTables(UInt32 *probPrices)
+{
+  UInt32 i;
+  for (i = (1 << kNumMoveReducingBits) / 2; i < kBitModelTotal; i += (1 << kNumMoveReducingBits))
+  {
+    const int kCyclesBits = kNumBitPriceShiftBits;
+    UInt32 w = i;
+    UInt32 bitCount = 0;
+    int j;
+    for (j = 0; j < kCyclesBits; j++)
+    {
+      w = w * w;
+      bitCount <<= 1;
+      while (w >= ((UInt32)1 << 16))
+      {
+        w >>= 1;
+        bitCount++;
+      }
+    }
+    probPrices[i >> kNumMoveReducingBits] = ((kNumBitModelTotalBits << kCyclesBits) - 15 - bitCount);
+  }
+}
+
+#define GET_PRICEa(prob, symbol) \
+  probPrices[((prob) ^ (unsigned)((-((int)(symbol))) & (kBitModelTotal - 1))) >> kNumMoveReducingBits]
+#define GET_PRICEa_0(prob) probPrices[(prob) >> kNumMoveReducingBits]
+#define GET_PRICEa_1(prob) probPrices[((prob) ^ (kBitModelTotal - 1)) >> kNumMoveReducingBits]
+
+#define GET_PRICE(prob, symbol) \
+  p->ProbPrices[((prob) ^ (unsigned)((-((int)(symbol))) & (kBitModelTotal - 1))) >> kNumMoveReducingBits]
+#define GET_PRICE_0(prob) p->ProbPrices[(prob) >> kNumMoveReducingBits]
+#define GET_PRICE_1(prob) p->ProbPrices[((prob) ^ (kBitModelTotal - 1)) >> kNumMoveReducingBits]
+
+static UInt32 LitEnc_GetPrice(const CLzmaProb *probs, UInt32 symbol, const UInt32 *probPrices)
+{
+  UInt32 price = 0;
+  symbol |= 0x100;
+  do
+  {
+    price += GET_PRICEa(probs[symbol >> 8], (symbol >> 7) & 1);
+    symbol <<= 1;
+  }
+  while (symbol < 0x10000);
+  return price;
+}
+
+static UInt32 LitEnc_GetPriceMatched(const CLzmaProb *probs, UInt32 symbol, UInt32 matchByte, const UInt32 *probPrices)
+{
+  UInt32 price = 0;
+  UInt32 offs = 0x100;
+  symbol |= 0x100;
+  do
+  {
+    matchByte <<= 1;
+    price += GET_PRICEa(probs[offs + (matchByte & offs) + (symbol >> 8)], (symbol >> 7) & 1);
+    symbol <<= 1;
+    offs &= ~(matchByte ^ symbol);
+  }
+  while (symbol < 0x10000);
+  return price;
+}
+
+static UInt32 RcTree_GetPrice(const CLzmaProb *probs, unsigned numBits, UInt32 symbol, const UInt32 *probPrices)
+{
+  UInt32 price = 0;
+  symbol |= ((UInt32)1 << numBits);
+  while (symbol != 1)
+  {
+    price += GET_PRICEa(probs[symbol >> 1], symbol & 1);
+    symbol >>= 1;
+  }
+  return price;
+}
+
+static UInt32 RcTree_ReverseGetPrice(const CLzmaProb *probs, unsigned numBits, UInt32 symbol, const UInt32 *probPrices)
+{
+  UInt32 price = 0;
+  UInt32 m = 1;
+  for (; numBits != 0; numBits--)
+  {
+    UInt32 bit = symbol & 1;
+    symbol >>= 1;
+    price += GET_PRICEa(probs[m], bit);
+    m = (m << 1) | bit;
+  }
+  return price;
+}
+
+
+/* ---------- Length Encoder ---------- */
+
+typedef struct
+{
+  CLzmaProb choice;
+  CLzmaProb choice2;
+  CLzmaProb low[kNumPosStatesMax << kLenNumLowBits];
+  CLzmaProb mid[kNumPosStatesMax << kLenNumLowBits];
+  CLzmaProb high[kLenNumHighSymbols];
+} CLenEnc;
+
+/* Length coder with a price table per pos state, refreshed after tableSize
+   uses of that pos state. */
+typedef struct
+{
+  CLenEnc p;
+  UInt32 tableSize;
+  UInt32 prices[kNumPosStatesMax][kLenNumSymbolsTotal];
+  UInt32 counters[kNumPosStatesMax];
+} CLenPriceEnc;
+
+static void LenEnc_Encode(CLenEnc *p, CRangeEnc *rc, UInt32 len, unsigned posState)
+{
+  if (len < kLenNumLowSymbols)
+  {
+    RangeEnc_EncodeBit(rc, &p->choice, 0);
+    RcTree_Encode(rc, p->low + (posState << kLenNumLowBits), kLenNumLowBits, len);
+    return;
+  }
+  RangeEnc_EncodeBit(rc, &p->choice, 1);
+  len -= kLenNumLowSymbols;
+  if (len < kLenNumLowSymbols)
+  {
+    RangeEnc_EncodeBit(rc, &p->choice2, 0);
+    RcTree_Encode(rc, p->mid + (posState << kLenNumLowBits), kLenNumLowBits, len);
+    return;
+  }
+  RangeEnc_EncodeBit(rc, &p->choice2, 1);
+  RcTree_Encode(rc, p->high, kLenNumHighBits, len - kLenNumLowSymbols);
+}
+
+static void LenEnc_SetPrices(const CLenEnc *p, unsigned posState, UInt32 numSymbols, UInt32 *prices, const UInt32 *probPrices)
+{
+  UInt32 a0 = GET_PRICEa_0(p->choice);
+  UInt32 a1 = GET_PRICEa_1(p->choice);
+  UInt32 b0 = a1 + GET_PRICEa_0(p->choice2);
+  UInt32 b1 = a1 + GET_PRICEa_1(p->choice2);
+  UInt32 i;
+  for (i = 0; i < kLenNumLowSymbols; i++)
+  {
+    if (i >= numSymbols)
+      return;
+    prices[i] = a0 + RcTree_GetPrice(p->low + (posState << kLenNumLowBits), kLenNumLowBits, i, probPrices);
+  }
+  for (; i < kLenNumLowSymbols * 2; i++)
+  {
+    if (i >= numSymbols)
+      return;
+    prices[i] = b0 + RcTree_GetPrice(p->mid + (posState << kLenNumLowBits), kLenNumLowBits, i - kLenNumLowSymbols, probPrices);
+  }
+  for (; i < numSymbols; i++)
+    prices[i] = b1 + RcTree_GetPrice(p->high, kLenNumHighBits, i - kLenNumLowSymbols * 2, probPrices);
+}
+
+static void LenPriceEnc_UpdateTable(CLenPriceEnc *p, unsigned posState, const UInt32 *probPrices)
+{
+  LenEnc_SetPrices(&p->p, posState, p->tableSize, p->prices[posState], probPrices);
+  p->counters[posState] = p->tableSize;
+}
+
+static void LenPriceEnc_UpdateTables(CLenPriceEnc *p, unsigned numPosStates, const UInt32 *probPrices)
+{
+  unsigned posState;
+  for (posState = 0; posState < numPosStates; posState++)
+    LenPriceEnc_UpdateTable(p, posState, probPrices);
+}
+
+static void LenEnc_Encode2(CLenPriceEnc *p, CRangeEnc *rc, UInt32 len, unsigned posState, BoolInt updatePrice, const UInt32 *probPrices)
+{
+  LenEnc_Encode(&p->p, rc, len, posState);
+  if (updatePrice)
+    if (--p->counters[posState] == 0)
+      LenPriceEnc_UpdateTable(p, posState, probPrices);
+}
+
+
+/* ---------- Encoder ---------- */
+
+typedef struct
+{
+  Byte state;
+  BoolInt prev1IsChar;
+  BoolInt prev2;
+  UInt32 posPrev2;
+  UInt32 backPrev2;
+  UInt32 price;
+  UInt32 posPrev;
+  UInt32 backPrev;
+  UInt32 backs[kNumReps];
+} COptimal;
+
+#define MakeAsChar(p) (p)->backPrev = (UInt32)(-1); (p)->prev1IsChar = False;
+#define MakeAsShortRep(p) (p)->backPrev = 0; (p)->prev1IsChar = False;
+#define IsShortRep(p) ((p)->backPrev == 0)
+
+#define IsCharState(s) ((s) < kNumLitStates)
+
+#define GetLenToPosState(len) \
+  (((len) < kNumLenToPosStates + 1) ? (len) - 2 : kNumLenToPosStates - 1)
+
+static const Byte kLiteralNextStates[kNumStates] = {0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 4, 5};
+static const Byte kMatchNextStates[kNumStates] = {7, 7, 7, 7, 7, 7, 7, 10, 10, 10, 10, 10};
+static const Byte kRepNextStates[kNumStates] = {8, 8, 8, 8, 8, 8, 8, 11, 11, 11, 11, 11};
+static const Byte kShortRepNextStates[kNumStates] = {9, 9, 9, 9, 9, 9, 9, 11, 11, 11, 11, 11};
+
+typedef struct
+{
+  CMatchFinder matchFinder;
+  CRangeEnc rc;
+
+  /* Bytes read ahead by the match finder beyond the encoded position. */
+  UInt32 additionalOffset;
+  UInt32 optimumEndIndex;
+  UInt32 optimumCurrentIndex;
+  UInt32 longestMatchLength;
+  UInt32 numPairs;
+  UInt32 numAvail;
+  UInt32 numFastBytes;
+  BoolInt fastMode;
+
+  UInt32 state;
+  UInt32 reps[kNumReps];
+
+  unsigned lc, lp, pb;
+  UInt32 lpMask, pbMask;
+  CLzmaProb *litProbs;
+
+  CLzmaProb isMatch[kNumStates][kNumPosStatesMax];
+  CLzmaProb isRep[kNumStates];
+  CLzmaProb isRepG0[kNumStates];
+  CLzmaProb isRepG1[kNumStates];
+  CLzmaProb isRepG2[kNumStates];
+  CLzmaProb isRep0Long[kNumStates][kNumPosStatesMax];
+  CLzmaProb posSlotEncoder[kNumLenToPosStates][1 << kNumPosSlotBits];
+  CLzmaProb posEncoders[kNumFullDistances];
+  CLzmaProb posAlignEncoder[kAlignTableSize];
+  CLenPriceEnc lenEnc;
+  CLenPriceEnc repLenEnc;
+
+  UInt32 matchPriceCount;
+  UInt32 alignPriceCount;
+  UInt32 distTableSize;
+  UInt32 ProbPrices[kBitModelTotal >> kNumMoveReducingBits];
+  UInt32 posSlotPrices[kNumLenToPosStates][kDistTableSizeMax];
+  UInt32 distancesPrices[kNumLenToPosStates][kNumFullDistances];
+  UInt32 alignPrices[kAlignTableSize];
+
+  UInt32 matches[kMatchMaxLen * 2 + 2 + 1];
+  COptimal opt[kNumOpts];
+} CLzmaEnc;
+
+#define LIT_PROBS(pos, prevByte) \
+  (p->litProbs + (size_t)0x300 * ((((pos) & p->lpMask) << p->lc) + ((prevByte) >> (8 - p->lc))))
+
+static void Probs_Init(CLzmaProb *probs, size_t num)
+{
+  size_t i;
+  for (i = 0; i < num; i++)
+    probs[i] = kProbInitValue;
+}
+
+static void LzmaEnc_InitProbs(CLzmaEnc *p)
+{
+  Probs_Init(p->litProbs, (size_t)0x300 << (p->lc + p->lp));
+  Probs_Init(&p->isMatch[0][0], sizeof(p->isMatch) / sizeof(CLzmaProb));
+  Probs_Init(p->isRep, kNumStates);
+  Probs_Init(p->isRepG0, kNumStates);
+  Probs_Init(p->isRepG1, kNumStates);
+  Probs_Init(p->isRepG2, kNumStates);
+  Probs_Init(&p->isRep0Long[0][0], sizeof(p->isRep0Long) / sizeof(CLzmaProb));
+  Probs_Init(&p->posSlotEncoder[0][0], sizeof(p->posSlotEncoder) / sizeof(CLzmaProb));
+  Probs_Init(p->posEncoders, kNumFullDistances);
+  Probs_Init(p->posAlignEncoder, kAlignTableSize);
+  Probs_Init((CLzmaProb *)&p->lenEnc.p, sizeof(CLenEnc) / sizeof(CLzmaProb));
+  Probs_Init((CLzmaProb *)&p->repLenEnc.p, sizeof(CLenEnc) / sizeof(CLzmaProb));
+}
+
+static unsigned GetPosSlot(UInt32 dist)
+{
+  unsigned i;
+  if (dist < kStartPosModelIndex)
+    return (unsigned)dist;
+  for (i = 31; (dist >> i) == 0; i--) {}
+  return (i << 1) | ((dist >> (i - 1)) & 1);
+}
+
+static void FillAlignPrices(CLzmaEnc *p)
+{
+  UInt32 i;
+  for (i = 0; i < kAlignTableSize; i++)
+    p->alignPrices[i] = RcTree_ReverseGetPrice(p->posAlignEncoder, kNumAlignBits, i, p->ProbPrices);
+  p->alignPriceCount = 0;
+}
+
+static void FillDistancesPrices(CLzmaEnc *p)
+{
+  UInt32 tempPrices[kNumFullDistances];
+  UInt32 i, lenToPosState;
+  for (i = kStartPosModelIndex; i < kNumFullDistances; i++)
+  {
+    UInt32 posSlot = GetPosSlot(i);
+    UInt32 footerBits = ((posSlot >> 1) - 1);
+    UInt32 base = ((2 | (posSlot & 1)) << footerBits);
+    tempPrices[i] = RcTree_ReverseGetPrice(p->posEncoders + base - posSlot - 1,
+        footerBits, i - base, p->ProbPrices);
+  }
+
+  for (lenToPosState = 0; lenToPosState < kNumLenToPosStates; lenToPosState++)
+  {
+    UInt32 posSlot;
+    const CLzmaProb *encoder = p->posSlotEncoder[lenToPosState];
+    UInt32 *posSlotPrices = p->posSlotPrices[lenToPosState];
+    UInt32 *distancesPrices = p->distancesPrices[lenToPosState];
+    for (posSlot = 0; posSlot < p->distTableSize; posSlot++)
+      posSlotPrices[posSlot] = RcTree_GetPrice(encoder, kNumPosSlotBits, posSlot, p->ProbPrices);
+    /* Direct bits cost exactly one bit each. */
+    for (posSlot = kEndPosModelIndex; posSlot < p->distTableSize; posSlot++)
+      posSlotPrices[posSlot] += ((((posSlot >> 1) - 1) - kNumAlignBits) << kNumBitPriceShiftBits);
+
+    for (i = 0; i < kStartPosModelIndex; i++)
+      distancesPrices[i] = posSlotPrices[i];
+    for (; i < kNumFullDistances; i++)
+      distancesPrices[i] = posSlotPrices[GetPosSlot(i)] + tempPrices[i];
+  }
+  p->matchPriceCount = 0;
+}
+
+static UInt32 GetRepLen1Price(const CLzmaEnc *p, UInt32 state, UInt32 posState)
+{
+  return GET_PRICE_0(p->isRepG0[state]) + GET_PRICE_0(p->isRep0Long[state][posState]);
+}
+
+static UInt32 GetPureRepPrice(const CLzmaEnc *p, UInt32 repIndex, UInt32 state, UInt32 posState)
+{
+  UInt32 price;
+  if (repIndex == 0)
+  {
+    price = GET_PRICE_0(p->isRepG0[state]);
+    price += GET_PRICE_1(p->isRep0Long[state][posState]);
+  }
+  else
+  {
+    price = GET_PRICE_1(p->isRepG0[state]);
+    if (repIndex == 1)
+      price += GET_PRICE_0(p->isRepG1[state]);
+    else
+    {
+      price += GET_PRICE_1(p->isRepG1[state]);
+      price += GET_PRICE(p->isRepG2[state], repIndex - 2);
+    }
+  }
+  return price;
+}
+
+static UInt32 GetRepPrice(const CLzmaEnc *p, UInt32 repIndex, UInt32 len, UInt32 state, UInt32 posState)
+{
+  return p->repLenEnc.prices[posState][len - kMatchMinLen] +
+      GetPureRepPrice(p, repIndex, state, posState);
+}
+
+static UInt32 GetMatchPrice(const CLzmaEnc *p, UInt32 dist, UInt32 len)
+{
+  UInt32 lenToPosState = GetLenToPosState(len);
+  if (dist < kNumFullDistances)
+    return p->distancesPrices[lenToPosState][dist];
+  return p->posSlotPrices[lenToPosState][GetPosSlot(dist)] + p->alignPrices[dist & kAlignMask];
+}
+
+/* Finds the matches at the next position and extends the longest one past
+   numFastBytes. Returns its length, 0 if there is none. */
+static UInt32 ReadMatchDistances(CLzmaEnc *p, UInt32 *numPairsRes)
+{
+  UInt32 lenRes = 0, numPairs;
+  p->numAvail = MatchFinder_GetNumAvailableBytes(&p->matchFinder);
+  numPairs = Bt4_MatchFinder_GetMatches(&p->matchFinder, p->matches);
+  if (numPairs > 0)
+  {
+    lenRes = p->matches[numPairs - 2];
+    if (lenRes == p->numFastBytes)
+    {
+      const Byte *pby = MatchFinder_GetPointerToCurrentPos(&p->matchFinder) - 1;
+      const Byte *pby2 = pby - (p->matches[numPairs - 1] + 1);
+      UInt32 numAvail = p->numAvail;
+      if (numAvail > kMatchMaxLen)
+        numAvail = kMatchMaxLen;
+      for (; lenRes < numAvail && pby[lenRes] == pby2[lenRes]; lenRes++) {}
+    }
+  }
+  p->additionalOffset++;
+  *numPairsRes = numPairs;
+  return lenRes;
+}
+
+static void MovePos(CLzmaEnc *p, UInt32 num)
+{
+  if (num != 0)
+  {
+    p->additionalOffset += num;
+    Bt4_MatchFinder_Skip(&p->matchFinder, num);
+  }
+}
+
+/* Turns the chain of posPrev links ending at cur into forward links and
+   returns the first step of the path. */
+static UInt32 Backward(CLzmaEnc *p, UInt32 *backRes, UInt32 cur)
+{
+  UInt32 posMem = p->opt[cur].posPrev;
+  UInt32 backMem = p->opt[cur].backPrev;
+  p->optimumEndIndex = cur;
+  do
+  {
+    if (p->opt[cur].prev1IsChar)
+    {
+      MakeAsChar(&p->opt[posMem])
+      p->opt[posMem].posPrev = posMem - 1;
+      if (p->opt[cur].prev2)
+      {
+        p->opt[posMem - 1].prev1IsChar = False;
+        p->opt[posMem - 1].posPrev = p->opt[cur].posPrev2;
+        p->opt[posMem - 1].backPrev = p->opt[cur].backPrev2;
+      }
+    }
+    {
+      UInt32 posPrev = posMem;
+      UInt32 backCur = backMem;
+      backMem = p->opt[posPrev].backPrev;
+      posMem = p->opt[posPrev].posPrev;
+      p->opt[posPrev].backPrev = backCur;
+      p->opt[posPrev].posPrev = cur;
+      cur = posPrev;
+    }
+  }
+  while (cur != 0);
+  *backRes = p->opt[0].backPrev;
+  p->optimumCurrentIndex = p->opt[0].posPrev;
+  return p->optimumCurrentIndex;
+}
+
+/* Optimal parsing: prices every literal, match and rep choice reachable
+   from the current position, up to kNumOpts bytes ahead, and returns the
+   first step of the cheapest path. *backRes is (UInt32)-1 for a literal,
+   a rep index below kNumReps, or distance + kNumReps for a match. */
+static UInt32 GetOptimum(CLzmaEnc *p, UInt32 position, UInt32 *backRes)
+{
+  UInt32 numAvail, mainLen, numPairs, repMaxIndex, i, posState, lenEnd, len, cur;
+  UInt32 matchPrice, repMatchPrice, normalMatchPrice;
+  UInt32 *matches;
+  UInt32 reps[kNumReps], repLens[kNumReps];
+  const Byte *data;
+  Byte curByte, matchByte;
+
+  if (p->optimumEndIndex != p->optimumCurrentIndex)
+  {
+    const COptimal *opt = &p->opt[p->optimumCurrentIndex];
+    UInt32 lenRes = opt->posPrev - p->optimumCurrentIndex;
+    *backRes = opt->backPrev;
+    p->optimumCurrentIndex = opt->posPrev;
+    return lenRes;
+  }
+  p->optimumCurrentIndex = p->optimumEndIndex = 0;
+
+  if (p->additionalOffset == 0)
+    mainLen = ReadMatchDistances(p, &numPairs);
+  else
+  {
+    mainLen = p->longestMatchLength;
+    numPairs = p->numPairs;
+  }
+
+  numAvail = p->numAvail;
+  if (numAvail < 2)
+  {
+    *backRes = (UInt32)(-1);
+    return 1;
+  }
+  if (numAvail > kMatchMaxLen)
+    numAvail = kMatchMaxLen;
+
+  data = MatchFinder_GetPointerToCurrentPos(&p->matchFinder) - 1;
+  repMaxIndex = 0;
+  for (i = 0; i < kNumReps; i++)
+  {
+    UInt32 lenTest;
+    const Byte *data2;
+    reps[i] = p->reps[i];
+    data2 = data - (reps[i] + 1);
+    if (data[0] != data2[0] || data[1] != data2[1])
+    {
+      repLens[i] = 0;
+      continue;
+    }
+    for (lenTest = 2; lenTest < numAvail && data[lenTest] == data2[lenTest]; lenTest++) {}
+    repLens[i] = lenTest;
+    if (lenTest > repLens[repMaxIndex])
+      repMaxIndex = i;
+  }
+  if (repLens[repMaxIndex] >= p->numFastBytes)
+  {
+    UInt32 lenRes;
+    *backRes = repMaxIndex;
+    lenRes = repLens[repMaxIndex];
+    MovePos(p, lenRes - 1);
+    return lenRes;
+  }
+
+  matches = p->matches;
+  if (mainLen >= p->numFastBytes)
+  {
+    *backRes = matches[numPairs - 1] + kNumReps;
+    MovePos(p, mainLen - 1);
+    return mainLen;
+  }
+  curByte = *data;
+  matchByte = *(data - (reps[0] + 1));
+
+  if (mainLen < 2 && curByte != matchByte && repLens[repMaxIndex] < 2)
+  {
+    *backRes = (UInt32)-1;
+    return 1;
+  }
+
+  p->opt[0].state = (Byte)p->state;
+
+  posState = (position & p->pbMask);
+
+  {
+    const CLzmaProb *probs = LIT_PROBS(position, *(data - 1));
+    p->opt[1].price = GET_PRICE_0(p->isMatch[p->state][posState]) +
+        (!IsCharState(p->state) ?
+          LitEnc_GetPriceMatched(probs, curByte, matchByte, p->ProbPrices) :
+          LitEnc_GetPrice(probs, curByte, p->ProbPrices));
+  }
+
+  MakeAsChar(&p->opt[1])
+
+  matchPrice = GET_PRICE_1(p->isMatch[p->state][posState]);
+  repMatchPrice = matchPrice + GET_PRICE_1(p->isRep[p->state]);
+
+  if (matchByte == curByte)
+  {
+    UInt32 shortRepPrice = repMatchPrice + GetRepLen1Price(p, p->state, posState);
+    if (shortRepPrice < p->opt[1].price)
+    {
+      p->opt[1].price = shortRepPrice;
+      MakeAsShortRep(&p->opt[1])
+    }
+  }
+  lenEnd = ((mainLen >= repLens[repMaxIndex]) ? mainLen : repLens[repMaxIndex]);
+
+  if (lenEnd < 2)
+  {
+    *backRes = p->opt[1].backPrev;
+    return 1;
+  }
+
+  p->opt[1].posPrev = 0;
+  for (i = 0; i < kNumReps; i++)
+    p->opt[0].backs[i] = reps[i];
+
+  len = lenEnd;
+  do
+    p->opt[len--].price = kInfinityPrice;
+  while (len >= 2);
+
+  for (i = 0; i < kNumReps; i++)
+  {
+    UInt32 repLen = repLens[i];
+    UInt32 price;
+    if (repLen < 2)
+      continue;
+    price = repMatchPrice + GetPureRepPrice(p, i, p->state, posState);
+    do
+    {
+      UInt32 curAndLenPrice = price + p->repLenEnc.prices[posState][repLen - 2];
+      COptimal *opt = &p->opt[repLen];
+      if (curAndLenPrice < opt->price)
+      {
+        opt->price = curAndLenPrice;
+        opt->posPrev = 0;
+        opt->backPrev = i;
+        opt->prev1IsChar = False;
+      }
+    }
+    while (--repLen >= 2);
+  }
+
+  normalMatchPrice = matchPrice + GET_PRICE_0(p->isRep[p->state]);
+
+  len = ((repLens[0] >= 2) ? repLens[0] + 1 : 2);
+  if (len <= mainLen)
+  {
+    UInt32 offs = 0;
+    while (len > matches[offs])
+      offs += 2;
+    for (; ; len++)
+    {
+      COptimal *opt;
+      UInt32 distance = matches[offs + 1];
+      UInt32 curAndLenPrice = normalMatchPrice + p->lenEnc.prices[posState][len - kMatchMinLen] +
+          GetMatchPrice(p, distance, len);
+      opt = &p->opt[len];
+      if (curAndLenPrice < opt->price)
+      {
+        opt->price = curAndLenPrice;
+        opt->posPrev = 0;
+        opt->backPrev = distance + kNumReps;
+        opt->prev1IsChar = False;
+      }
+      if (len == matches[offs])
+      {
+        offs += 2;
+        if (offs == numPairs)
+          break;
+      }
+    }
+  }
+
+  cur = 0;
+
+  for (;;)
+  {
+    UInt32 numAvailFull, newLen, posPrev, state, startLen;
+    UInt32 curPrice, curAnd1Price;
+    BoolInt nextIsChar;
+    COptimal *curOpt;
+    COptimal *nextOpt;
+
+    cur++;
+    if (cur == lenEnd)
+      return Backward(p, backRes, cur);
+
+    newLen = ReadMatchDistances(p, &numPairs);
+    if (newLen >= p->numFastBytes)
+    {
+      p->numPairs = numPairs;
+      p->longestMatchLength = newLen;
+      return Backward(p, backRes, cur);
+    }
+    position++;
+    curOpt = &p->opt[cur];
+    posPrev = curOpt->posPrev;
+    if (curOpt->prev1IsChar)
+    {
+      posPrev--;
+      if (curOpt->prev2)
+      {
+        state = p->opt[curOpt->posPrev2].state;
+        if (curOpt->backPrev2 < kNumReps)
+          state = kRepNextStates[state];
+        else
+          state = kMatchNextStates[state];
+      }
+      else
+        state = p->opt[posPrev].state;
+      state = kLiteralNextStates[state];
+    }
+    else
+      state = p->opt[posPrev].state;
+    if (posPrev == cur - 1)
+    {
+      if (IsShortRep(curOpt))
+        state = kShortRepNextStates[state];
+      else
+        state = kLiteralNextStates[state];
+    }
+    else
+    {
+      UInt32 pos;
+      const COptimal *prevOpt;
+      if (curOpt->prev1IsChar && curOpt->prev2)
+      {
+        posPrev = curOpt->posPrev2;
+        pos = curOpt->backPrev2;
+        state = kRepNextStates[state];
+      }
+      else
+      {
+        pos = curOpt->backPrev;
+        if (pos < kNumReps)
+          state = kRepNextStates[state];
+        else
+          state = kMatchNextStates[state];
+      }
+      prevOpt = &p->opt[posPrev];
+      if (pos < kNumReps)
+      {
+        reps[0] = prevOpt->backs[pos];
+        for (i = 1; i <= pos; i++)
+          reps[i] = prevOpt->backs[i - 1];
+        for (; i < kNumReps; i++)
+          reps[i] = prevOpt->backs[i];
+      }
+      else
+      {
+        reps[0] = (pos - kNumReps);
+        for (i = 1; i < kNumReps; i++)
+          reps[i] = prevOpt->backs[i - 1];
+      }
+    }
+    curOpt->state = (Byte)state;
+
+    for (i = 0; i < kNumReps; i++)
+      curOpt->backs[i] = reps[i];
+
+    curPrice = curOpt->price;
+    nextIsChar = False;
+    data = MatchFinder_GetPointerToCurrentPos(&p->matchFinder) - 1;
+    curByte = *data;
+    matchByte = *(data - (reps[0] + 1));
+
+    posState = (position & p->pbMask);
+
+    curAnd1Price = curPrice + GET_PRICE_0(p->isMatch[state][posState]);
+    {
+      const CLzmaProb *probs = LIT_PROBS(position, *(data - 1));
+      curAnd1Price +=
+        (!IsCharState(state) ?
+          LitEnc_GetPriceMatched(probs, curByte, matchByte, p->ProbPrices) :
+          LitEnc_GetPrice(probs, curByte, p->ProbPrices));
+    }
+
+    nextOpt = &p->opt[cur + 1];
+
+    if (curAnd1Price < nextOpt->price)
+    {
+      nextOpt->price = curAnd1Price;
+      nextOpt->posPrev = cur;
+      MakeAsChar(nextOpt)
+      nextIsChar = True;
+    }
+
+    matchPrice = curPrice + GET_PRICE_1(p->isMatch[state][posState]);
+    repMatchPrice = matchPrice + GET_PRICE_1(p->isRep[state]);
+
+    if (matchByte == curByte && !(nextOpt->posPrev < cur && nextOpt->backPrev == 0))
+    {
+      UInt32 shortRepPrice = repMatchPrice + GetRepLen1Price(p, state, posState);
+      if (shortRepPrice <= nextOpt->price)
+      {
+        nextOpt->price = shortRepPrice;
+        nextOpt->posPrev = cur;
+        MakeAsShortRep(nextOpt)
+        nextIsChar = True;
+      }
+    }
+    numAvailFull = p->numAvail;
+    {
+      UInt32 temp = kNumOpts - 1 - cur;
+      if (temp < numAvailFull)
+        numAvailFull = temp;
+    }
+
+    if (numAvailFull < 2)
+      continue;
+    numAvail = (numAvailFull <= p->numFastBytes ? numAvailFull : p->numFastBytes);
+
+    /* Literal followed by a rep0 match. */
+    if (!nextIsChar && matchByte != curByte)
+    {
+      UInt32 temp;
+      UInt32 lenTest2;
+      const Byte *data2 = data - (reps[0] + 1);
+      UInt32 limit = p->numFastBytes + 1;
+      if (limit > numAvailFull)
+        limit = numAvailFull;
+
+      for (temp = 1; temp < limit && data[temp] == data2[temp]; temp++) {}
+      lenTest2 = temp - 1;
+      if (lenTest2 >= 2)
+      {
+        UInt32 state2 = kLiteralNextStates[state];
+        UInt32 posStateNext = (position + 1) & p->pbMask;
+        UInt32 nextRepMatchPrice = curAnd1Price +
+            GET_PRICE_1(p->isMatch[state2][posStateNext]) +
+            GET_PRICE_1(p->isRep[state2]);
+        UInt32 curAndLenPrice;
+        COptimal *opt;
+        UInt32 offset = cur + 1 + lenTest2;
+        while (lenEnd < offset)
+          p->opt[++lenEnd].price = kInfinityPrice;
+        curAndLenPrice = nextRepMatchPrice + GetRepPrice(p, 0, lenTest2, state2, posStateNext);
+        opt = &p->opt[offset];
+        if (curAndLenPrice < opt->price)
+        {
+          opt->price = curAndLenPrice;
+          opt->posPrev = cur + 1;
+          opt->backPrev = 0;
+          opt->prev1IsChar = True;
+          opt->prev2 = False;
+        }
+      }
+    }
+
+    startLen = 2;
+    {
+      UInt32 repIndex;
+      for (repIndex = 0; repIndex < kNumReps; repIndex++)
+      {
+        UInt32 lenTest;
+        UInt32 lenTestTemp;
+        UInt32 price;
+        const Byte *data2 = data - (reps[repIndex] + 1);
+        if (data[0] != data2[0] || data[1] != data2[1])
+          continue;
+        for (lenTest = 2; lenTest < numAvail && data[lenTest] == data2[lenTest]; lenTest++) {}
+        while (lenEnd < cur + lenTest)
+          p->opt[++lenEnd].price = kInfinityPrice;
+        lenTestTemp = lenTest;
+        price = repMatchPrice + GetPureRepPrice(p, repIndex, state, posState);
+        do
+        {
+          UInt32 curAndLenPrice = price + p->repLenEnc.prices[posState][lenTest - 2];
+          COptimal *opt = &p->opt[cur + lenTest];
+          if (curAndLenPrice < opt->price)
+          {
+            opt->price = curAndLenPrice;
+            opt->posPrev = cur;
+            opt->backPrev = repIndex;
+            opt->prev1IsChar = False;
+          }
+        }
+        while (--lenTest >= 2);
+        lenTest = lenTestTemp;
+
+        if (repIndex == 0)
+          startLen = lenTest + 1;
+
+        /* Rep match, literal, rep0 match. */
+        {
+          UInt32 lenTest2 = lenTest + 1;
+          UInt32 limit = lenTest2 + p->numFastBytes;
+          if (limit > numAvailFull)
+            limit = numAvailFull;
+          for (; lenTest2 < limit && data[lenTest2] == data2[lenTest2]; lenTest2++) {}
+          lenTest2 -= lenTest + 1;
+          if (lenTest2 >= 2)
+          {
+            UInt32 nextRepMatchPrice;
+            UInt32 state2 = kRepNextStates[state];
+            UInt32 posStateNext = (position + lenTest) & p->pbMask;
+            UInt32 curAndLenCharPrice =
+                price + p->repLenEnc.prices[posState][lenTest - 2] +
+                GET_PRICE_0(p->isMatch[state2][posStateNext]) +
+                LitEnc_GetPriceMatched(LIT_PROBS(position + lenTest, data[lenTest - 1]),
+                    data[lenTest], data2[lenTest], p->ProbPrices);
+            UInt32 curAndLenPrice;
+            COptimal *opt;
+            UInt32 offset = cur + lenTest + 1 + lenTest2;
+            state2 = kLiteralNextStates[state2];
+            posStateNext = (position + lenTest + 1) & p->pbMask;
+            nextRepMatchPrice = curAndLenCharPrice +
+                GET_PRICE_1(p->isMatch[state2][posStateNext]) +
+                GET_PRICE_1(p->isRep[state2]);
+            while (lenEnd < offset)
+              p->opt[++lenEnd].price = kInfinityPrice;
+            curAndLenPrice = nextRepMatchPrice + GetRepPrice(p, 0, lenTest2, state2, posStateNext);
+            opt = &p->opt[offset];
+            if (curAndLenPrice < opt->price)
+            {
+              opt->price = curAndLenPrice;
+              opt->posPrev = cur + lenTest + 1;
+              opt->backPrev = 0;
+              opt->prev1IsChar = True;
+              opt->prev2 = True;
+              opt->posPrev2 = cur;
+              opt->backPrev2 = repIndex;
+            }
+          }
+        }
+      }
+    }
+
+    if (newLen > numAvail)
+    {
+      newLen = numAvail;
+      for (numPairs = 0; newLen > matches[numPairs]; numPairs += 2) {}
+      matches[numPairs] = newLen;
+      numPairs += 2;
+    }
+    if (newLen >= startLen)
+    {
+      UInt32 offs, curBack;
+      UInt32 lenTest;
+      normalMatchPrice = matchPrice + GET_PRICE_0(p->isRep[state]);
+      while (lenEnd < cur + newLen)
+        p->opt[++lenEnd].price = kInfinityPrice;
+
+      offs = 0;
+      while (startLen > matches[offs])
+        offs += 2;
+      curBack = matches[offs + 1];
+      for (lenTest = startLen; ; lenTest++)
+      {
+        UInt32 curAndLenPrice = normalMatchPrice + p->lenEnc.prices[posState][lenTest - kMatchMinLen] +
+            GetMatchPrice(p, curBack, lenTest);
+        COptimal *opt = &p->opt[cur + lenTest];
+        if (curAndLenPrice < opt->price)
+        {
+          opt->price = curAndLenPrice;
+          opt->posPrev = cur;
+          opt->backPrev = curBack + kNumReps;
+          opt->prev1IsChar = False;
+        }
+
+        if (lenTest == matches[offs])
+        {
+          /* Match, literal, rep0 match. */
+          const Byte *data2 = data - (curBack + 1);
+          UInt32 lenTest2 = lenTest + 1;
+          UInt32 limit = lenTest2 + p->numFastBytes;
+          if (limit > numAvailFull)
+            limit = numAvailFull;
+          for (; lenTest2 < limit && data[lenTest2] == data2[lenTest2]; lenTest2++) {}
+          lenTest2 -= lenTest + 1;
+          if (lenTest2 >= 2)
+          {
+            UInt32 nextRepMatchPrice;
+            UInt32 state2 = kMatchNextStates[state];
+            UInt32 posStateNext = (position + lenTest) & p->pbMask;
+            UInt32 curAndLenCharPrice = curAndLenPrice +
+                GET_PRICE_0(p->isMatch[state2][posStateNext]) +
+                LitEnc_GetPriceMatched(LIT_PROBS(position + lenTest, data[lenTest - 1]),
+                    data[lenTest], data2[lenTest], p->ProbPrices);
+            UInt32 offset = cur + lenTest + 1 + lenTest2;
+            UInt32 curAndLenPrice2;
+            COptimal *opt2;
+            state2 = kLiteralNextStates[state2];
+            posStateNext = (posStateNext + 1) & p->pbMask;
+            nextRepMatchPrice = curAndLenCharPrice +
+                GET_PRICE_1(p->isMatch[state2][posStateNext]) +
+                GET_PRICE_1(p->isRep[state2]);
+            while (lenEnd < offset)
+              p->opt[++lenEnd].price = kInfinityPrice;
+            curAndLenPrice2 = nextRepMatchPrice + GetRepPrice(p, 0, lenTest2, state2, posStateNext);
+            opt2 = &p->opt[offset];
+            if (curAndLenPrice2 < opt2->price)
+            {
+              opt2->price = curAndLenPrice2;
+              opt2->posPrev = cur + lenTest + 1;
+              opt2->backPrev = 0;
+              opt2->prev1IsChar = True;
+              opt2->prev2 = True;
+              opt2->posPrev2 = cur;
+              opt2->backPrev2 = curBack + kNumReps;
+            }
+          }
+          offs += 2;
+          if (offs == numPairs)
+            break;
+          curBack = matches[offs + 1];
+        }
+      }
+    }
+  }
+}
+
+/* True if a match at bigDist is not worth one byte over one at smallDist. */
+#define ChangePair(smallDist, bigDist) (((bigDist) >> 7) > (smallDist))
+
+/* Greedy parsing with one byte of lookahead, for the fast levels. */
+static UInt32 GetOptimumFast(CLzmaEnc *p, UInt32 *backRes)
+{
+  UInt32 numAvail, mainLen, mainDist, numPairs, repIndex, repLen, i;
+  const Byte *data;
+  const UInt32 *matches;
+
+  if (p->additionalOffset == 0)
+    mainLen = ReadMatchDistances(p, &numPairs);
+  else
+  {
+    mainLen = p->longestMatchLength;
+    numPairs = p->numPairs;
+  }
+
+  numAvail = p->numAvail;
+  *backRes = (UInt32)-1;
+  if (numAvail < 2)
+    return 1;
+  if (numAvail > kMatchMaxLen)
+    numAvail = kMatchMaxLen;
+  data = MatchFinder_GetPointerToCurrentPos(&p->matchFinder) - 1;
+
+  repLen = repIndex = 0;
+  for (i = 0; i < kNumReps; i++)
+  {
+    UInt32 len;
+    const Byte *data2 = data - (p->reps[i] + 1);
+    if (data[0] != data2[0] || data[1] != data2[1])
+      continue;
+    for (len = 2; len < numAvail && data[len] == data2[len]; len++) {}
+    if (len >= p->numFastBytes)
+    {
+      *backRes = i;
+      MovePos(p, len - 1);
+      return len;
+    }
+    if (len > repLen)
+    {
+      repIndex = i;
+      repLen = len;
+    }
+  }
+
+  matches = p->matches;
+  if (mainLen >= p->numFastBytes)
+  {
+    *backRes = matches[numPairs - 1] + kNumReps;
+    MovePos(p, mainLen - 1);
+    return mainLen;
+  }
+
+  mainDist = 0;
+  if (mainLen >= 2)
+  {
+    mainDist = matches[numPairs - 1];
+    while (numPairs > 2 && mainLen == matches[numPairs - 4] + 1)
+    {
+      if (!ChangePair(matches[numPairs - 3], mainDist))
+        break;
+      numPairs -= 2;
+      mainLen = matches[numPairs - 2];
+      mainDist = matches[numPairs - 1];
+    }
+    if (mainLen == 2 && mainDist >= 0x80)
+      mainLen = 1;
+  }
+
+  if (repLen >= 2 && (
+        (repLen + 1 >= mainLen) ||
+        (repLen + 2 >= mainLen && mainDist >= (1 << 9)) ||
+        (repLen + 3 >= mainLen && mainDist >= (1 << 15))))
+  {
+    *backRes = repIndex;
+    MovePos(p, repLen - 1);
+    return repLen;
+  }
+
+  if (mainLen < 2 || numAvail <= 2)
+    return 1;
+
+  /* Emit a literal instead if the next byte starts a better match. */
+  p->longestMatchLength = ReadMatchDistances(p, &p->numPairs);
+  if (p->longestMatchLength >= 2)
+  {
+    UInt32 newDistance = matches[p->numPairs - 1];
+    if ((p->longestMatchLength >= mainLen && newDistance < mainDist) ||
+        (p->longestMatchLength == mainLen + 1 && !ChangePair(mainDist, newDistance)) ||
+        (p->longestMatchLength > mainLen + 1) ||
+        (p->longestMatchLength + 1 >= mainLen && mainLen >= 3 && ChangePair(newDistance, mainDist)))
+      return 1;
+  }
+
+  data = MatchFinder_GetPointerToCurrentPos(&p->matchFinder) - 1;
+  for (i = 0; i < kNumReps; i++)
+  {
+    UInt32 len, limit;
+    const Byte *data2 = data - (p->reps[i] + 1);
+    if (data[0] != data2[0] || data[1] != data2[1])
+      continue;
+    limit = mainLen - 1;
+    for (len = 2; len < limit && data[len] == data2[len]; len++) {}
+    if (len >= limit)
+      return 1;
+  }
+  *backRes = mainDist + kNumReps;
+  MovePos(p, mainLen - 2);
+  return mainLen;
+}
+
+static void LzmaEnc_EncodeMatch(CLzmaEnc *p, UInt32 dist, UInt32 len, unsigned posState)
+{
+  CRangeEnc *rc = &p->rc;
+  unsigned posSlot = GetPosSlot(dist);
+
+  RangeEnc_EncodeBit(rc, &p->isMatch[p->state][posState], 1);
+  RangeEnc_EncodeBit(rc, &p->isRep[p->state], 0);
+  p->state = kMatchNextStates[p->state];
+  LenEnc_Encode2(&p->lenEnc, rc, len - kMatchMinLen, posState, !p->fastMode, p->ProbPrices);
+  RcTree_Encode(rc, p->posSlotEncoder[GetLenToPosState(len)], kNumPosSlotBits, posSlot);
+
+  if (posSlot >= kStartPosModelIndex)
+  {
+    unsigned footerBits = (posSlot >> 1) - 1;
+    UInt32 base = (UInt32)(2 | (posSlot & 1)) << footerBits;
+    UInt32 posReduced = dist - base;
+    if (posSlot < kEndPosModelIndex)
+      RcTree_ReverseEncode(rc, p->posEncoders + base - posSlot - 1, footerBits, posReduced);
+    else
+    {
+      RangeEnc_EncodeDirectBits(rc, posReduced >> kNumAlignBits, footerBits - kNumAlignBits);
+      RcTree_ReverseEncode(rc, p->posAlignEncoder, kNumAlignBits, posReduced & kAlignMask);
+      p->alignPriceCount++;
+    }
+  }
+
+  p->reps[3] = p->reps[2];
+  p->reps[2] = p->reps[1];
+  p->reps[1] = p->reps[0];
+  p->reps[0] = dist;
+  p->matchPriceCount++;
+}
+
+/* len == 1 codes a short rep: one byte from reps[0]. */
+static void LzmaEnc_EncodeRep(CLzmaEnc *p, unsigned repIndex, UInt32 len, unsigned posState)
+{
+  CRangeEnc *rc = &p->rc;
+  RangeEnc_EncodeBit(rc, &p->isMatch[p->state][posState], 1);
+  RangeEnc_EncodeBit(rc, &p->isRep[p->state], 1);
+  if (repIndex == 0)
+  {
+    RangeEnc_EncodeBit(rc, &p->isRepG0[p->state], 0);
+    RangeEnc_EncodeBit(rc, &p->isRep0Long[p->state][posState], len == 1 ? 0 : 1);
+  }
+  else
+  {
+    UInt32 dist = p->reps[repIndex];
+    RangeEnc_EncodeBit(rc, &p->isRepG0[p->state], 1);
+    if (repIndex == 1)
+      RangeEnc_EncodeBit(rc, &p->isRepG1[p->state], 0);
+    else
+    {
+      RangeEnc_EncodeBit(rc, &p->isRepG1[p->state], 1);
+      RangeEnc_EncodeBit(rc, &p->isRepG2[p->state], repIndex - 2);
+      if (repIndex == 3)
+        p->reps[3] = p->reps[2];
+      p->reps[2] = p->reps[1];
+    }
+    p->reps[1] = p->reps[0];
+    p->reps[0] = dist;
+  }
+
+  if (len == 1)
+    p->state = kShortRepNextStates[p->state];
+  else
+  {
+    LenEnc_Encode2(&p->repLenEnc, rc, len - kMatchMinLen, posState, !p->fastMode, p->ProbPrices);
+    p->state = kRepNextStates[p->state];
+  }
+}
+
+static SRes LzmaEnc_EncodeAll(CLzmaEnc *p, const Byte *src, UInt32 srcLen,
+    int writeEndMark, ICompressProgress *progress)
+{
+  UInt32 nowPos32 = 0;
+  UInt32 nextProgress = kProgressInterval;
+
+  if (srcLen != 0)
+  {
+    UInt32 numPairs;
+    ReadMatchDistances(p, &numPairs);
+    RangeEnc_EncodeBit(&p->rc, &p->isMatch[0][0], 0);
+    LitEnc_Encode(&p->rc, p->litProbs, src[0]);
+    p->state = kLiteralNextStates[p->state];
+    p->additionalOffset--;
+    nowPos32++;
+  }
+
+  while (nowPos32 < srcLen)
+  {
+    UInt32 pos, len;
+    unsigned posState;
+    if (p->fastMode)
+      len = GetOptimumFast(p, &pos);
+    else
+      len = GetOptimum(p, nowPos32, &pos);
+    posState = (unsigned)(nowPos32 & p->pbMask);
+
+    if (len == 1 && pos == (UInt32)-1)
+    {
+      const Byte *data = src + nowPos32;
+      CLzmaProb *probs = LIT_PROBS(nowPos32, data[-1]);
+      RangeEnc_EncodeBit(&p->rc, &p->isMatch[p->state][posState], 0);
+      if (IsCharState(p->state))
+        LitEnc_Encode(&p->rc, probs, *data);
+      else
+        LitEnc_EncodeMatched(&p->rc, probs, *data, data[-(ptrdiff_t)p->reps[0] - 1]);
+      p->state = kLiteralNextStates[p->state];
+    }
+    else if (pos < kNumReps)
+      LzmaEnc_EncodeRep(p, pos, len, posState);
+    else
+      LzmaEnc_EncodeMatch(p, pos - kNumReps, len, posState);
+
+    p->additionalOffset -= len;
+    nowPos32 += len;
+    if (p->additionalOffset == 0 && !p->fastMode)
+    {
+      if (p->matchPriceCount >= (1 << 7))
+        FillDistancesPrices(p);
+      if (p->alignPriceCount >= kAlignTableSize)
+        FillAlignPrices(p);
+    }
+
+    if (p->rc.overflow)
+      return SZ_ERROR_OUTPUT_EOF;
+    if (progress && nowPos32 >= nextProgress)
+    {
+      nextProgress = nowPos32 + kProgressInterval;
+      if (ICompressProgress_Progress(progress, nowPos32, (UInt64)(p->rc.buf - p->rc.bufBase)) != SZ_OK)
+        return SZ_ERROR_PROGRESS;
+    }
+  }
+
+  if (writeEndMark)
+    LzmaEnc_EncodeMatch(p, 0xFFFFFFFF, kMatchMinLen, (unsigned)(nowPos32 & p->pbMask));
+  RangeEnc_FlushData(&p->rc);
+  return p->rc.overflow ? SZ_ERROR_OUTPUT_EOF : SZ_OK;
+}
+
+SRes LzmaEncode(Byte *dest, SizeT *destLen, const Byte *src, SizeT srcLen,
+    const CLzmaEncProps *props, Byte *propsEncoded, SizeT *propsSize,
+    int writeEndMark, ICompressProgress *progress,
+    ISzAllocPtr alloc, ISzAllocPtr allocBig)
+{
+  CLzmaEnc *p;
+  CMatchFinder *mf;
+  CLzmaEncProps normalized = *props;
+  UInt32 historySize;
+  size_t hashSize;
+  SRes res;
+  unsigned i;
+
+  LzmaEncProps_Normalize(&normalized);
+  if (*propsSize < LZMA_PROPS_SIZE
+      || (UInt64)srcLen > ((UInt32)1 << 31)
+      || normalized.lc > 8 || normalized.lp > 4 || normalized.pb > 4
+      || normalized.dictSize < ((UInt32)1 << 12)
+      || normalized.dictSize > ((UInt32)1 << 27))
+    return SZ_ERROR_PARAM;
+
+  p = (CLzmaEnc *)ISzAlloc_Alloc(alloc, sizeof(CLzmaEnc));
+  if (!p)
+    return SZ_ERROR_MEM;
+  memset(p, 0, sizeof(*p));
+  p->lc = (unsigned)normalized.lc;
+  p->lp = (unsigned)normalized.lp;
+  p->pb = (unsigned)normalized.pb;
+  p->lpMask = ((UInt32)1 << p->lp) - 1;
+  p->pbMask = ((UInt32)1 << p->pb) - 1;
+  p->fastMode = (normalized.algo == 0);
+  p->numFastBytes = (UInt32)(normalized.fb < 5 ? 5 :
+      (normalized.fb > kMatchMaxLen ? kMatchMaxLen : normalized.fb));
+  for (i = 0; i < kDicLogSizeMax; i++)
+    if (normalized.dictSize <= ((UInt32)1 << i))
+      break;
+  p->distTableSize = i * 2;
+
+  propsEncoded[0] = (Byte)((p->pb * 5 + p->lp) * 9 + p->lc);
+  for (i = 0; i < 4; i++)
+    propsEncoded[1 + i] = (Byte)(normalized.dictSize >> (8 * i));
+  *propsSize = LZMA_PROPS_SIZE;
+
+  /* Matches never reach further back than the start of the input. */
+  historySize = normalized.dictSize;
+  if (historySize > (UInt32)srcLen)
+    historySize = (UInt32)srcLen;
+  if (historySize == 0)
+    historySize = 1;
+  mf = &p->matchFinder;
+  mf->cyclicBufferSize = historySize + 1;
+  mf->matchMaxLen = p->numFastBytes;
+  mf->cutValue = normalized.mc;
+  hashSize = MatchFinder_HashSize(historySize);
+  mf->hashMask = (UInt32)hashSize - 1;
+
+  p->litProbs = (CLzmaProb *)ISzAlloc_Alloc(alloc, ((size_t)0x300 << (p->lc + p->lp)) * sizeof(CLzmaProb));
+  mf->hash = (UInt32 *)ISzAlloc_Alloc(allocBig, (kFix4HashSize + hashSize) * sizeof(UInt32));
+  mf->son = (UInt32 *)ISzAlloc_Alloc(allocBig, (size_t)mf->cyclicBufferSize * 2 * sizeof(UInt32));
+  if (!p->litProbs || !mf->hash || !mf->son)
+    res = SZ_ERROR_MEM;
+  else
+  {
+    memset(mf->hash, 0, (kFix4HashSize + hashSize) * sizeof(UInt32));
+    MatchFinder_Init(mf, src, (UInt32)srcLen);
+    LzmaEnc_InitProbs(p);
+    LzmaEnc_InitPriceTables(p->ProbPrices);
+    if (!p->fastMode)
+    {
+      FillDistancesPrices(p);
+      FillAlignPrices(p);
+    }
+    p->lenEnc.tableSize = p->repLenEnc.tableSize = p->numFastBytes + 1 - kMatchMinLen;
+    LenPriceEnc_UpdateTables(&p->lenEnc, 1u << p->pb, p->ProbPrices);
+    LenPriceEnc_UpdateTables(&p->repLenEnc, 1u << p->pb, p->ProbPrices);
+    RangeEnc_Init(&p->rc, dest, *destLen);
+    res = LzmaEnc_EncodeAll(p, src, (UInt32)srcLen, writeEndMark, progress);
+    *destLen = (SizeT)(p->rc.buf - dest);
+  }
+
+  ISzAlloc_Free(alloc, p->litProbs);
+  ISzAlloc_Free(allocBig, mf->hash);
+  ISzAlloc_Free(allocBig, mf->son);
+  ISzAlloc_Free(alloc, p);
+  return res;
+}
@@ -0,0 +1,57 @@
+/* LzmaEnc.h -- LZMA Encoder
+Compact encoder with the LZMA SDK interface, written for osu-replay to pair
+with LzmaDec.c. Public domain, like the rest of this directory. */
+
+#ifndef __LZMA_ENC_H
+#define __LZMA_ENC_H
+
+#include "7zTypes.h"
+
+EXTERN_C_BEGIN
+
+#define LZMA_PROPS_SIZE 5
+
+typedef struct _CLzmaEncProps
+{
+  int level;       /* 0 <= level <= 9 */
+  UInt32 dictSize; /* (1 << 12) <= dictSize <= (1 << 27)
+                      default = (1 << 24) */
+  UInt64 reduceSize; /* estimated size of data that will be compressed.
+                        default = (UInt64)(Int64)-1.
+                        Encoder uses this value to reduce dictionary size */
+  int lc;          /* 0 <= lc <= 8, default = 3 */
+  int lp;          /* 0 <= lp <= 4, default = 0 */
+  int pb;          /* 0 <= pb <= 4, default = 2 */
+  int algo;        /* 0 - fast, 1 - normal, default = (level < 5 ? 0 : 1) */
+  int fb;          /* 5 <= fb <= 273, default = 32 */
+  UInt32 mc;       /* 1 <= mc <= (1 << 30), default = 16 + fb / 2 */
+} CLzmaEncProps;
+
+void LzmaEncProps_Init(CLzmaEncProps *p);
+void LzmaEncProps_Normalize(CLzmaEncProps *p);
+
+
+/* ---------- One Call Interface ---------- */
+
+/* LzmaEncode
+   The whole input is kept addressable, so the match finder indexes it in
+   place instead of copying it into a sliding window. Matches come from a
+   binary tree (bt4, mc nodes visited per position). algo 1 picks them with
+   the optimal parser, algo 0 greedily with one byte of lookahead.
+
+Returns:
+  SZ_OK               - OK
+  SZ_ERROR_MEM        - Memory allocation error
+  SZ_ERROR_PARAM      - Incorrect parameter
+  SZ_ERROR_OUTPUT_EOF - output buffer overflow
+  SZ_ERROR_PROGRESS   - some break from progress callback
+*/
+
+SRes LzmaEncode(Byte *dest, SizeT *destLen, const Byte *src, SizeT srcLen,
+    const CLzmaEncProps *props, Byte *propsEncoded, SizeT *propsSize,
+    int writeEndMark, ICompressProgress *progress,
+    ISzAllocPtr alloc, ISzAllocPtr allocBig);
+
+EXTERN_C_END
+
+#endif
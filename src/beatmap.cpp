@@ -1,29 +1,74 @@
 #include "beatmap.hpp"
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <mutex>
 
 namespace osrp {
 
-Beatmap::Beatmap(const fs::path& path) : path(path) {
+namespace {
+bool PropertyLess(KeyValueSection sectionA, std::string_view keyA,
+                  KeyValueSection sectionB, std::string_view keyB) {
+  return sectionA != sectionB ? sectionA < sectionB : keyA < keyB;
+}
+
+// Calls func with every line of data, without the line terminator.
+template <typename Func>
+void ForEachLine(std::string_view data, Func func) {
+  while (!data.empty()) {
+    auto indexOfNewline = data.find('\n');
+    func(data.substr(0, indexOfNewline));
+    if (indexOfNewline == std::string_view::npos) break;
+    data.remove_prefix(indexOfNewline + 1);
+  }
+}
+}  // namespace
+
+Beatmap::Beatmap() : lazySections(std::make_unique<LazySections>()) {}
+
+Beatmap::Beatmap(const fs::path& path, BeatmapLoading loading)
+    : path(path), file(path), lazySections(std::make_unique<LazySections>()) {
   enum class SectionType { NO_SECTION, KEY_VALUE, COMMA_SEPARATED };
 
   SectionType currentSection = SectionType::NO_SECTION;
   KeyValueSection currentKVSection = KeyValueSection::GENERAL;
-  CommaSeparatedSection currentCSSection = CommaSeparatedSection::EVENTS;
   std::optional<std::string> mapVersion;
 
-  ReadLines(path, [&](const std::string_view& line) {
-    const auto trimmed = TrimWhitespace(line);
-    if (trimmed.empty()) return;
+  std::string_view data(reinterpret_cast<const char*>(file.Data()),
+                        file.Size());
+  constexpr std::string_view BOM = "\xEF\xBB\xBF";
+  if (data.substr(0, BOM.size()) == BOM) data.remove_prefix(BOM.size());
+
+  while (!data.empty()) {
+    auto indexOfNewline = data.find('\n');
+    const auto trimmed = TrimWhitespace(data.substr(0, indexOfNewline));
+    data.remove_prefix(indexOfNewline == std::string_view::npos
+                           ? data.size()
+                           : indexOfNewline + 1);
+    if (trimmed.empty()) continue;
+
     if (trimmed[0] == '[') {
       const auto section = trimmed.substr(1, trimmed.size() - 2);
       auto setKV = [&](KeyValueSection s) {
         currentSection = SectionType::KEY_VALUE;
         currentKVSection = s;
       };
+      // Comma separated sections are only located here. Their lines are
+      // parsed by LoadSection once something asks for them.
       auto setCS = [&](CommaSeparatedSection s) {
         currentSection = SectionType::COMMA_SEPARATED;
-        currentCSSection = s;
+        // An empty section is directly followed by the next header.
+        size_t end = 0;
+        if (data.substr(0, 1) != "[") {
+          auto indexOfNextSection = data.find("\n[");
+          end = indexOfNextSection == std::string_view::npos
+                    ? data.size()
+                    : indexOfNextSection + 1;
+        }
+        lazySections->text[static_cast<size_t>(s)].push_back(
+            data.substr(0, end));
+        data.remove_prefix(end);
       };
       if (section == "General") {
         setKV(KeyValueSection::GENERAL);
@@ -58,25 +103,32 @@ Beatmap::Beatmap(const fs::path& path) : path(path) {
           if (indexOfFirstColon != std::string_view::npos) {
             auto key = TrimWhitespace(trimmed.substr(0, indexOfFirstColon));
             auto value = TrimWhitespace(trimmed.substr(indexOfFirstColon + 1));
-            SetPropertyString(currentKVSection, key, value);
+            properties.push_back(Property{currentKVSection, key, value});
           }
           break;
         }
-        case SectionType::COMMA_SEPARATED: {
-          size_t begin = 0;
-          size_t indexOfComma;
-          std::vector<std::string> v;
-          while ((indexOfComma = trimmed.find(',', begin)) !=
-                 std::string_view::npos) {
-            v.push_back(std::string(trimmed.substr(begin, indexOfComma)));
-            begin = indexOfComma + 1;
-          }
-          v.push_back(std::string(trimmed.substr(begin)));
-          commaSeparatedSections[currentCSSection].push_back(v);
-        }
+        case SectionType::COMMA_SEPARATED:
+          break;
       }
     }
-  });
+  }
+
+  // Later duplicates of a key win, as they would with repeated assignment.
+  std::stable_sort(properties.begin(), properties.end(),
+                   [](const Property& a, const Property& b) {
+                     return PropertyLess(a.section, a.key, b.section, b.key);
+                   });
+  auto last = std::unique(properties.rbegin(), properties.rend(),
+                          [](const Property& a, const Property& b) {
+                            return a.section == b.section && a.key == b.key;
+                          });
+  properties.erase(properties.begin(), last.base());
+
+  if (loading == BeatmapLoading::EAGER) {
+    LoadSection(CommaSeparatedSection::EVENTS);
+    LoadSection(CommaSeparatedSection::TIMING_POINTS);
+    LoadSection(CommaSeparatedSection::HIT_OBJECTS);
+  }
 
   if (!mapVersion.has_value()) {
     version = "14";
@@ -87,6 +139,112 @@ Beatmap::Beatmap(const fs::path& path) : path(path) {
   }
 }
 
+void Beatmap::LoadSection(CommaSeparatedSection section) const {
+  auto index = static_cast<size_t>(section);
+  std::call_once(lazySections->loaded[index], [&]() {
+    // A missing or empty [Events] section still has (no) rows.
+    if (section == CommaSeparatedSection::EVENTS) {
+      commaSeparatedSections[section];
+    }
+    for (const auto& text : lazySections->text[index]) {
+      ForEachLine(text, [&](const std::string_view& line) {
+        const auto trimmed = TrimWhitespace(line);
+        if (trimmed.empty()) return;
+        if (section == CommaSeparatedSection::HIT_OBJECTS) {
+          if (!hitObjects.Parse(trimmed)) {
+            std::cerr << "Invalid hit object: " << trimmed << std::endl;
+          }
+        } else if (section == CommaSeparatedSection::TIMING_POINTS) {
+          if (auto point = ParseTimingPoint(trimmed); point.HasValue()) {
+            timingPoints.push_back(point.Value());
+          } else {
+            std::cerr << "Invalid timing point: " << trimmed << std::endl;
+          }
+        } else {
+          std::vector<std::string_view> v;
+          Split(trimmed, ',',
+                [&](const std::string_view& value) { v.push_back(value); });
+          commaSeparatedSections[section].push_back(v);
+        }
+      });
+    }
+    if (section == CommaSeparatedSection::TIMING_POINTS) {
+      std::stable_sort(timingPoints.begin(), timingPoints.end(),
+                       [](const TimingPoint& a, const TimingPoint& b) {
+                         return a.time < b.time;
+                       });
+    }
+  });
+}
+
+const HitObjectList& Beatmap::GetHitObjects() const {
+  LoadSection(CommaSeparatedSection::HIT_OBJECTS);
+  return hitObjects;
+}
+
+HitObjectSummary Beatmap::SummarizeHitObjects() const {
+  HitObjectSummary summary;
+  auto index = static_cast<size_t>(CommaSeparatedSection::HIT_OBJECTS);
+  // Maps read from a cache have no section text, only parsed objects.
+  if (lazySections->text[index].empty()) {
+    for (const auto& object : GetHitObjects().objects) {
+      summary.count++;
+      summary.lastEndTime = std::max(summary.lastEndTime, object.endTime);
+    }
+    return summary;
+  }
+  for (const auto& text : lazySections->text[index]) {
+    ForEachLine(text, [&](const std::string_view& line) {
+      const auto trimmed = TrimWhitespace(line);
+      if (trimmed.empty()) return;
+      if (auto endTime = ParseHitObjectEndTime(trimmed); endTime.HasValue()) {
+        summary.count++;
+        summary.lastEndTime = std::max(summary.lastEndTime, endTime.Value());
+      }
+    });
+  }
+  return summary;
+}
+
+const std::vector<TimingPoint>& Beatmap::GetTimingPoints() const {
+  LoadSection(CommaSeparatedSection::TIMING_POINTS);
+  return timingPoints;
+}
+
+const TimingTimeline& Beatmap::GetTimingTimeline() const {
+  std::call_once(lazySections->timingTimelineBuilt, [&]() {
+    timingTimeline = TimingTimeline(GetTimingPoints());
+  });
+  return timingTimeline;
+}
+
+const SliderPaths& Beatmap::GetSliderPaths() const {
+  std::call_once(lazySections->sliderPathsBuilt, [&]() {
+    sliderPaths = SliderPaths(GetHitObjects());
+  });
+  return sliderPaths;
+}
+
+int Beatmap::GetFormatVersion() const {
+  auto digits = version.find_first_of("0123456789");
+  if (digits == std::string::npos) return 14;
+  return std::atoi(version.c_str() + digits);
+}
+
+const ModdedBeatmap& Beatmap::GetModded(int32_t mods) const {
+  mods &= DIFFICULTY_MODS;
+  std::lock_guard<std::mutex> lock(lazySections->moddedMutex);
+  auto& modded = lazySections->modded[mods];
+  if (!modded) modded = std::make_unique<ModdedBeatmap>(*this, mods);
+  return *modded;
+}
+
+const Md5Digest& Beatmap::GetMD5() const {
+  std::call_once(lazySections->md5Computed,
+                 [&]() { md5 = ComputeMD5(file.Data(), file.Size()); });
+  return md5;
+}
+
 struct BeatmapPropertyNotFound : public std::error_category {
   const char* name() const noexcept override {
     return "beatmap_property_not_found";
@@ -98,29 +256,44 @@ const BeatmapPropertyNotFound bpnfCategory;
 
 Result<std::string_view> Beatmap::GetPropertyString(
     KeyValueSection section, const std::string_view& key) const {
-  auto it = keyValueSections.find(section);
-  if (it == keyValueSections.end()) {
+  auto sectionBegin = std::lower_bound(
+      properties.begin(), properties.end(), section,
+      [](const Property& p, KeyValueSection s) { return p.section < s; });
+  if (sectionBegin == properties.end() || sectionBegin->section != section) {
     throw std::logic_error("invalid section");
+  }
+  auto it = std::lower_bound(sectionBegin, properties.end(), key,
+                             [&](const Property& p, std::string_view k) {
+                               return PropertyLess(p.section, p.key, section,
+                                                   k);
+                             });
+  if (it == properties.end() || it->section != section || it->key != key) {
+    return Result<std::string_view>(std::error_code(1, bpnfCategory));
   } else {
-    const auto& map = it->second;
-    auto it2 = map.find(std::string(key));
-    if (it2 == map.end()) {
-      return Result<std::string_view>(std::error_code(1, bpnfCategory));
-    } else {
-      return Result<std::string_view>(it2->second);
-    }
+    return Result<std::string_view>(it->value);
   }
 }
 
 void Beatmap::SetPropertyString(KeyValueSection section,
                                 const std::string_view& key,
                                 const std::string_view& value) {
-  keyValueSections[section][std::string(key)] = value;
+  auto it = std::lower_bound(properties.begin(), properties.end(), key,
+                             [&](const Property& p, std::string_view k) {
+                               return PropertyLess(p.section, p.key, section,
+                                                   k);
+                             });
+  const auto& ownedValue = ownedStrings.emplace_back(value);
+  if (it != properties.end() && it->section == section && it->key == key) {
+    it->value = ownedValue;
+  } else {
+    const auto& ownedKey = ownedStrings.emplace_back(key);
+    properties.insert(it, Property{section, ownedKey, ownedValue});
+  }
 }
 
-const std::vector<std::vector<std::string>>& Beatmap::GetCommaSeparatedValues(
-    CommaSeparatedSection section) const {
-  auto it = commaSeparatedSections.find(section);
+const std::vector<std::vector<std::string_view>>& Beatmap::GetEvents() const {
+  LoadSection(CommaSeparatedSection::EVENTS);
+  auto it = commaSeparatedSections.find(CommaSeparatedSection::EVENTS);
   if (it == commaSeparatedSections.end()) {
     throw std::logic_error("invalid section");
   } else {
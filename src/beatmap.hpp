@@ -1,12 +1,21 @@
 #pragma once
 
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "hit_objects.hpp"
 #include "io.hpp"
+#include "md5.hpp"
+#include "modded_beatmap.hpp"
 #include "result.hpp"
+#include "slider_path.hpp"
+#include "timing_timeline.hpp"
 #include "strings.hpp"
 
 namespace osrp {
@@ -15,12 +24,38 @@ enum class KeyValueSection { GENERAL, EDITOR, METADATA, DIFFICULTY, COLORS };
 
 enum class CommaSeparatedSection { EVENTS, TIMING_POINTS, HIT_OBJECTS };
 
+enum class BeatmapLoading {
+  // Parse every section in the constructor.
+  EAGER,
+  // Parse the key-value sections up front and only locate [Events],
+  // [TimingPoints] and [HitObjects]; each is parsed on first access.
+  LAZY
+};
+
+struct HitObjectSummary {
+  uint32_t count = 0;
+  // Latest end time of any hit object, 0 if there are none.
+  int32_t lastEndTime = 0;
+};
+
+// Parsed .osu file. The file (or the cache it was loaded from) stays memory
+// mapped for the lifetime of the object and property values and [Events]
+// fields are views into it, so a Beatmap can be moved but not copied. Lazily
+// loaded sections are parsed at most once, also when several threads access
+// them concurrently.
 class Beatmap {
  public:
-  explicit Beatmap(const fs::path& path);
+  explicit Beatmap(const fs::path& path,
+                   BeatmapLoading loading = BeatmapLoading::EAGER);
+
+  Beatmap(const Beatmap&) = delete;
+  Beatmap& operator=(const Beatmap&) = delete;
+  Beatmap(Beatmap&&) = default;
+  Beatmap& operator=(Beatmap&&) = default;
 
   template <typename T = std::string_view>
-  Result<T> GetProperty(KeyValueSection section, const std::string_view& key) {
+  Result<T> GetProperty(KeyValueSection section,
+                        const std::string_view& key) const {
     auto string = GetPropertyString(section, key);
     return string.FlatMap(
         [](const std::string_view& str) { return ParseString<T>(str); });
@@ -32,21 +67,88 @@ class Beatmap {
     SetPropertyString(section, key, ToString(value));
   }
 
-  const std::vector<std::vector<std::string>>& GetCommaSeparatedValues(
-      CommaSeparatedSection section) const;
+  // Number from the "osu file format vN" header, 14 if it is missing.
+  int GetFormatVersion() const;
+
+  // Raw rows of [Events]. [TimingPoints] and [HitObjects] are only kept in
+  // their typed form, see GetTimingPoints and GetHitObjects, so there is no
+  // raw accessor for them. Empty if the map has no [Events] section.
+  const std::vector<std::vector<std::string_view>>& GetEvents() const;
+
+  const HitObjectList& GetHitObjects() const;
+  // Count and end of the hit objects. Reads only the time fields of each
+  // [HitObjects] line unless the section is parsed already.
+  HitObjectSummary SummarizeHitObjects() const;
+  // Sorted by time, in file order for equal times.
+  const std::vector<TimingPoint>& GetTimingPoints() const;
+  // Timing points compiled for lookups by time, built on first use.
+  const TimingTimeline& GetTimingTimeline() const;
+  // Flattened slider curves, built on first use.
+  const SliderPaths& GetSliderPaths() const;
+
+  // Difficulty settings and positions with mods applied, built once per
+  // combination of DIFFICULTY_MODS and shared by all callers.
+  const ModdedBeatmap& GetModded(int32_t mods) const;
+
+  // MD5 of the source .osu file, computed on first use.
+  const Md5Digest& GetMD5() const;
+
+  // Reads a binary snapshot written by WriteCache. Returns std::nullopt if
+  // it is missing, malformed or sourcePath changed since it was written.
+  static std::optional<Beatmap> ReadCache(const fs::path& path,
+                                          const fs::path& sourcePath);
+  // Writes every section, the slider paths and the source MD5, size and
+  // modification time. Lazily loaded sections are loaded first.
+  void WriteCache(const fs::path& path) const;
 
  private:
+  struct Property {
+    KeyValueSection section;
+    std::string_view key, value;
+  };
+
   fs::path path;
+  MappedFile file;
   std::string version;
 
-  std::map<KeyValueSection, std::map<std::string, std::string>>
-      keyValueSections;
-  std::map<CommaSeparatedSection, std::vector<std::vector<std::string>>>
+  // Sorted by (section, key) for binary search.
+  std::vector<Property> properties;
+  // Backing storage for values assigned through SetProperty. A deque never
+  // moves its elements, so views into it stay valid.
+  std::deque<std::string> ownedStrings;
+  struct LazySections {
+    // Text of each comma separated section, indexed by the enum value.
+    std::vector<std::string_view> text[3];
+    std::once_flag loaded[3];
+    std::once_flag sliderPathsBuilt, timingTimelineBuilt, md5Computed;
+    std::mutex moddedMutex;
+    std::map<int32_t, std::unique_ptr<ModdedBeatmap>> modded;
+  };
+  std::unique_ptr<LazySections> lazySections;
+
+  mutable std::map<CommaSeparatedSection,
+                   std::vector<std::vector<std::string_view>>>
       commaSeparatedSections;
+  mutable HitObjectList hitObjects;
+  mutable std::vector<TimingPoint> timingPoints;
+  mutable SliderPaths sliderPaths;
+  mutable TimingTimeline timingTimeline;
+  mutable Md5Digest md5{};
+
+  Beatmap();
+
+  void LoadSection(CommaSeparatedSection section) const;
 
   Result<std::string_view> GetPropertyString(KeyValueSection section,
                                              const std::string_view& key) const;
   void SetPropertyString(KeyValueSection section, const std::string_view& key,
                          const std::string_view& value);
 };
+
+// Loads path through a cache file in cacheDir named after the beatmap MD5,
+// parsing the .osu and writing the cache on a miss. md5Hex (e.g.
+// Replay::mapMd5 or a library record) saves hashing the file to find the
+// cache. If hit is non-null it receives whether the cache was used.
+Beatmap LoadBeatmapCached(const fs::path& path, const fs::path& cacheDir,
+                          bool* hit = nullptr, std::string_view md5Hex = {});
 }  // namespace osrp
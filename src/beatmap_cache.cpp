@@ -0,0 +1,335 @@
+#include <cstring>
+#include <type_traits>
+
+#include "beatmap.hpp"
+
+// Cache layout, native byte order (the cache is only read on the machine
+// that wrote it):
+//   "OSUC", u32 version
+//   source MD5, i64 source mtime (file_time_type ticks), u64 source size
+//   strings are u32 length + bytes, arrays u64 count + raw elements
+//   version string, u32 property count, (u8 section, key, value)...
+//   u8 has [Events], u32 row count, (u32 field count, fields...)...
+//   HitObject records (see WriteHitObject), curve point and SliderEdge
+//   arrays, TimingPoint records (see WriteTimingPoint)
+//   SliderPaths::Path and point arrays
+// There is no checksum: the source size and mtime catch stale files, enum
+// and bool fields are validated and the offsets into the shared arrays are
+// range checked on load. Structs with padding, enums or bools are written
+// field by field, so no uninitialized bytes reach the file.
+
+namespace osrp {
+
+namespace {
+constexpr char CACHE_MAGIC[4] = {'O', 'S', 'U', 'C'};
+// Bump whenever one of the structs dumped as raw arrays changes.
+constexpr uint32_t CACHE_VERSION = 2;
+
+struct SourceInfo {
+  int64_t mtime;
+  uint64_t size;
+};
+
+SourceInfo GetSourceInfo(const fs::path& path) {
+  return {fs::last_write_time(path).time_since_epoch().count(),
+          fs::file_size(path)};
+}
+
+void WriteView(BinaryWriter& output, std::string_view value) {
+  output.Write(static_cast<uint32_t>(value.size()));
+  output.WriteBytes(reinterpret_cast<const uint8_t*>(value.data()),
+                    value.size());
+}
+
+std::string_view ReadView(BinaryReader& input) {
+  auto size = input.Read<uint32_t>();
+  return std::string_view(reinterpret_cast<const char*>(input.ReadBytes(size)),
+                          size);
+}
+
+// Raw arrays are only used for types without padding, enums or bools.
+static_assert(sizeof(glm::vec2) == 2 * sizeof(float));
+static_assert(sizeof(SliderEdge) == 3);
+static_assert(sizeof(SliderPaths::Path) == 20);
+
+template <typename T>
+void WriteArray(BinaryWriter& output, const std::vector<T>& values) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  output.Write(static_cast<uint64_t>(values.size()));
+  output.WriteBytes(reinterpret_cast<const uint8_t*>(values.data()),
+                    values.size() * sizeof(T));
+}
+
+template <typename T>
+std::vector<T> ReadArray(BinaryReader& input) {
+  auto count = input.Read<uint64_t>();
+  if (count > input.Remaining() / sizeof(T)) {
+    throw std::runtime_error("truncated beatmap cache");
+  }
+  std::vector<T> values(count);
+  std::memcpy(values.data(), input.ReadBytes(count * sizeof(T)),
+              count * sizeof(T));
+  return values;
+}
+
+template <typename T, typename Func>
+void WriteRecords(BinaryWriter& output, const std::vector<T>& values,
+                  Func writeRecord) {
+  output.Write(static_cast<uint64_t>(values.size()));
+  for (const auto& value : values) writeRecord(output, value);
+}
+
+// readRecord returns false for invalid values, which reject the cache.
+template <typename T, typename Func>
+std::vector<T> ReadRecords(BinaryReader& input, size_t minRecordSize,
+                           Func readRecord) {
+  auto count = input.Read<uint64_t>();
+  if (count > input.Remaining() / minRecordSize) {
+    throw std::runtime_error("truncated beatmap cache");
+  }
+  std::vector<T> values(count);
+  for (auto& value : values) {
+    if (!readRecord(input, value)) {
+      throw std::runtime_error("invalid beatmap cache record");
+    }
+  }
+  return values;
+}
+
+template <typename Enum>
+bool ReadEnum(BinaryReader& input, Enum& value, Enum last) {
+  auto raw = input.Read<uint8_t>();
+  value = static_cast<Enum>(raw);
+  return raw <= static_cast<uint8_t>(last);
+}
+
+bool ReadBool(BinaryReader& input, bool& value) {
+  auto raw = input.Read<uint8_t>();
+  value = raw != 0;
+  return raw <= 1;
+}
+
+void WriteHitObject(BinaryWriter& output, const HitObject& object) {
+  output.Write(object.pos.x);
+  output.Write(object.pos.y);
+  output.Write(object.time);
+  output.Write(object.endTime);
+  output.Write(static_cast<uint8_t>(object.type));
+  output.Write(static_cast<uint8_t>(object.newCombo));
+  output.Write(object.comboSkip);
+  output.Write(object.hitSound);
+  output.Write(object.sample.normalSet);
+  output.Write(object.sample.additionSet);
+  output.Write(object.sample.volume);
+  output.Write(object.sample.index);
+  output.Write(static_cast<uint8_t>(object.curveType));
+  output.Write(object.slides);
+  output.Write(object.length);
+  output.Write(object.curvePointOffset);
+  output.Write(object.curvePointCount);
+  output.Write(object.sliderEdgeOffset);
+}
+constexpr size_t HIT_OBJECT_RECORD_SIZE = 52;
+
+bool ReadHitObject(BinaryReader& input, HitObject& object) {
+  object.pos.x = input.Read<float>();
+  object.pos.y = input.Read<float>();
+  object.time = input.Read<int32_t>();
+  object.endTime = input.Read<int32_t>();
+  bool valid = ReadEnum(input, object.type, HitObjectType::HOLD);
+  valid &= ReadBool(input, object.newCombo);
+  object.comboSkip = input.Read<uint8_t>();
+  object.hitSound = input.Read<uint8_t>();
+  object.sample.normalSet = input.Read<uint8_t>();
+  object.sample.additionSet = input.Read<uint8_t>();
+  object.sample.volume = input.Read<uint8_t>();
+  object.sample.index = input.Read<int32_t>();
+  valid &= ReadEnum(input, object.curveType, CurveType::PERFECT_CIRCLE);
+  object.slides = input.Read<int32_t>();
+  object.length = input.Read<float>();
+  object.curvePointOffset = input.Read<uint32_t>();
+  object.curvePointCount = input.Read<uint32_t>();
+  object.sliderEdgeOffset = input.Read<uint32_t>();
+  return valid;
+}
+
+void WriteTimingPoint(BinaryWriter& output, const TimingPoint& point) {
+  output.Write(point.time);
+  output.Write(point.beatLength);
+  output.Write(point.meter);
+  output.Write(point.sampleSet);
+  output.Write(point.sampleIndex);
+  output.Write(point.volume);
+  output.Write(static_cast<uint8_t>(point.uninherited));
+  output.Write(point.effects);
+}
+constexpr size_t TIMING_POINT_RECORD_SIZE = 25;
+
+bool ReadTimingPoint(BinaryReader& input, TimingPoint& point) {
+  point.time = input.Read<double>();
+  point.beatLength = input.Read<double>();
+  point.meter = input.Read<int32_t>();
+  point.sampleSet = input.Read<uint8_t>();
+  point.sampleIndex = input.Read<uint8_t>();
+  point.volume = input.Read<uint8_t>();
+  bool valid = ReadBool(input, point.uninherited);
+  point.effects = input.Read<uint8_t>();
+  return valid;
+}
+
+bool IsConsistent(const HitObjectList& hitObjects,
+                  const SliderPaths& sliderPaths) {
+  const auto& paths = sliderPaths.GetPaths();
+  if (paths.size() != hitObjects.objects.size()) return false;
+  for (size_t i = 0; i < paths.size(); i++) {
+    const auto& object = hitObjects.objects[i];
+    if (paths[i].count == 0 ||
+        uint64_t(paths[i].offset) + paths[i].count >
+            sliderPaths.GetPoints().size()) {
+      return false;
+    }
+    if (object.type != HitObjectType::SLIDER) continue;
+    if (object.slides < 1 ||
+        uint64_t(object.curvePointOffset) + object.curvePointCount >
+            hitObjects.curvePoints.size() ||
+        uint64_t(object.sliderEdgeOffset) + object.slides + 1 >
+            hitObjects.sliderEdges.size()) {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+void Beatmap::WriteCache(const fs::path& cachePath) const {
+  const auto& objects = GetHitObjects();
+  const auto& points = GetTimingPoints();
+  const auto& paths = GetSliderPaths();
+  LoadSection(CommaSeparatedSection::EVENTS);
+  auto source = GetSourceInfo(path);
+
+  BinaryWriter output;
+  output.WriteBytes(reinterpret_cast<const uint8_t*>(CACHE_MAGIC),
+                    sizeof(CACHE_MAGIC));
+  output.Write(CACHE_VERSION);
+  output.WriteBytes(GetMD5().data(), GetMD5().size());
+  output.Write(source.mtime);
+  output.Write(source.size);
+
+  WriteView(output, version);
+  output.Write(static_cast<uint32_t>(properties.size()));
+  for (const auto& property : properties) {
+    output.Write(static_cast<uint8_t>(property.section));
+    WriteView(output, property.key);
+    WriteView(output, property.value);
+  }
+
+  auto events = commaSeparatedSections.find(CommaSeparatedSection::EVENTS);
+  output.Write<uint8_t>(events != commaSeparatedSections.end());
+  if (events != commaSeparatedSections.end()) {
+    output.Write(static_cast<uint32_t>(events->second.size()));
+    for (const auto& row : events->second) {
+      output.Write(static_cast<uint32_t>(row.size()));
+      for (const auto& field : row) WriteView(output, field);
+    }
+  }
+
+  WriteRecords(output, objects.objects, WriteHitObject);
+  WriteArray(output, objects.curvePoints);
+  WriteArray(output, objects.sliderEdges);
+  WriteRecords(output, points, WriteTimingPoint);
+  WriteArray(output, paths.GetPaths());
+  WriteArray(output, paths.GetPoints());
+
+  const auto& buffer = output.GetBuffer();
+  WriteFileAtomic(cachePath, buffer.data(), buffer.size());
+}
+
+std::optional<Beatmap> Beatmap::ReadCache(const fs::path& cachePath,
+                                          const fs::path& sourcePath) {
+  std::error_code err;
+  if (!fs::is_regular_file(cachePath, err)) return std::nullopt;
+
+  try {
+    Beatmap map;
+    map.path = sourcePath;
+    map.file = MappedFile(cachePath);
+    BinaryReader input(map.file);
+    if (std::memcmp(input.ReadBytes(sizeof(CACHE_MAGIC)), CACHE_MAGIC,
+                    sizeof(CACHE_MAGIC)) != 0 ||
+        input.Read<uint32_t>() != CACHE_VERSION) {
+      return std::nullopt;
+    }
+    std::memcpy(map.md5.data(), input.ReadBytes(map.md5.size()),
+                map.md5.size());
+    auto source = GetSourceInfo(sourcePath);
+    if (input.Read<int64_t>() != source.mtime ||
+        input.Read<uint64_t>() != source.size) {
+      return std::nullopt;
+    }
+
+    map.version = ReadView(input);
+    map.properties.resize(input.Read<uint32_t>());
+    for (auto& property : map.properties) {
+      if (!ReadEnum(input, property.section, KeyValueSection::COLORS)) {
+        return std::nullopt;
+      }
+      property.key = ReadView(input);
+      property.value = ReadView(input);
+    }
+
+    auto& rows = map.commaSeparatedSections[CommaSeparatedSection::EVENTS];
+    if (input.Read<uint8_t>()) {
+      rows.resize(input.Read<uint32_t>());
+      for (auto& row : rows) {
+        row.resize(input.Read<uint32_t>());
+        for (auto& field : row) field = ReadView(input);
+      }
+    }
+
+    map.hitObjects.objects = ReadRecords<HitObject>(
+        input, HIT_OBJECT_RECORD_SIZE, ReadHitObject);
+    map.hitObjects.curvePoints = ReadArray<glm::vec2>(input);
+    map.hitObjects.sliderEdges = ReadArray<SliderEdge>(input);
+    map.timingPoints = ReadRecords<TimingPoint>(
+        input, TIMING_POINT_RECORD_SIZE, ReadTimingPoint);
+    auto paths = ReadArray<SliderPaths::Path>(input);
+    auto pathPoints = ReadArray<glm::vec2>(input);
+    map.sliderPaths = SliderPaths(std::move(paths), std::move(pathPoints));
+    if (!IsConsistent(map.hitObjects, map.sliderPaths)) return std::nullopt;
+
+    // Everything is in place, the lazy loaders must not run.
+    auto& lazy = *map.lazySections;
+    for (auto& loaded : lazy.loaded) std::call_once(loaded, []() {});
+    std::call_once(lazy.sliderPathsBuilt, []() {});
+    std::call_once(lazy.md5Computed, []() {});
+    return map;
+  } catch (const std::exception&) {
+    return std::nullopt;
+  }
+}
+
+Beatmap LoadBeatmapCached(const fs::path& path, const fs::path& cacheDir,
+                          bool* hit, std::string_view md5Hex) {
+  auto md5 = ParseMD5(md5Hex);
+  if (!md5) {
+    MappedFile file(path);
+    md5 = ComputeMD5(file.Data(), file.Size());
+  }
+
+  auto cachePath = cacheDir / (ToHex(*md5) + ".osuc");
+  if (auto cached = Beatmap::ReadCache(cachePath, path)) {
+    if (cached->GetMD5() == *md5) {
+      if (hit) *hit = true;
+      return std::move(*cached);
+    }
+  }
+
+  if (hit) *hit = false;
+  Beatmap map(path, BeatmapLoading::LAZY);
+  fs::create_directories(cacheDir);
+  map.WriteCache(fs::path(cacheDir) / (ToHex(map.GetMD5()) + ".osuc"));
+  return map;
+}
+
+}  // namespace osrp
@@ -0,0 +1,655 @@
+#include "cli.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "difficulty.hpp"
+#include "frame_parser.hpp"
+#include "hit_object_index.hpp"
+#include "judgement.hpp"
+#include "library.hpp"
+#include "performance.hpp"
+#include "proximity.hpp"
+#include "replay_batch.hpp"
+#include "stacking.hpp"
+#include "strings.hpp"
+#include "thread_pool.hpp"
+
+namespace osrp {
+
+namespace {
+struct CommandArgs {
+  std::vector<std::string> positional;
+  size_t threads = std::thread::hardware_concurrency();
+  int level = 9;
+  int32_t mods = 0;
+};
+
+CommandArgs ParseArgs(int argc, char** argv) {
+  CommandArgs args;
+  for (int i = 2; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if ((arg == "-j" || arg == "--threads") && i + 1 < argc) {
+      args.threads = std::strtoul(argv[++i], nullptr, 10);
+    } else if ((arg == "-l" || arg == "--level") && i + 1 < argc) {
+      args.level = std::atoi(argv[++i]);
+    } else if ((arg == "-m" || arg == "--mods") && i + 1 < argc) {
+      args.mods = static_cast<int32_t>(std::strtol(argv[++i], nullptr, 10));
+    } else {
+      args.positional.emplace_back(arg);
+    }
+  }
+  return args;
+}
+
+int Usage() {
+  std::cerr << "usage: osu_replay [command] [-j threads] args...\n"
+               "commands:\n"
+               "  batch <replays>...             decode replays in parallel\n"
+               "  cache <cache dir> <replays>... build the replay cache\n"
+               "  reencode <out dir> <replays>... [-l 0-9]\n"
+               "                                 recompress replays\n"
+               "  bench-parse <replay.osr>       benchmark frame parsing\n"
+               "  bench-proximity [objects]      benchmark hit circle tests\n"
+               "  bench-index <beatmap.osu> [copies]\n"
+               "                                 benchmark hit object queries\n"
+               "  bench-stacking <beatmaps.osu>...\n"
+               "                                 benchmark object stacking\n"
+               "  index <songs dir> <index>      build or update the library\n"
+               "  locate <index> <replays>...    find the beatmap of replays\n"
+               "  judge <beatmap.osu> <replays>...\n"
+               "                                 re-judge replays of a map\n"
+               "  stars <beatmaps.osu>... [-m mods]\n"
+               "                                 star rating of beatmaps\n"
+               "  rate <index> [-m mods]         star rate the whole library\n"
+               "  pp <beatmap.osu> <replays>...  pp of the stored scores\n"
+               "<replays> are directories, .osr files or path lists\n";
+  return 1;
+}
+
+int BatchCommand(const CommandArgs& args) {
+  if (args.positional.empty()) return Usage();
+  std::vector<fs::path> inputs(args.positional.begin(),
+                               args.positional.end());
+  auto paths = CollectReplayPaths(inputs);
+
+  ThreadPool pool(args.threads);
+  ReplayBatchStats stats;
+  auto results = DecodeReplays(paths, pool, &stats);
+
+  for (const auto& result : results) {
+    if (!result.replay) {
+      std::cerr << result.path.string() << ": " << result.error << '\n';
+    }
+  }
+
+  double mb = stats.bytes / (1024.0 * 1024.0);
+  double seconds = std::max(stats.seconds, 1e-9);
+  std::cout << "decoded " << stats.replays - stats.failures << '/'
+            << stats.replays << " replays (" << mb << " MiB) in "
+            << stats.seconds << "s on " << pool.GetThreadCount()
+            << " threads: " << stats.replays / seconds << " replays/s, "
+            << mb / seconds << " MiB/s" << std::endl;
+  return stats.failures == 0 ? 0 : 2;
+}
+int CacheCommand(const CommandArgs& args) {
+  if (args.positional.size() < 2) return Usage();
+  fs::path cacheDir = args.positional[0];
+  std::vector<fs::path> inputs(args.positional.begin() + 1,
+                               args.positional.end());
+  auto paths = CollectReplayPaths(inputs);
+
+  ThreadPool pool(args.threads);
+  std::atomic<size_t> hits{0}, failures{0};
+  std::mutex errorMutex;
+  auto start = std::chrono::steady_clock::now();
+  ParallelFor(pool, paths.size(), [&](size_t i) {
+    try {
+      bool hit;
+      LoadReplayCached(paths[i], cacheDir, &hit);
+      if (hit) ++hits;
+    } catch (const std::exception& e) {
+      ++failures;
+      std::lock_guard<std::mutex> lock(errorMutex);
+      std::cerr << paths[i].string() << ": " << e.what() << '\n';
+    }
+  });
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  std::cout << paths.size() << " replays: " << hits << " cached, "
+            << paths.size() - hits - failures << " written, " << failures
+            << " failed in " << seconds << "s" << std::endl;
+  return failures == 0 ? 0 : 2;
+}
+
+int ReencodeCommand(const CommandArgs& args) {
+  if (args.positional.size() < 2) return Usage();
+  fs::path outputDir = args.positional[0];
+  std::vector<fs::path> inputs(args.positional.begin() + 1,
+                               args.positional.end());
+  auto paths = CollectReplayPaths(inputs);
+  fs::create_directories(outputDir);
+
+  ThreadPool pool(args.threads);
+  std::atomic<uintmax_t> bytesIn{0}, bytesOut{0};
+  std::atomic<size_t> failures{0};
+  std::mutex errorMutex;
+  auto start = std::chrono::steady_clock::now();
+  ParallelFor(pool, paths.size(), [&](size_t i) {
+    try {
+      Replay replay(paths[i]);
+      auto data = replay.Encode(args.level);
+      WriteFileAtomic(outputDir / paths[i].filename(), data.data(),
+                      data.size());
+      bytesIn += fs::file_size(paths[i]);
+      bytesOut += data.size();
+    } catch (const std::exception& e) {
+      ++failures;
+      std::lock_guard<std::mutex> lock(errorMutex);
+      std::cerr << paths[i].string() << ": " << e.what() << '\n';
+    }
+  });
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  std::cout << "re-encoded " << paths.size() - failures << '/' << paths.size()
+            << " replays at level " << args.level << ": " << bytesIn
+            << " -> " << bytesOut << " bytes ("
+            << 100.0 * bytesOut / std::max<uintmax_t>(bytesIn, 1) << "%) in "
+            << seconds << 's' << std::endl;
+  return failures == 0 ? 0 : 2;
+}
+
+int IndexCommand(const CommandArgs& args) {
+  if (args.positional.size() != 2) return Usage();
+  ThreadPool pool(args.threads);
+  LibraryScanStats stats;
+  auto index = ScanLibrary(args.positional[0], args.positional[1], pool,
+                           &stats);
+
+  std::cout << stats.files << " beatmaps: " << stats.reused << " unchanged, "
+            << stats.parsed << " parsed, " << stats.failures << " failed in "
+            << stats.seconds << "s"
+            << (stats.written ? "" : ", index up to date") << std::endl;
+  return stats.failures == 0 ? 0 : 2;
+}
+
+int LocateCommand(const CommandArgs& args) {
+  if (args.positional.size() < 2) return Usage();
+  LibraryIndex index(args.positional[0]);
+  std::vector<fs::path> inputs(args.positional.begin() + 1,
+                               args.positional.end());
+
+  size_t missing = 0;
+  for (const auto& path : CollectReplayPaths(inputs)) {
+    try {
+      ReplayHeader header(path, false);
+      auto record = index.Find(header.mapMd5);
+      if (record) {
+        std::cout << path.string() << ": " << index.GetPath(*record).string()
+                  << '\n';
+        continue;
+      }
+      std::cerr << path.string() << ": beatmap " << header.mapMd5
+                << " not in library\n";
+    } catch (const std::exception& e) {
+      std::cerr << path.string() << ": " << e.what() << '\n';
+    }
+    missing++;
+  }
+  return missing == 0 ? 0 : 2;
+}
+
+int JudgeCommand(const CommandArgs& args) {
+  if (args.positional.size() < 2) return Usage();
+  Beatmap map(args.positional[0], BeatmapLoading::LAZY);
+  std::vector<fs::path> inputs(args.positional.begin() + 1,
+                               args.positional.end());
+  auto paths = CollectReplayPaths(inputs);
+
+  ThreadPool pool(args.threads);
+  JudgementBatchStats stats;
+  auto results = JudgeReplays(map, paths, pool, &stats);
+
+  for (const auto& result : results) {
+    if (!result.judgement) {
+      std::cerr << result.path.string() << ": " << result.error << '\n';
+      continue;
+    }
+    const auto& judgement = *result.judgement;
+    const auto& header = *result.header;
+    if (judgement.MatchesHeader(header) && judgement.score == header.score) {
+      continue;
+    }
+    std::cout << result.path.string() << ": judged " << judgement.count300
+              << '/' << judgement.count100 << '/' << judgement.count50 << '/'
+              << judgement.countMiss << " x" << judgement.maxCombo << ' '
+              << judgement.score << ", stored " << header.no_300s << '/'
+              << header.no_100s << '/' << header.no_50s << '/'
+              << header.no_misses << " x" << header.maxCombo << ' '
+              << header.score << '\n';
+  }
+
+  size_t judged = stats.replays - stats.failures;
+  std::cout << "judged " << judged << '/' << stats.replays << " replays in "
+            << stats.seconds << "s on " << pool.GetThreadCount()
+            << " threads: " << stats.replays / std::max(stats.seconds, 1e-9)
+            << " replays/s including decoding, "
+            << judged / std::max(stats.judgeSeconds, 1e-9)
+            << " judgements/s per thread\n"
+            << "mismatches: " << stats.scoreMismatches << " score, "
+            << stats.comboMismatches << " combo, " << stats.countMismatches
+            << " hit counts, " << stats.mapMismatches
+            << " set on another beatmap version" << std::endl;
+  return stats.failures == 0 ? 0 : 2;
+}
+
+void PrintDifficulty(const DifficultyAttributes& attributes) {
+  std::cout << attributes.starRating << "* (aim " << attributes.aimRating
+            << ", speed " << attributes.speedRating << ") AR "
+            << attributes.approachRate << " OD "
+            << attributes.overallDifficulty << " x" << attributes.maxCombo;
+}
+
+int StarsCommand(const CommandArgs& args) {
+  if (args.positional.empty()) return Usage();
+  size_t failures = 0;
+  for (const auto& path : args.positional) {
+    try {
+      auto attributes = CalculateDifficulty(Beatmap(path), args.mods);
+      std::cout << path << ": ";
+      PrintDifficulty(attributes);
+      std::cout << '\n';
+    } catch (const std::exception& e) {
+      std::cerr << path << ": " << e.what() << '\n';
+      failures++;
+    }
+  }
+  return failures == 0 ? 0 : 2;
+}
+
+int RateCommand(const CommandArgs& args) {
+  if (args.positional.size() != 1) return Usage();
+  LibraryIndex index(args.positional[0]);
+  ThreadPool pool(args.threads);
+  LibraryRatingStats stats;
+  auto ratings = RateLibrary(index, pool, args.mods, &stats);
+
+  std::vector<size_t> order;
+  for (size_t i = 0; i < ratings.size(); i++) {
+    if (ratings[i].starRating > 0.0) order.push_back(i);
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return ratings[a].starRating > ratings[b].starRating;
+  });
+  for (size_t i : order) {
+    const auto& record = index.begin()[i];
+    std::cout << index.GetString(record.artist) << " - "
+              << index.GetString(record.title) << " ["
+              << index.GetString(record.version) << "]: ";
+    PrintDifficulty(ratings[i]);
+    std::cout << '\n';
+  }
+  std::cout << "rated " << stats.rated << " beatmaps (" << stats.skipped
+            << " skipped, " << stats.failures << " failed) in "
+            << stats.seconds << "s on " << pool.GetThreadCount()
+            << " threads: " << stats.rated / std::max(stats.seconds, 1e-9)
+            << " beatmaps/s" << std::endl;
+  return stats.failures == 0 ? 0 : 2;
+}
+
+int PerformanceCommand(const CommandArgs& args) {
+  if (args.positional.size() < 2) return Usage();
+  Beatmap map(args.positional[0]);
+  std::vector<fs::path> inputs(args.positional.begin() + 1,
+                               args.positional.end());
+
+  std::vector<fs::path> paths;
+  std::vector<ReplayHeader> headers;
+  size_t failures = 0;
+  for (const auto& path : CollectReplayPaths(inputs)) {
+    try {
+      headers.emplace_back(path, false);
+      paths.push_back(path);
+    } catch (const std::exception& e) {
+      std::cerr << path.string() << ": " << e.what() << '\n';
+      failures++;
+    }
+  }
+
+  // One PerformanceMap per mod combination.
+  std::vector<PerformanceMap> maps;
+  std::map<int32_t, uint32_t> mapByMods;
+  std::vector<ScoreEntry> scores;
+  for (const auto& header : headers) {
+    auto it = mapByMods.find(header.mods);
+    if (it == mapByMods.end()) {
+      maps.emplace_back(CalculateDifficulty(map, header.mods), header.mods);
+      it = mapByMods.emplace(header.mods, maps.size() - 1).first;
+    }
+    scores.push_back(ScoreEntry{it->second, ScoreStatistics(header)});
+  }
+
+  ThreadPool pool(args.threads);
+  auto start = std::chrono::steady_clock::now();
+  auto pp = CalculatePerformance(maps, scores, pool);
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  for (size_t i = 0; i < paths.size(); i++) {
+    std::cout << paths[i].string() << ": " << headers[i].playerName << ' '
+              << pp[i] << "pp\n";
+  }
+  std::cout << "evaluated " << scores.size() << " scores on " << maps.size()
+            << " mod combinations in " << seconds << 's' << std::endl;
+  return failures == 0 ? 0 : 2;
+}
+
+template <typename Func>
+double MeasureSeconds(size_t iterations, Func func) {
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+             .count();
+}
+
+// The frame parsing Replay did before FrameParser, kept as it was: Split on
+// ',' and '|', std::stof for floats, delta times accumulated and frames
+// stored in a vector<Frame>. That includes the switch fall-through that
+// parses each token again as every later field.
+template <typename T>
+Result<T> ParseLegacy(const std::string_view& str) {
+  if constexpr (std::is_same_v<T, float>) {
+    return Result<float>(std::stof(std::string(TrimWhitespace(str))));
+  } else {
+    return ParseString<T>(str);
+  }
+}
+
+Result<Frame> ParseFrameLegacy(const std::string_view& str,
+                               int64_t& timeOffset) {
+  Frame frame;
+  int tokenIndex = 0;
+  std::error_code err{};
+  Split(str, '|', [&](const auto& token) {
+#define PARSE(x)                                            \
+  if (auto result = ParseLegacy<decltype(frame.x)>(token);  \
+      result.HasValue()) {                                  \
+    frame.x = result.Value();                               \
+  } else {                                                  \
+    err = result.Error();                                   \
+  }
+    switch (tokenIndex++) {
+      case 0:
+        PARSE(time);
+      case 1:
+        PARSE(pos.x);
+      case 2:
+        PARSE(pos.y);
+      case 3:
+        PARSE(keys);
+    }
+#undef PARSE
+  });
+  if (err == std::error_code()) {
+    frame.time += timeOffset;
+    timeOffset = frame.time;
+    return Result<Frame>(frame);
+  } else {
+    return Result<Frame>(err);
+  }
+}
+
+std::vector<Frame> ParseFramesLegacy(const std::string& text,
+                                     int32_t& replaySeed) {
+  std::vector<Frame> frames;
+  int64_t timeOffset = 0;
+  Split(text, ',', [&](const std::string_view& str) {
+    if (TrimWhitespace(str).size() <= 0) return;
+    if (auto seedString = RemovePrefix(str, "-12345|0|0|");
+        seedString.has_value()) {
+      auto seedResult = ParseString<int32_t>(seedString.value());
+      if (seedResult) replaySeed = seedResult.Value();
+    } else if (auto frame = ParseFrameLegacy(str, timeOffset);
+               frame.HasValue()) {
+      frames.push_back(frame.Value());
+    }
+  });
+  return frames;
+}
+
+int BenchParseCommand(const CommandArgs& args) {
+  if (args.positional.size() != 1) return Usage();
+  auto text = ReadReplayFrameText(args.positional[0]);
+  constexpr size_t ITERATIONS = 200;
+
+  size_t legacyFrames = 0, frames = 0;
+  double legacy = MeasureSeconds(ITERATIONS, [&]() {
+    int32_t seed;
+    legacyFrames = ParseFramesLegacy(text, seed).size();
+  });
+  double current = MeasureSeconds(ITERATIONS, [&]() {
+    FrameArray array;
+    std::optional<int32_t> seed;
+    FrameParser parser(array, seed);
+    parser.Feed(text);
+    parser.Finish();
+    frames = array.size();
+  });
+
+  double mb = text.size() * ITERATIONS / (1024.0 * 1024.0);
+  std::cout << text.size() << " bytes, " << frames << " frames, scanner "
+            << GetFrameDelimiterScanner() << '\n'
+            << "legacy:      " << mb / legacy << " MiB/s (" << legacyFrames
+            << " frames)\n"
+            << "FrameParser: " << mb / current << " MiB/s, "
+            << legacy / current << "x" << std::endl;
+  return 0;
+}
+int BenchProximityCommand(const CommandArgs& args) {
+  if (args.positional.size() > 1) return Usage();
+  size_t count = args.positional.empty()
+                     ? 4096
+                     : std::strtoul(args.positional[0].c_str(), nullptr, 10);
+  constexpr size_t QUERIES = 4096;
+  constexpr float RADIUS = 36.48f;  // CS 4
+
+  // Fixed LCG so every run tests the same layout.
+  uint32_t state = 12345;
+  auto next = [&](float range) {
+    state = state * 1664525u + 1013904223u;
+    return (state >> 8) * (range / 16777216.0f);
+  };
+  std::vector<float> xs(count), ys(count);
+  for (size_t i = 0; i < count; i++) {
+    xs[i] = next(512.0f);
+    ys[i] = next(384.0f);
+  }
+  std::vector<glm::vec2> queries(QUERIES);
+  for (auto& query : queries) query = glm::vec2(next(512.0f), next(384.0f));
+
+  std::vector<uint32_t> indices(count);
+  size_t baselineHits = 0, kernelHits = 0;
+  double baseline = MeasureSeconds(1, [&]() {
+    for (const auto& query : queries) {
+      for (size_t i = 0; i < count; i++) {
+        if (glm::distance(query, glm::vec2(xs[i], ys[i])) <= RADIUS) {
+          indices[baselineHits++ % count] = i;
+        }
+      }
+    }
+  });
+  double kernel = MeasureSeconds(1, [&]() {
+    for (const auto& query : queries) {
+      kernelHits += FindPointsInRadius(xs.data(), ys.data(), count, query,
+                                       RADIUS, indices.data());
+    }
+  });
+
+  double tests = static_cast<double>(count) * QUERIES / 1e6;
+  std::cout << count << " objects, " << QUERIES << " queries, kernel "
+            << GetProximityKernel() << '\n'
+            << "glm::distance: " << tests / baseline << " M tests/s ("
+            << baselineHits << " hits)\n"
+            << "kernel:        " << tests / kernel << " M tests/s ("
+            << kernelHits << " hits), " << baseline / kernel << "x"
+            << std::endl;
+  return 0;
+}
+
+int BenchIndexCommand(const CommandArgs& args) {
+  if (args.positional.empty() || args.positional.size() > 2) return Usage();
+  size_t copies = args.positional.size() > 1
+                      ? std::strtoul(args.positional[1].c_str(), nullptr, 10)
+                      : 32;
+  Beatmap map(args.positional[0]);
+  JudgementMap judgementMap(map, args.mods);
+  if (judgementMap.size() == 0 || copies == 0) return Usage();
+
+  // The map played back to back copies times, e.g. 32 copies of a 300
+  // object map for a marathon.
+  std::vector<int32_t> times;
+  std::vector<double> endTimes;
+  std::vector<float> xs, ys;
+  double mapLength = *std::max_element(judgementMap.endTimes.begin(),
+                                       judgementMap.endTimes.end()) +
+                     1000.0;
+  for (size_t copy = 0; copy < copies; copy++) {
+    auto offset = static_cast<int32_t>(copy * mapLength);
+    for (size_t i = 0; i < judgementMap.size(); i++) {
+      times.push_back(judgementMap.times[i] + offset);
+      endTimes.push_back(judgementMap.endTimes[i] + offset);
+    }
+    xs.insert(xs.end(), judgementMap.xs.begin(), judgementMap.xs.end());
+    ys.insert(ys.end(), judgementMap.ys.begin(), judgementMap.ys.end());
+  }
+  HitObjectIndex index(times, endTimes, xs, ys);
+  size_t count = index.size();
+
+  // Visible objects every frame at 60 fps, with a 200 ms fade out.
+  const auto& modded = map.GetModded(args.mods);
+  double lead = modded.preempt, linger = 200.0;
+  double end = copies * mapLength;
+  size_t scanVisible = 0, windowVisible = 0, frames = 0;
+  double scan = MeasureSeconds(1, [&]() {
+    for (double t = 0.0; t < end; t += 1000.0 / 60.0) {
+      for (size_t i = 0; i < count; i++) {
+        scanVisible += times[i] - lead <= t && endTimes[i] + linger >= t;
+      }
+    }
+  });
+  double window = MeasureSeconds(1, [&]() {
+    HitObjectWindow visible(index, lead, linger);
+    for (double t = 0.0; t < end; t += 1000.0 / 60.0) {
+      windowVisible += visible.Seek(t).size();
+      frames++;
+    }
+  });
+
+  // Clicks near random objects, around their time.
+  constexpr size_t CLICKS = 100000;
+  std::vector<std::pair<glm::vec2, double>> clicks;
+  uint32_t seed = 1;
+  auto random = [&]() {
+    seed = seed * 1664525u + 1013904223u;
+    return static_cast<float>(seed >> 8) / (1 << 24);
+  };
+  for (size_t i = 0; i < CLICKS; i++) {
+    auto object = static_cast<size_t>(random() * count);
+    glm::vec2 jitter(random() - 0.5f, random() - 0.5f);
+    clicks.emplace_back(index.GetPosition(object) + jitter * 200.0f,
+                        times[object] + (random() - 0.5f) * 400.0);
+  }
+  float radius = judgementMap.circleRadius;
+  double window50 = judgementMap.windows.meh;
+  size_t scanHits = 0, indexHits = 0;
+  double clickScan = MeasureSeconds(1, [&]() {
+    for (const auto& [pos, t] : clicks) {
+      for (size_t i = 0; i < count; i++) {
+        scanHits += times[i] <= t + window50 && endTimes[i] >= t - window50 &&
+                    glm::distance(glm::vec2(xs[i], ys[i]), pos) <= radius;
+      }
+    }
+  });
+  std::vector<uint32_t> hits;
+  double clickIndex = MeasureSeconds(1, [&]() {
+    for (const auto& [pos, t] : clicks) {
+      hits.clear();
+      index.FindNear(pos, radius, t - window50, t + window50, hits);
+      indexHits += hits.size();
+    }
+  });
+
+  std::cout << count << " objects, " << frames << " frames, " << CLICKS
+            << " clicks\n"
+            << "visible, full scan: " << frames / scan << " frames/s ("
+            << scanVisible << " objects)\n"
+            << "visible, window:    " << frames / window << " frames/s ("
+            << windowVisible << " objects), " << scan / window << "x\n"
+            << "clicks, full scan:  " << CLICKS / clickScan << " clicks/s ("
+            << scanHits << " hits)\n"
+            << "clicks, grid:       " << CLICKS / clickIndex << " clicks/s ("
+            << indexHits << " hits), " << clickScan / clickIndex << "x"
+            << std::endl;
+  return 0;
+}
+
+int BenchStackingCommand(const CommandArgs& args) {
+  if (args.positional.empty()) return Usage();
+  constexpr size_t ITERATIONS = 1000;
+  for (const auto& path : args.positional) {
+    Beatmap map(path);
+    const auto& modded = map.GetModded(args.mods);
+    size_t count = modded.stackHeights.size();
+    size_t stacked = std::count_if(modded.stackHeights.begin(),
+                                   modded.stackHeights.end(),
+                                   [](int32_t height) { return height != 0; });
+
+    std::vector<int32_t> heights;
+    double seconds = MeasureSeconds(ITERATIONS, [&]() {
+      heights = ComputeStackHeights(map, modded.preempt);
+    });
+    std::cout << path << ": " << count << " objects, " << stacked
+              << " stacked, " << seconds / ITERATIONS * 1e6 << " us per pass, "
+              << count * ITERATIONS / seconds / 1e6 << " M objects/s"
+              << std::endl;
+  }
+  return 0;
+}
+}  // namespace
+
+std::optional<int> RunCommand(int argc, char** argv) {
+  if (argc < 2) return std::nullopt;
+
+  std::string_view command = argv[1];
+  auto args = ParseArgs(argc, argv);
+  if (command == "batch") return BatchCommand(args);
+  if (command == "cache") return CacheCommand(args);
+  if (command == "reencode") return ReencodeCommand(args);
+  if (command == "bench-parse") return BenchParseCommand(args);
+  if (command == "bench-proximity") return BenchProximityCommand(args);
+  if (command == "bench-index") return BenchIndexCommand(args);
+  if (command == "bench-stacking") return BenchStackingCommand(args);
+  if (command == "index") return IndexCommand(args);
+  if (command == "locate") return LocateCommand(args);
+  if (command == "judge") return JudgeCommand(args);
+  if (command == "stars") return StarsCommand(args);
+  if (command == "rate") return RateCommand(args);
+  if (command == "pp") return PerformanceCommand(args);
+  return Usage();
+}
+
+}  // namespace osrp
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <optional>
+
+namespace osrp {
+
+// Runs the headless command named by argv[1], if any, and returns its exit
+// code. Returns std::nullopt when no command was given so the caller can start
+// the interactive player instead.
+std::optional<int> RunCommand(int argc, char** argv);
+
+}  // namespace osrp
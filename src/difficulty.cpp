@@ -0,0 +1,219 @@
+#include "difficulty.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+
+#include "judgement.hpp"
+
+namespace osrp {
+
+namespace {
+// Distances are scaled as if every circle had this radius.
+constexpr double NORMALISED_RADIUS = 52.0;
+constexpr double MIN_STRAIN_TIME = 50.0;
+constexpr double SECTION_LENGTH = 400.0;
+constexpr double DECAY_WEIGHT = 0.9;
+constexpr double STAR_SCALING = 0.0675;
+
+constexpr double AIM_MULTIPLIER = 26.25, AIM_DECAY_BASE = 0.15;
+constexpr double SPEED_MULTIPLIER = 1400.0, SPEED_DECAY_BASE = 0.3;
+constexpr double SINGLE_SPACING = 125.0, STREAM_SPACING = 110.0;
+
+// AR with the given approach time at clock rate 1.
+double ApproachRateForPreempt(double preempt) {
+  return preempt > 1200.0 ? (1800.0 - preempt) / 120.0
+                          : (1200.0 - preempt) / 150.0 + 5.0;
+}
+
+// Per-object inputs of the strain passes, one array each.
+struct DifficultyObjects {
+  std::vector<double> strainTimes, deltaTimes;
+  std::vector<double> jumpDistances, travelDistances;
+  std::vector<double> startTimes;
+};
+
+DifficultyObjects Preprocess(const JudgementMap& map, double clockRate) {
+  size_t count = map.size();
+  double scale = NORMALISED_RADIUS / map.circleRadius;
+  // Small circles are harder to aim at than their size alone suggests.
+  if (map.circleRadius < 30.0f) {
+    scale *= 1.0 + std::min(30.0 - map.circleRadius, 5.0) / 50.0;
+  }
+  double followRadius = map.circleRadius * 3.0;
+
+  // The cursor lazily follows each slider through its checkpoints, moving
+  // only once the ball leaves the follow circle. Lengths stay in playfield
+  // pixels here; scale only applies to the travel distance.
+  std::vector<glm::vec2> endPositions(count);
+  std::vector<double> lazyLengths(count, 0.0);
+  for (size_t i = 0; i < count; i++) {
+    endPositions[i] = glm::vec2(map.xs[i], map.ys[i]);
+  }
+  for (const auto& checkpoint : map.checkpoints) {
+    auto& cursor = endPositions[checkpoint.object];
+    glm::vec2 movement = checkpoint.pos - cursor;
+    double length = glm::length(movement);
+    if (length > followRadius) {
+      movement *= static_cast<float>((length - followRadius) / length);
+      cursor += movement;
+      lazyLengths[checkpoint.object] += length - followRadius;
+    }
+  }
+
+  DifficultyObjects result;
+  size_t n = count > 0 ? count - 1 : 0;
+  result.strainTimes.resize(n);
+  result.deltaTimes.resize(n);
+  result.jumpDistances.assign(n, 0.0);
+  result.travelDistances.assign(n, 0.0);
+  result.startTimes.resize(n);
+  for (size_t i = 1; i < count; i++) {
+    double delta = (map.times[i] - map.times[i - 1]) / clockRate;
+    result.deltaTimes[i - 1] = delta;
+    result.strainTimes[i - 1] = std::max(delta, MIN_STRAIN_TIME);
+    result.startTimes[i - 1] = map.times[i] / clockRate;
+    if (map.types[i] == HitObjectType::SPINNER ||
+        map.types[i - 1] == HitObjectType::SPINNER) {
+      continue;
+    }
+    glm::vec2 pos(map.xs[i], map.ys[i]);
+    result.jumpDistances[i - 1] =
+        glm::length(pos - endPositions[i - 1]) * scale;
+    result.travelDistances[i - 1] = lazyLengths[i - 1] * scale;
+  }
+  return result;
+}
+
+double AimValue(const DifficultyObjects& objects, size_t i) {
+  return (std::pow(objects.travelDistances[i], 0.99) +
+          std::pow(objects.jumpDistances[i], 0.99)) /
+         objects.strainTimes[i];
+}
+
+double SpeedValue(const DifficultyObjects& objects, size_t i) {
+  double distance = std::min(
+      SINGLE_SPACING, objects.travelDistances[i] + objects.jumpDistances[i]);
+  double value;
+  if (distance >= SINGLE_SPACING) {
+    value = 2.5;
+  } else if (distance > STREAM_SPACING) {
+    value = 1.6 + 0.9 * (distance - STREAM_SPACING) /
+                      (SINGLE_SPACING - STREAM_SPACING);
+  } else if (distance > 90.0) {
+    value = 1.2 + 0.4 * (distance - 90.0) / (STREAM_SPACING - 90.0);
+  } else if (distance > 45.0) {
+    value = 0.95 + 0.25 * (distance - 45.0) / 45.0;
+  } else {
+    value = 0.95;
+  }
+  return value / objects.strainTimes[i];
+}
+
+// Decaying strain over all objects, reduced to the weighted sum of the
+// peaks of each section.
+double StrainDifficulty(const DifficultyObjects& objects, double firstTime,
+                        double multiplier, double decayBase,
+                        double (*strainValue)(const DifficultyObjects&,
+                                              size_t)) {
+  size_t count = objects.startTimes.size();
+  if (count == 0) return 0.0;
+  auto decay = [&](double ms) { return std::pow(decayBase, ms / 1000.0); };
+
+  std::vector<double> peaks;
+  double strain = 0.0, peak = 0.0;
+  double sectionEnd = std::ceil(firstTime / SECTION_LENGTH) * SECTION_LENGTH;
+  double previousTime = firstTime;
+  for (size_t i = 0; i < count; i++) {
+    double time = objects.startTimes[i];
+    while (time > sectionEnd) {
+      peaks.push_back(peak);
+      // The next section starts with the strain left at its start.
+      peak = strain * decay(sectionEnd - previousTime);
+      sectionEnd += SECTION_LENGTH;
+    }
+    strain = strain * decay(objects.deltaTimes[i]) +
+             strainValue(objects, i) * multiplier;
+    peak = std::max(peak, strain);
+    previousTime = time;
+  }
+  peaks.push_back(peak);
+
+  std::sort(peaks.begin(), peaks.end(), std::greater<double>());
+  double difficulty = 0.0, weight = 1.0;
+  for (double value : peaks) {
+    difficulty += value * weight;
+    weight *= DECAY_WEIGHT;
+  }
+  return difficulty;
+}
+}  // namespace
+
+DifficultyAttributes CalculateDifficulty(const Beatmap& map, int32_t mods) {
+  JudgementMap judgementMap(map, mods);
+  const auto& modded = map.GetModded(mods);
+  double clockRate = modded.clockRate;
+
+  DifficultyAttributes attributes;
+  attributes.approachRate = ApproachRateForPreempt(modded.preempt / clockRate);
+  // Same 300 window at clock rate 1.
+  attributes.overallDifficulty =
+      (80.0 - (80.0 - 6.0 * modded.overallDifficulty) / clockRate) / 6.0;
+  attributes.maxCombo = judgementMap.maxCombo;
+  for (auto type : judgementMap.types) {
+    attributes.circleCount += type == HitObjectType::CIRCLE;
+    attributes.sliderCount += type == HitObjectType::SLIDER;
+    attributes.spinnerCount += type == HitObjectType::SPINNER;
+  }
+  if (judgementMap.size() < 2) return attributes;
+
+  auto objects = Preprocess(judgementMap, clockRate);
+  double firstTime = judgementMap.times[0] / clockRate;
+  double aim = StrainDifficulty(objects, firstTime, AIM_MULTIPLIER,
+                                AIM_DECAY_BASE, AimValue);
+  double speed = StrainDifficulty(objects, firstTime, SPEED_MULTIPLIER,
+                                  SPEED_DECAY_BASE, SpeedValue);
+  attributes.aimRating = std::sqrt(aim) * STAR_SCALING;
+  attributes.speedRating = std::sqrt(speed) * STAR_SCALING;
+  attributes.starRating =
+      attributes.aimRating + attributes.speedRating +
+      std::abs(attributes.aimRating - attributes.speedRating) / 2.0;
+  return attributes;
+}
+
+std::vector<DifficultyAttributes> RateLibrary(const LibraryIndex& index,
+                                              ThreadPool& pool, int32_t mods,
+                                              LibraryRatingStats* stats) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<DifficultyAttributes> results(index.size());
+  std::atomic<size_t> rated = 0, skipped = 0, failures = 0;
+  ParallelFor(pool, index.size(), [&](size_t i) {
+    const auto& record = index.begin()[i];
+    if (record.invalid || record.mode != static_cast<int32_t>(
+                                             GameMode::STANDARD)) {
+      skipped++;
+      return;
+    }
+    try {
+      Beatmap map(index.GetPath(record));
+      results[i] = CalculateDifficulty(map, mods);
+      rated++;
+    } catch (const std::exception&) {
+      failures++;
+    }
+  });
+
+  if (stats) {
+    stats->rated = rated;
+    stats->skipped = skipped;
+    stats->failures = failures;
+    stats->seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  }
+  return results;
+}
+
+}  // namespace osrp
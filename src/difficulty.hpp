@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "beatmap.hpp"
+#include "library.hpp"
+#include "thread_pool.hpp"
+
+namespace osrp {
+
+// osu!standard difficulty of a beatmap for one mod combination, and the
+// inputs the performance calculation needs.
+struct DifficultyAttributes {
+  double starRating = 0.0;
+  double aimRating = 0.0, speedRating = 0.0;
+  // After mods, AR and OD as they feel at the mod's clock rate.
+  double approachRate = 0.0, overallDifficulty = 0.0;
+  uint32_t maxCombo = 0;
+  uint32_t circleCount = 0, sliderCount = 0, spinnerCount = 0;
+};
+
+// Aim and speed strain over the hit objects: every object adds to a
+// decaying strain, the peak of each 400 ms section is kept and the sorted
+// peaks are summed with weights 0.9^i.
+DifficultyAttributes CalculateDifficulty(const Beatmap& map, int32_t mods = 0);
+
+struct LibraryRatingStats {
+  size_t rated = 0, skipped = 0, failures = 0;
+  double seconds = 0.0;
+};
+
+// Rates every osu!standard map of the library on the pool. Results are
+// indexed like the index records; skipped or failed maps keep a star rating
+// of 0.
+std::vector<DifficultyAttributes> RateLibrary(
+    const LibraryIndex& index, ThreadPool& pool, int32_t mods = 0,
+    LibraryRatingStats* stats = nullptr);
+
+}  // namespace osrp
@@ -0,0 +1,204 @@
+#include "frame_parser.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "simd.hpp"
+#include "strings.hpp"
+
+namespace osrp {
+
+namespace {
+
+size_t ScanDelimitersScalar(const char* data, size_t begin, size_t end,
+                            uint32_t* positions) {
+  size_t count = 0;
+  for (size_t i = begin; i < end; i++) {
+    if (data[i] == ',' || data[i] == '|') positions[count++] = i;
+  }
+  return count;
+}
+
+#ifdef OSRP_X86
+size_t FindFrameDelimitersSSE2(const char* data, size_t size,
+                               uint32_t* positions) {
+  const __m128i comma = _mm_set1_epi8(',');
+  const __m128i pipe = _mm_set1_epi8('|');
+  size_t count = 0, i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    uint32_t mask = _mm_movemask_epi8(_mm_or_si128(
+        _mm_cmpeq_epi8(block, comma), _mm_cmpeq_epi8(block, pipe)));
+    while (mask) {
+      positions[count++] = i + CountTrailingZeros(mask);
+      mask &= mask - 1;
+    }
+  }
+  return count + ScanDelimitersScalar(data, i, size, positions + count);
+}
+
+OSRP_TARGET_AVX2 size_t FindFrameDelimitersAVX2(const char* data, size_t size,
+                                                uint32_t* positions) {
+  const __m256i comma = _mm256_set1_epi8(',');
+  const __m256i pipe = _mm256_set1_epi8('|');
+  size_t count = 0, i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    uint32_t mask = _mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_cmpeq_epi8(block, comma), _mm256_cmpeq_epi8(block, pipe)));
+    while (mask) {
+      positions[count++] = i + CountTrailingZeros(mask);
+      mask &= mask - 1;
+    }
+  }
+  return count + ScanDelimitersScalar(data, i, size, positions + count);
+}
+#else
+size_t FindFrameDelimitersScalar(const char* data, size_t size,
+                                 uint32_t* positions) {
+  return ScanDelimitersScalar(data, 0, size, positions);
+}
+#endif
+
+struct DelimiterScanner {
+  size_t (*scan)(const char*, size_t, uint32_t*);
+  const char* name;
+};
+
+const DelimiterScanner& GetScanner() {
+  static const DelimiterScanner scanner = []() -> DelimiterScanner {
+#ifdef OSRP_X86
+    if (CpuSupportsAVX2()) return {FindFrameDelimitersAVX2, "avx2"};
+    return {FindFrameDelimitersSSE2, "sse2"};
+#else
+    return {FindFrameDelimitersScalar, "scalar"};
+#endif
+  }();
+  return scanner;
+}
+
+void AppendFloat(std::string& text, float value) {
+  char buffer[32];
+  for (int precision = 6; precision <= 9; precision++) {
+    std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+    if (precision == 9 || std::strtof(buffer, nullptr) == value) break;
+  }
+  text.append(buffer);
+}
+
+}  // namespace
+
+size_t FindFrameDelimiters(std::string_view text, uint32_t* positions) {
+  return GetScanner().scan(text.data(), text.size(), positions);
+}
+
+const char* GetFrameDelimiterScanner() { return GetScanner().name; }
+
+void FrameParser::Feed(std::string_view chunk) {
+  if (!pending.empty()) {
+    auto indexOfComma = chunk.find(',');
+    if (indexOfComma == std::string_view::npos) {
+      pending.append(chunk);
+      return;
+    }
+    pending.append(chunk.substr(0, indexOfComma + 1));
+    ParseFrames(pending);
+    pending.clear();
+    chunk.remove_prefix(indexOfComma + 1);
+  }
+
+  auto indexOfLastComma = chunk.rfind(',');
+  if (indexOfLastComma == std::string_view::npos) {
+    pending.append(chunk);
+    return;
+  }
+  ParseFrames(chunk.substr(0, indexOfLastComma + 1));
+  pending.append(chunk.substr(indexOfLastComma + 1));
+}
+
+void FrameParser::Finish() {
+  if (!TrimWhitespace(pending).empty()) {
+    pending.push_back(',');
+    ParseFrames(pending);
+  }
+  pending.clear();
+}
+
+void FrameParser::ParseFrames(std::string_view text) {
+  // Scratch shared by every parser on this thread.
+  thread_local std::vector<uint32_t> delimiters;
+  if (delimiters.size() < text.size()) delimiters.resize(text.size());
+  size_t count = FindFrameDelimiters(text, delimiters.data());
+
+  std::string_view fields[4];
+  size_t fieldIndex = 0, fieldBegin = 0;
+  for (size_t i = 0; i < count; i++) {
+    size_t position = delimiters[i];
+    if (fieldIndex < 4) {
+      fields[fieldIndex] = text.substr(fieldBegin, position - fieldBegin);
+    }
+    fieldIndex++;
+    fieldBegin = position + 1;
+    if (text[position] == ',') {
+      if (fieldIndex == 4) AddFrame(fields);
+      fieldIndex = 0;
+    }
+  }
+}
+
+void FrameParser::AddFrame(const std::string_view (&fields)[4]) {
+  if (fields[0] == "-12345" && fields[1] == "0" && fields[2] == "0") {
+    auto seedResult = ParseString<int32_t>(fields[3]);
+    if (seedResult) {
+      replaySeed = seedResult.Value();
+    } else {
+      std::cerr << "Replay seed parsing unsuccessfully. Error: "
+                << seedResult.Error().message() << std::endl;
+    }
+    return;
+  }
+
+  auto delta = ParseString<int64_t>(fields[0]);
+  auto x = ParseString<float>(fields[1]);
+  auto y = ParseString<float>(fields[2]);
+  auto keys = ParseString<uint32_t>(fields[3]);
+  if (!delta || !x || !y || !keys) return;
+
+  // The delta still counts towards later frames when this one is dropped.
+  timeOffset += delta.Value();
+  Frame frame{glm::vec2(x.Value(), y.Value()), timeOffset, keys.Value()};
+  if (!FrameArray::CanStore(frame)) {
+    std::cerr << "Skipping replay frame with time " << frame.time
+              << " and keys " << frame.keys << ": out of range" << std::endl;
+    return;
+  }
+  frames.push_back(frame);
+}
+
+std::string FormatFrames(const FrameArray& frames,
+                         std::optional<int32_t> replaySeed) {
+  std::string text;
+  text.reserve(frames.size() * 20);
+  int64_t lastTime = 0;
+  for (const auto& frame : frames) {
+    text.append(std::to_string(frame.time - lastTime));
+    text.push_back('|');
+    AppendFloat(text, frame.pos.x);
+    text.push_back('|');
+    AppendFloat(text, frame.pos.y);
+    text.push_back('|');
+    text.append(std::to_string(frame.keys));
+    text.push_back(',');
+    lastTime = frame.time;
+  }
+  if (replaySeed) {
+    text.append("-12345|0|0|");
+    text.append(std::to_string(*replaySeed));
+    text.push_back(',');
+  }
+  return text;
+}
+
+}  // namespace osrp
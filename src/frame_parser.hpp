@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "frames.hpp"
+
+namespace osrp {
+
+// Writes the offset of every ',' and '|' in text to positions, which must
+// have room for text.size() entries, and returns how many were found. Uses
+// AVX2 or SSE2 when the CPU supports them and a scalar loop otherwise.
+size_t FindFrameDelimiters(std::string_view text, uint32_t* positions);
+
+// Name of the delimiter scanner selected for this CPU.
+const char* GetFrameDelimiterScanner();
+
+// Incremental parser for the decompressed "w|x|y|z," frame text of a replay.
+// Chunks may split a frame anywhere; only the frame straddling two chunks is
+// copied. Malformed frames, and frames FrameArray cannot store, are skipped.
+// replaySeed is set only if the text has a seed frame.
+class FrameParser {
+ public:
+  FrameParser(FrameArray& frames, std::optional<int32_t>& replaySeed)
+      : frames(frames), replaySeed(replaySeed) {}
+
+  void Feed(std::string_view chunk);
+  void Finish();
+
+ private:
+  FrameArray& frames;
+  std::optional<int32_t>& replaySeed;
+  std::string pending;
+  int64_t timeOffset = 0;
+
+  // text must end with ','.
+  void ParseFrames(std::string_view text);
+  void AddFrame(const std::string_view (&fields)[4]);
+};
+
+// Formats frames back into "w|x|y|z," text with delta times and the
+// shortest float representation that parses back to the same value. A seed
+// frame is appended if replaySeed is set.
+std::string FormatFrames(const FrameArray& frames,
+                         std::optional<int32_t> replaySeed);
+
+}  // namespace osrp
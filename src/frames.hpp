@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace osrp {
+
+struct Frame {
+  glm::vec2 pos;
+  int64_t time;
+  uint32_t keys;
+};
+
+// Structure-of-arrays storage for replay frames. Each field lives in its own
+// column (14 bytes per frame instead of 24 for a vector<Frame>), so scans over
+// a single field touch only that column. Iteration and indexing yield Frame
+// values, which keeps code written against vector<Frame> working. Times are
+// stored as absolute int32 milliseconds rather than the deltas of the .osr
+// text, so random access needs no prefix sum; keys keep their low 16 bits,
+// which hold every osu! key flag.
+class FrameArray {
+ public:
+  using size_type = size_t;
+  using value_type = Frame;
+
+  class Iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Frame;
+    using difference_type = std::ptrdiff_t;
+    using reference = Frame;
+
+    struct pointer {
+      Frame frame;
+      const Frame* operator->() const { return &frame; }
+    };
+
+    Iterator() = default;
+    Iterator(const FrameArray* frames, size_t index)
+        : frames(frames), index(index) {}
+
+    Frame operator*() const { return (*frames)[index]; }
+    pointer operator->() const { return pointer{**this}; }
+    Frame operator[](difference_type n) const { return *(*this + n); }
+
+    size_t Index() const { return index; }
+
+    Iterator& operator++() {
+      ++index;
+      return *this;
+    }
+    Iterator& operator--() {
+      --index;
+      return *this;
+    }
+    Iterator operator++(int) { return {frames, index++}; }
+    Iterator operator--(int) { return {frames, index--}; }
+    Iterator& operator+=(difference_type n) {
+      index += n;
+      return *this;
+    }
+    Iterator& operator-=(difference_type n) {
+      index -= n;
+      return *this;
+    }
+    Iterator operator+(difference_type n) const { return {frames, index + n}; }
+    Iterator operator-(difference_type n) const { return {frames, index - n}; }
+    friend Iterator operator+(difference_type n, const Iterator& it) {
+      return it + n;
+    }
+    difference_type operator-(const Iterator& other) const {
+      return static_cast<difference_type>(index) -
+             static_cast<difference_type>(other.index);
+    }
+
+    bool operator==(const Iterator& o) const { return index == o.index; }
+    bool operator!=(const Iterator& o) const { return index != o.index; }
+    bool operator<(const Iterator& o) const { return index < o.index; }
+    bool operator>(const Iterator& o) const { return index > o.index; }
+    bool operator<=(const Iterator& o) const { return index <= o.index; }
+    bool operator>=(const Iterator& o) const { return index >= o.index; }
+
+   private:
+    const FrameArray* frames = nullptr;
+    size_t index = 0;
+  };
+
+  using iterator = Iterator;
+  using const_iterator = Iterator;
+
+  FrameArray() = default;
+  FrameArray(std::vector<int32_t> times, std::vector<float> xs,
+             std::vector<float> ys, std::vector<uint16_t> keys)
+      : times(std::move(times)),
+        xs(std::move(xs)),
+        ys(std::move(ys)),
+        keys(std::move(keys)) {
+    if (this->xs.size() != size() || this->ys.size() != size() ||
+        this->keys.size() != size()) {
+      throw std::invalid_argument("frame columns differ in length");
+    }
+  }
+
+  size_t size() const { return times.size(); }
+  bool empty() const { return times.empty(); }
+
+  void reserve(size_t capacity) {
+    times.reserve(capacity);
+    xs.reserve(capacity);
+    ys.reserve(capacity);
+    keys.reserve(capacity);
+  }
+
+  void clear() {
+    times.clear();
+    xs.clear();
+    ys.clear();
+    keys.clear();
+  }
+
+  void shrink_to_fit() {
+    times.shrink_to_fit();
+    xs.shrink_to_fit();
+    ys.shrink_to_fit();
+    keys.shrink_to_fit();
+  }
+
+  // Whether frame fits the columns: a 32 bit time and 16 bit keys.
+  static bool CanStore(const Frame& frame) {
+    return frame.time >= std::numeric_limits<int32_t>::min() &&
+           frame.time <= std::numeric_limits<int32_t>::max() &&
+           frame.keys <= std::numeric_limits<uint16_t>::max();
+  }
+
+  // Throws std::out_of_range, storing nothing, unless CanStore(frame).
+  void push_back(const Frame& frame) {
+    if (!CanStore(frame)) {
+      throw std::out_of_range("frame time or keys out of range");
+    }
+    times.push_back(static_cast<int32_t>(frame.time));
+    xs.push_back(frame.pos.x);
+    ys.push_back(frame.pos.y);
+    keys.push_back(static_cast<uint16_t>(frame.keys));
+  }
+
+  Frame operator[](size_t index) const {
+    return Frame{glm::vec2(xs[index], ys[index]), times[index], keys[index]};
+  }
+  Frame front() const { return (*this)[0]; }
+  Frame back() const { return (*this)[size() - 1]; }
+
+  Iterator begin() const { return {this, 0}; }
+  Iterator end() const { return {this, size()}; }
+
+  // Column access, in milliseconds for times and osu!pixels for positions.
+  const std::vector<int32_t>& GetTimes() const { return times; }
+  const std::vector<float>& GetXs() const { return xs; }
+  const std::vector<float>& GetYs() const { return ys; }
+  const std::vector<uint16_t>& GetKeys() const { return keys; }
+
+  int64_t GetTime(size_t index) const { return times[index]; }
+  glm::vec2 GetPosition(size_t index) const {
+    return glm::vec2(xs[index], ys[index]);
+  }
+
+ private:
+  std::vector<int32_t> times;
+  std::vector<float> xs, ys;
+  std::vector<uint16_t> keys;
+};
+
+}  // namespace osrp
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #define PLAYFIELD_WIDTH 480.0f
 #define PLAYFIELD_HEIGHT 360.0f
 
@@ -10,5 +12,29 @@ namespace osrp {
     CTB = 2,
     MANIA = 3
   };
-}
 
+  // Bit flags stored in Replay::mods.
+  enum class Mod : int32_t {
+    NO_FAIL = 1 << 0,
+    EASY = 1 << 1,
+    TOUCH_DEVICE = 1 << 2,
+    HIDDEN = 1 << 3,
+    HARD_ROCK = 1 << 4,
+    SUDDEN_DEATH = 1 << 5,
+    DOUBLE_TIME = 1 << 6,
+    RELAX = 1 << 7,
+    HALF_TIME = 1 << 8,
+    NIGHTCORE = 1 << 9,
+    FLASHLIGHT = 1 << 10,
+    AUTOPLAY = 1 << 11,
+    SPUN_OUT = 1 << 12,
+    AUTOPILOT = 1 << 13,
+    PERFECT = 1 << 14,
+    TARGET_PRACTICE = 1 << 23,
+    SCORE_V2 = 1 << 29
+  };
+
+  inline bool HasMod(int32_t mods, Mod mod) {
+    return (mods & static_cast<int32_t>(mod)) != 0;
+  }
+}
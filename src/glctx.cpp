@@ -28,3 +28,6 @@ void osrp::GlfwWindowGLContext::BeginFrame() const { glfwPollEvents(); }
 
 void osrp::GlfwWindowGLContext::EndFrame() const { glfwSwapBuffers(window); }
 
+bool osrp::GlfwWindowGLContext::IsKeyDown(int key) const {
+  return glfwGetKey(window, key) == GLFW_PRESS;
+}
@@ -15,6 +15,8 @@ class GLContext {
   virtual bool ShouldClose() const = 0;
   virtual void BeginFrame() const = 0;
   virtual void EndFrame() const = 0;
+  // Whether the key (a GLFW_KEY_* code) is currently held down.
+  virtual bool IsKeyDown(int key) const = 0;
 };
 
 class GlfwWindowGLContext : public GLContext {
@@ -26,6 +28,7 @@ class GlfwWindowGLContext : public GLContext {
   bool ShouldClose() const;
   void BeginFrame() const;
   void EndFrame() const;
+  bool IsKeyDown(int key) const;
  private:
   GLFWwindow* window;
 };
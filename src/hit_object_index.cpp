@@ -0,0 +1,139 @@
+#include "hit_object_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+
+namespace osrp {
+
+HitObjectIndex::HitObjectIndex(const std::vector<int32_t>& times,
+                               const std::vector<double>& endTimes,
+                               const std::vector<float>& xs,
+                               const std::vector<float>& ys)
+    : times(times.begin(), times.end()), endTimes(endTimes) {
+  size_t count = times.size();
+  if (endTimes.size() != count || xs.size() != count || ys.size() != count) {
+    throw std::logic_error("Hit object arrays differ in size");
+  }
+  maxEndTimes.resize(count);
+  positions.resize(count);
+  double maxEnd = -std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < count; i++) {
+    maxEnd = std::max(maxEnd, endTimes[i]);
+    maxEndTimes[i] = maxEnd;
+    positions[i] = glm::vec2(xs[i], ys[i]);
+  }
+
+  // Counting sort into the cells keeps each cell in beatmap order.
+  std::vector<uint32_t> cells(count);
+  cellOffsets.assign(GRID_WIDTH * GRID_HEIGHT + 1, 0);
+  for (size_t i = 0; i < count; i++) {
+    cells[i] = CellCoordinate(xs[i], GRID_WIDTH) +
+               CellCoordinate(ys[i], GRID_HEIGHT) * GRID_WIDTH;
+    cellOffsets[cells[i] + 1]++;
+  }
+  for (size_t cell = 0; cell < GRID_WIDTH * GRID_HEIGHT; cell++) {
+    cellOffsets[cell + 1] += cellOffsets[cell];
+  }
+  cellObjects.resize(count);
+  cellMaxEndTimes.resize(count);
+  std::vector<uint32_t> fill(cellOffsets.begin(), cellOffsets.end() - 1);
+  for (size_t i = 0; i < count; i++) {
+    uint32_t slot = fill[cells[i]]++;
+    cellObjects[slot] = static_cast<uint32_t>(i);
+    cellMaxEndTimes[slot] =
+        slot > cellOffsets[cells[i]]
+            ? std::max(cellMaxEndTimes[slot - 1], endTimes[i])
+            : endTimes[i];
+  }
+}
+
+int32_t HitObjectIndex::CellCoordinate(float value, int32_t cells) {
+  auto cell = static_cast<int32_t>(std::floor(value / CELL_SIZE));
+  return std::clamp(cell, 0, cells - 1);
+}
+
+std::pair<size_t, size_t> HitObjectIndex::GetCandidates(double t0,
+                                                        double t1) const {
+  size_t first = std::lower_bound(maxEndTimes.begin(), maxEndTimes.end(), t0) -
+                 maxEndTimes.begin();
+  size_t last = std::upper_bound(times.begin(), times.end(), t1) -
+                times.begin();
+  return {first, std::max(first, last)};
+}
+
+void HitObjectIndex::FindActive(double t0, double t1,
+                                std::vector<uint32_t>& out) const {
+  auto [first, last] = GetCandidates(t0, t1);
+  for (size_t i = first; i < last; i++) {
+    if (endTimes[i] >= t0) out.push_back(static_cast<uint32_t>(i));
+  }
+}
+
+void HitObjectIndex::FindNear(glm::vec2 pos, float radius,
+                              std::vector<uint32_t>& out) const {
+  FindNearInRange(pos, radius, 0.0, 0.0, false, out);
+}
+
+void HitObjectIndex::FindNear(glm::vec2 pos, float radius, double t0,
+                              double t1, std::vector<uint32_t>& out) const {
+  FindNearInRange(pos, radius, t0, t1, true, out);
+}
+
+void HitObjectIndex::FindNearInRange(glm::vec2 pos, float radius, double t0,
+                                     double t1, bool timed,
+                                     std::vector<uint32_t>& out) const {
+  size_t start = out.size();
+  int32_t minX = CellCoordinate(pos.x - radius, GRID_WIDTH);
+  int32_t maxX = CellCoordinate(pos.x + radius, GRID_WIDTH);
+  int32_t minY = CellCoordinate(pos.y - radius, GRID_HEIGHT);
+  int32_t maxY = CellCoordinate(pos.y + radius, GRID_HEIGHT);
+  for (int32_t y = minY; y <= maxY; y++) {
+    for (int32_t x = minX; x <= maxX; x++) {
+      size_t cell = x + y * GRID_WIDTH;
+      size_t begin = cellOffsets[cell], end = cellOffsets[cell + 1];
+      if (timed) {
+        // The same two binary searches as GetCandidates, within the cell.
+        begin = std::lower_bound(cellMaxEndTimes.begin() + begin,
+                                 cellMaxEndTimes.begin() + end, t0) -
+                cellMaxEndTimes.begin();
+        end = std::partition_point(
+                  cellObjects.begin() + begin, cellObjects.begin() + end,
+                  [&](uint32_t object) { return times[object] <= t1; }) -
+              cellObjects.begin();
+      }
+      for (size_t slot = begin; slot < end; slot++) {
+        uint32_t object = cellObjects[slot];
+        if (timed && endTimes[object] < t0) continue;
+        if (glm::distance(positions[object], pos) <= radius) {
+          out.push_back(object);
+        }
+      }
+    }
+  }
+  if (minX != maxX || minY != maxY) std::sort(out.begin() + start, out.end());
+}
+
+const std::vector<uint32_t>& HitObjectWindow::Seek(double time) {
+  double t0 = time - linger, t1 = time + lead;
+  if (!started || time < lastTime) {
+    std::tie(first, last) = index->GetCandidates(t0, t1);
+    started = true;
+  } else {
+    size_t count = index->size();
+    while (first < count && index->maxEndTimes[first] < t0) first++;
+    while (last < count && index->times[last] <= t1) last++;
+    last = std::max(first, last);
+  }
+  lastTime = time;
+
+  visible.clear();
+  for (size_t i = first; i < last; i++) {
+    if (index->endTimes[i] >= t0) visible.push_back(static_cast<uint32_t>(i));
+  }
+  return visible;
+}
+
+}  // namespace osrp
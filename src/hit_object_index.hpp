@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+
+#include "judgement.hpp"
+
+namespace osrp {
+
+// Range queries over hit objects by time and by playfield position, so
+// finding the objects around a click or on screen does not scan the whole
+// map. Results are object indices in beatmap order.
+class HitObjectIndex {
+ public:
+  // The 512x384 playfield is split into 16x12 cells; objects off the
+  // playfield go to the nearest edge cell.
+  static constexpr float CELL_SIZE = 32.0f;
+  static constexpr int32_t GRID_WIDTH = 16, GRID_HEIGHT = 12;
+
+  HitObjectIndex() = default;
+  // Indexed by object, sorted by time like a beatmap.
+  HitObjectIndex(const std::vector<int32_t>& times,
+                 const std::vector<double>& endTimes,
+                 const std::vector<float>& xs, const std::vector<float>& ys);
+  explicit HitObjectIndex(const JudgementMap& map)
+      : HitObjectIndex(map.times, map.endTimes, map.xs, map.ys) {}
+
+  size_t size() const { return times.size(); }
+
+  // Objects active at some point of [t0, t1], i.e. starting no later than
+  // t1 and ending no earlier than t0, appended to out.
+  void FindActive(double t0, double t1, std::vector<uint32_t>& out) const;
+  // Objects within radius of pos, appended to out.
+  void FindNear(glm::vec2 pos, float radius, std::vector<uint32_t>& out) const;
+  // Objects within radius of pos and active in [t0, t1], appended to out.
+  void FindNear(glm::vec2 pos, float radius, double t0, double t1,
+                std::vector<uint32_t>& out) const;
+
+  // Index range holding every object active in [t0, t1]. Long objects such
+  // as spinners keep the range open, so it may contain inactive ones.
+  std::pair<size_t, size_t> GetCandidates(double t0, double t1) const;
+
+  double GetTime(size_t object) const { return times[object]; }
+  double GetEndTime(size_t object) const { return endTimes[object]; }
+  glm::vec2 GetPosition(size_t object) const { return positions[object]; }
+
+ private:
+  friend class HitObjectWindow;
+
+  std::vector<double> times, endTimes;
+  // Running maximum of endTimes. It never decreases, so the first object
+  // that can still be active at a time is a binary search away.
+  std::vector<double> maxEndTimes;
+  std::vector<glm::vec2> positions;
+  // Objects of each cell, row by row, in
+  // cellObjects[cellOffsets[cell]..cellOffsets[cell + 1]), with the running
+  // maximum of their end times per cell in cellMaxEndTimes.
+  std::vector<uint32_t> cellOffsets, cellObjects;
+  std::vector<double> cellMaxEndTimes;
+
+  static int32_t CellCoordinate(float value, int32_t cells);
+  void FindNearInRange(glm::vec2 pos, float radius, double t0, double t1,
+                       bool timed, std::vector<uint32_t>& out) const;
+};
+
+// Objects visible while time moves forward, e.g. during playback: from lead
+// milliseconds before an object's time until linger milliseconds after its
+// end. Consecutive seeks move the window incrementally; seeking backwards
+// falls back to binary search.
+class HitObjectWindow {
+ public:
+  HitObjectWindow(const HitObjectIndex& index, double lead, double linger)
+      : index(&index), lead(lead), linger(linger) {}
+
+  const std::vector<uint32_t>& Seek(double time);
+
+ private:
+  const HitObjectIndex* index;
+  double lead, linger;
+  double lastTime = 0.0;
+  size_t first = 0, last = 0;
+  bool started = false;
+  std::vector<uint32_t> visible;
+};
+
+}  // namespace osrp
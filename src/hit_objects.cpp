@@ -0,0 +1,229 @@
+#include "hit_objects.hpp"
+
+#include "strings.hpp"
+
+namespace osrp {
+
+namespace {
+
+enum HitObjectTypeBits {
+  CIRCLE_BIT = 1 << 0,
+  SLIDER_BIT = 1 << 1,
+  NEW_COMBO_BIT = 1 << 2,
+  SPINNER_BIT = 1 << 3,
+  COMBO_SKIP_BITS = 7 << 4,
+  HOLD_BIT = 1 << 7
+};
+
+// Same limit as lazer. Each slide stores an edge, so an unbounded count
+// would let one line allocate gigabytes.
+constexpr int32_t MAX_SLIDES = 9000;
+
+const std::error_code invalidArgument =
+    std::make_error_code(std::errc::invalid_argument);
+
+// Splits line on delim into at most N fields, returning how many were found.
+template <size_t N>
+size_t SplitFields(std::string_view line, char delim,
+                   std::string_view (&fields)[N]) {
+  size_t count = 0;
+  Split(line, delim, [&](const std::string_view& field) {
+    if (count < N) fields[count] = field;
+    count++;
+  });
+  return count;
+}
+
+template <typename T>
+bool ParseField(std::string_view str, T& value) {
+  auto result = ParseString<T>(str);
+  if (result) value = result.Value();
+  return result.HasValue();
+}
+
+// "normalSet:additionSet:index:volume:filename", every part optional.
+HitSample ParseHitSample(std::string_view str) {
+  HitSample sample;
+  std::string_view fields[5];
+  size_t count = SplitFields(str, ':', fields);
+  int value;
+  if (count > 0 && ParseField(fields[0], value)) sample.normalSet = value;
+  if (count > 1 && ParseField(fields[1], value)) sample.additionSet = value;
+  if (count > 2) ParseField(fields[2], sample.index);
+  if (count > 3 && ParseField(fields[3], value)) sample.volume = value;
+  return sample;
+}
+
+CurveType ParseCurveType(std::string_view str) {
+  switch (str.empty() ? 'B' : str[0]) {
+    case 'C':
+      return CurveType::CATMULL;
+    case 'L':
+      return CurveType::LINEAR;
+    case 'P':
+      return CurveType::PERFECT_CIRCLE;
+    default:
+      return CurveType::BEZIER;
+  }
+}
+
+}  // namespace
+
+Result<int> HitObjectList::Parse(std::string_view line) {
+  std::string_view fields[11];
+  size_t count = SplitFields(line, ',', fields);
+  if (count < 5) return Result<int>(invalidArgument);
+
+  HitObject object{};
+  int32_t type, hitSound;
+  double time;
+  if (!ParseField(fields[0], object.pos.x) ||
+      !ParseField(fields[1], object.pos.y) || !ParseField(fields[2], time) ||
+      !ParseField(fields[3], type) || !ParseField(fields[4], hitSound)) {
+    return Result<int>(invalidArgument);
+  }
+  object.time = object.endTime = static_cast<int32_t>(time);
+  object.newCombo = type & NEW_COMBO_BIT;
+  object.comboSkip = (type & COMBO_SKIP_BITS) >> 4;
+  object.hitSound = hitSound;
+
+  if (type & SLIDER_BIT) {
+    if (count < 8) return Result<int>(invalidArgument);
+    object.type = HitObjectType::SLIDER;
+    if (!ParseField(fields[6], object.slides) ||
+        !ParseField(fields[7], object.length) || object.slides < 1 ||
+        object.slides > MAX_SLIDES) {
+      return Result<int>(invalidArgument);
+    }
+    // Also catches NaN, which would otherwise reach the sample count.
+    if (!(object.length <= MAX_SLIDER_LENGTH)) {
+      object.length = MAX_SLIDER_LENGTH;
+    }
+
+    object.curvePointOffset = curvePoints.size();
+    bool first = true;
+    Split(fields[5], '|', [&](const std::string_view& token) {
+      if (first) {
+        object.curveType = ParseCurveType(token);
+        first = false;
+        return;
+      }
+      auto indexOfColon = token.find(':');
+      if (indexOfColon == std::string_view::npos) return;
+      glm::vec2 point;
+      if (ParseField(token.substr(0, indexOfColon), point.x) &&
+          ParseField(token.substr(indexOfColon + 1), point.y)) {
+        curvePoints.push_back(point);
+      }
+    });
+    object.curvePointCount = curvePoints.size() - object.curvePointOffset;
+
+    // Edge hitsounds default to the object's own when omitted.
+    object.sliderEdgeOffset = sliderEdges.size();
+    sliderEdges.resize(sliderEdges.size() + object.slides + 1,
+                       SliderEdge{object.hitSound, 0, 0});
+    auto edges = sliderEdges.begin() + object.sliderEdgeOffset;
+    if (count > 8) {
+      size_t i = 0;
+      Split(fields[8], '|', [&](const std::string_view& token) {
+        int value;
+        if (i <= static_cast<size_t>(object.slides) &&
+            ParseField(token, value)) {
+          edges[i].hitSound = value;
+        }
+        i++;
+      });
+    }
+    if (count > 9) {
+      size_t i = 0;
+      Split(fields[9], '|', [&](const std::string_view& token) {
+        if (i <= static_cast<size_t>(object.slides)) {
+          auto sample = ParseHitSample(token);
+          edges[i].normalSet = sample.normalSet;
+          edges[i].additionSet = sample.additionSet;
+        }
+        i++;
+      });
+    }
+    if (count > 10) object.sample = ParseHitSample(fields[10]);
+  } else if (type & SPINNER_BIT) {
+    object.type = HitObjectType::SPINNER;
+    if (count < 6 || !ParseField(fields[5], time)) {
+      return Result<int>(invalidArgument);
+    }
+    object.endTime = static_cast<int32_t>(time);
+    if (count > 6) object.sample = ParseHitSample(fields[6]);
+  } else if (type & HOLD_BIT) {
+    object.type = HitObjectType::HOLD;
+    if (count < 6) return Result<int>(invalidArgument);
+    auto indexOfColon = fields[5].find(':');
+    if (!ParseField(fields[5].substr(0, indexOfColon), time)) {
+      return Result<int>(invalidArgument);
+    }
+    object.endTime = static_cast<int32_t>(time);
+    if (indexOfColon != std::string_view::npos) {
+      object.sample = ParseHitSample(fields[5].substr(indexOfColon + 1));
+    }
+  } else {
+    object.type = HitObjectType::CIRCLE;
+    if (count > 5) object.sample = ParseHitSample(fields[5]);
+  }
+
+  objects.push_back(object);
+  return Result<int>(0);
+}
+
+Result<int32_t> ParseHitObjectEndTime(std::string_view line) {
+  std::string_view fields[8];
+  size_t count = SplitFields(line, ',', fields);
+  if (count < 5) return Result<int32_t>(invalidArgument);
+
+  float x, y;
+  int32_t type, hitSound;
+  double time;
+  if (!ParseField(fields[0], x) || !ParseField(fields[1], y) ||
+      !ParseField(fields[2], time) || !ParseField(fields[3], type) ||
+      !ParseField(fields[4], hitSound)) {
+    return Result<int32_t>(invalidArgument);
+  }
+
+  if (type & SLIDER_BIT) {
+    int32_t slides;
+    float length;
+    if (count < 8 || !ParseField(fields[6], slides) ||
+        !ParseField(fields[7], length) || slides < 1 || slides > MAX_SLIDES) {
+      return Result<int32_t>(invalidArgument);
+    }
+  } else if (type & (SPINNER_BIT | HOLD_BIT)) {
+    auto end = count < 6 ? std::string_view() : fields[5];
+    if (!(type & SPINNER_BIT)) end = end.substr(0, end.find(':'));
+    if (count < 6 || !ParseField(end, time)) {
+      return Result<int32_t>(invalidArgument);
+    }
+  }
+  return Result<int32_t>(static_cast<int32_t>(time));
+}
+
+Result<TimingPoint> ParseTimingPoint(std::string_view line) {
+  std::string_view fields[8];
+  size_t count = SplitFields(line, ',', fields);
+  if (count < 2) return Result<TimingPoint>(invalidArgument);
+
+  // Defaults for the fields older file versions omit.
+  TimingPoint point{0.0, 0.0, 4, 0, 0, 100, true, 0};
+  if (!ParseField(fields[0], point.time) ||
+      !ParseField(fields[1], point.beatLength)) {
+    return Result<TimingPoint>(invalidArgument);
+  }
+  point.uninherited = point.beatLength >= 0;
+  int value;
+  if (count > 2) ParseField(fields[2], point.meter);
+  if (count > 3 && ParseField(fields[3], value)) point.sampleSet = value;
+  if (count > 4 && ParseField(fields[4], value)) point.sampleIndex = value;
+  if (count > 5 && ParseField(fields[5], value)) point.volume = value;
+  if (count > 6 && ParseField(fields[6], value)) point.uninherited = value;
+  if (count > 7 && ParseField(fields[7], value)) point.effects = value;
+  return Result<TimingPoint>(point);
+}
+
+}  // namespace osrp
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string_view>
+#include <vector>
+
+#include "result.hpp"
+
+namespace osrp {
+
+enum class HitObjectType : uint8_t { CIRCLE, SLIDER, SPINNER, HOLD };
+
+enum class CurveType : uint8_t { BEZIER, CATMULL, LINEAR, PERFECT_CIRCLE };
+
+struct HitSample {
+  uint8_t normalSet = 0, additionSet = 0;
+  uint8_t volume = 0;
+  int32_t index = 0;
+};
+
+// Hitsound and sample sets played on one slider head, repeat or tail.
+struct SliderEdge {
+  uint8_t hitSound = 0;
+  uint8_t normalSet = 0, additionSet = 0;
+};
+
+struct HitObject {
+  glm::vec2 pos;
+  int32_t time;
+  // End of spinners and holds. Sliders keep time here, their duration
+  // depends on the timing points.
+  int32_t endTime;
+  HitObjectType type;
+  bool newCombo;
+  uint8_t comboSkip;
+  uint8_t hitSound;
+  HitSample sample;
+
+  // Slider fields. Control points after the head live in
+  // HitObjectList::curvePoints, the slides + 1 edge hitsounds in
+  // HitObjectList::sliderEdges.
+  CurveType curveType = CurveType::BEZIER;
+  int32_t slides = 0;
+  float length = 0.0f;
+  uint32_t curvePointOffset = 0, curvePointCount = 0;
+  uint32_t sliderEdgeOffset = 0;
+};
+
+// Hit objects of a beatmap with the variable-length slider data packed into
+// shared arrays instead of per-object allocations.
+struct HitObjectList {
+  std::vector<HitObject> objects;
+  std::vector<glm::vec2> curvePoints;
+  std::vector<SliderEdge> sliderEdges;
+
+  // Longest slider kept, in osu! pixels. Same limit as lazer's slider
+  // events; the path, ticks and end time all grow with the length.
+  static constexpr float MAX_SLIDER_LENGTH = 100000.0f;
+
+  // Parses one [HitObjects] line and appends it. Sliders with more than 9000
+  // slides are rejected, longer ones than MAX_SLIDER_LENGTH are cut short.
+  Result<int> Parse(std::string_view line);
+};
+
+struct TimingPoint {
+  double time;
+  // Milliseconds per beat for uninherited points, negative inverse slider
+  // velocity percentage (-100 = 1x) for inherited ones.
+  double beatLength;
+  int32_t meter;
+  uint8_t sampleSet, sampleIndex, volume;
+  bool uninherited;
+  uint8_t effects;
+};
+
+// End time of one [HitObjects] line as HitObjectList::Parse would give it,
+// without collecting slider points, edges or samples. Fails for the lines
+// Parse rejects.
+Result<int32_t> ParseHitObjectEndTime(std::string_view line);
+
+Result<TimingPoint> ParseTimingPoint(std::string_view line);
+
+}  // namespace osrp
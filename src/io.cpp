@@ -1,7 +1,107 @@
 #include "io.hpp"
 
+#include <functional>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 const bool osrp::IsLittleEndian = []() {
   int32_t i = 0x00000001;
   return reinterpret_cast<char*>(&i)[0];
 }();
 
+namespace osrp {
+
+#ifdef _WIN32
+MappedFile::MappedFile(const fs::path& path) {
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("unable to open file: " + path.string());
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    CloseHandle(file);
+    throw std::runtime_error("unable to stat file: " + path.string());
+  }
+  size = static_cast<size_t>(fileSize.QuadPart);
+  if (size > 0) {
+    HANDLE mapping =
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) {
+      data = static_cast<const uint8_t*>(
+          MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+      CloseHandle(mapping);
+    }
+  }
+  CloseHandle(file);
+  if (size > 0 && !data) {
+    throw std::runtime_error("unable to map file: " + path.string());
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data) UnmapViewOfFile(data);
+}
+#else
+MappedFile::MappedFile(const fs::path& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("unable to open file: " + path.string());
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("unable to stat file: " + path.string());
+  }
+  size = static_cast<size_t>(st.st_size);
+  if (size > 0) {
+    void* ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr != MAP_FAILED) data = static_cast<const uint8_t*>(ptr);
+  }
+  close(fd);
+  if (size > 0 && !data) {
+    throw std::runtime_error("unable to map file: " + path.string());
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data) munmap(const_cast<uint8_t*>(data), size);
+}
+#endif
+
+void WriteFileAtomic(const fs::path& path, const uint8_t* data, size_t size) {
+  // Unique per process and thread: thread ids repeat across processes.
+#ifdef _WIN32
+  auto processId = GetCurrentProcessId();
+#else
+  auto processId = getpid();
+#endif
+  auto tempPath = path;
+  tempPath += ".tmp" + std::to_string(processId) + "." +
+              std::to_string(std::hash<std::thread::id>{}(
+                  std::this_thread::get_id()));
+  {
+    std::ofstream output;
+    Open(output, tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    output.write(reinterpret_cast<const char*>(data), size);
+    if (!output) {
+      output.close();
+      std::error_code ec;
+      fs::remove(tempPath, ec);
+      throw std::runtime_error("unable to write " + tempPath.string());
+    }
+  }
+  fs::rename(tempPath, path);
+}
+
+}  // namespace osrp
@@ -2,9 +2,13 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace osrp {
 namespace fs = std::filesystem;
@@ -56,7 +60,7 @@ inline uintmax_t ReadULEB128(std::istream& stream) {
   int shift = 0;
   do {
     stream.read(reinterpret_cast<char*>(&byte), 1);
-    value |= (byte & 0x7f) << shift;
+    value |= static_cast<uintmax_t>(byte & 0x7f) << shift;
     shift += 7;
   } while (byte & 0x80);
   return value;
@@ -66,7 +70,7 @@ template <>
 inline std::string ReadBinary(std::istream& stream) {
   auto flag = ReadBinary<uint8_t>(stream);
   if (flag) {
-    assert(flag == 0x0b);
+    if (flag != 0x0b) throw std::runtime_error("invalid string flag");
     size_t length = ReadULEB128(stream);
     std::string value(length, '\0');
     stream.read(value.data(), length);
@@ -76,4 +80,200 @@ inline std::string ReadBinary(std::istream& stream) {
   }
 }
 
+// Checked reader over a binary stream, exposing the same interface as
+// BinaryReader so parsing code can be shared between the two.
+class StreamReader {
+ public:
+  explicit StreamReader(std::istream& stream) : stream(stream) {}
+
+  template <typename T>
+  T Read() {
+    auto value = ReadBinary<T>(stream);
+    if (!stream) throw std::runtime_error("unexpected end of stream");
+    return value;
+  }
+
+  uintmax_t ReadULEB128() { return osrp::ReadULEB128(stream); }
+
+  void Skip(size_t size) {
+    stream.seekg(size, std::ios::cur);
+    if (!stream) throw std::runtime_error("unexpected end of stream");
+  }
+
+ private:
+  std::istream& stream;
+};
+
+// Read-only memory mapping of a whole file. An empty file maps to a null
+// pointer with size 0.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  explicit MappedFile(const fs::path& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept
+      : data(std::exchange(other.data, nullptr)),
+        size(std::exchange(other.size, 0)) {}
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    std::swap(data, other.data);
+    std::swap(size, other.size);
+    return *this;
+  }
+
+  const uint8_t* Data() const { return data; }
+  size_t Size() const { return size; }
+
+ private:
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+};
+
+// Bounds-checked little-endian reader over an in-memory buffer, mirroring
+// ReadBinary for streams.
+class BinaryReader {
+ public:
+  BinaryReader(const uint8_t* data, size_t size)
+      : begin(data), ptr(data), end(data + size) {}
+  explicit BinaryReader(const MappedFile& file)
+      : BinaryReader(file.Data(), file.Size()) {}
+
+  template <typename T>
+  T Read() {
+    T value;
+    char* dst = reinterpret_cast<char*>(&value);
+    auto src = ReadBytes(sizeof(T));
+    std::copy(src, src + sizeof(T), dst);
+    if (!IsLittleEndian) {
+      std::reverse(dst, dst + sizeof(T));
+    }
+    return value;
+  }
+
+  uintmax_t ReadULEB128() {
+    uint8_t byte;
+    uintmax_t value = 0;
+    int shift = 0;
+    do {
+      byte = Read<uint8_t>();
+      value |= static_cast<uintmax_t>(byte & 0x7f) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    return value;
+  }
+
+  // Returns a pointer to the next size bytes without copying them.
+  const uint8_t* ReadBytes(size_t size) {
+    auto bytes = ptr;
+    Advance(size);
+    return bytes;
+  }
+
+  void Skip(size_t size) { Advance(size); }
+
+  size_t Offset() const { return static_cast<size_t>(ptr - begin); }
+  size_t Remaining() const { return static_cast<size_t>(end - ptr); }
+
+ private:
+  const uint8_t* begin;
+  const uint8_t* ptr;
+  const uint8_t* end;
+
+  void Advance(size_t size) {
+    if (size > Remaining()) {
+      throw std::runtime_error("unexpected end of binary data");
+    }
+    ptr += size;
+  }
+};
+
+template <>
+inline std::string BinaryReader::Read() {
+  auto flag = Read<uint8_t>();
+  if (flag) {
+    if (flag != 0x0b) throw std::runtime_error("invalid string flag");
+    size_t length = ReadULEB128();
+    auto chars = reinterpret_cast<const char*>(ReadBytes(length));
+    return std::string(chars, length);
+  } else {
+    return "";
+  }
+}
+
+// Little-endian writer into a growable buffer, the inverse of BinaryReader.
+class BinaryWriter {
+ public:
+  template <typename T>
+  void Write(const T& value) {
+    auto src = reinterpret_cast<const uint8_t*>(&value);
+    size_t offset = buffer.size();
+    buffer.insert(buffer.end(), src, src + sizeof(T));
+    if (!IsLittleEndian) {
+      std::reverse(buffer.begin() + offset, buffer.end());
+    }
+  }
+
+  void WriteULEB128(uintmax_t value) {
+    do {
+      uint8_t byte = value & 0x7f;
+      value >>= 7;
+      if (value) byte |= 0x80;
+      buffer.push_back(byte);
+    } while (value);
+  }
+
+  void WriteBytes(const uint8_t* data, size_t size) {
+    buffer.insert(buffer.end(), data, data + size);
+  }
+
+  const std::vector<uint8_t>& GetBuffer() const { return buffer; }
+  size_t Size() const { return buffer.size(); }
+
+ private:
+  std::vector<uint8_t> buffer;
+};
+
+template <>
+inline void BinaryWriter::Write(const std::string& value) {
+  if (value.empty()) {
+    Write<uint8_t>(0);
+  } else {
+    Write<uint8_t>(0x0b);
+    WriteULEB128(value.size());
+    WriteBytes(reinterpret_cast<const uint8_t*>(value.data()), value.size());
+  }
+}
+
+// Writes data to a temporary file next to path and renames it into place, so
+// concurrent readers never observe a partially written file.
+void WriteFileAtomic(const fs::path& path, const uint8_t* data, size_t size);
+
+inline uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// 64-bit FNV-1a, used to validate cache files.
+inline uint64_t HashFNV1a(const uint8_t* data, size_t size,
+                          uint64_t hash = 0xcbf29ce484222325ull) {
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// Skips a string encoded the way ReadBinary<std::string> expects it.
+template <typename Reader>
+inline void SkipString(Reader& reader) {
+  if (reader.template Read<uint8_t>()) {
+    reader.Skip(reader.ReadULEB128());
+  }
+}
+
 }  // namespace osrp
@@ -0,0 +1,410 @@
+#include "judgement.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "proximity.hpp"
+
+namespace osrp {
+
+namespace {
+constexpr double PI = 3.14159265358979323846;
+constexpr float FOLLOW_RADIUS_SCALE = 2.4f;
+// osu!stable checks the slider tail this long before the slider ends.
+constexpr double TAIL_LENIENCY = 36.0;
+const glm::vec2 SPINNER_CENTER(256.0f, 192.0f);
+// Fastest countable spinning, about 477 rotations per minute.
+constexpr double MAX_SPIN_PER_MS = 0.05;
+
+double ModScoreMultiplier(int32_t mods) {
+  if (HasMod(mods, Mod::RELAX) || HasMod(mods, Mod::AUTOPILOT)) return 0.0;
+  double multiplier = 1.0;
+  if (HasMod(mods, Mod::NO_FAIL)) multiplier *= 0.5;
+  if (HasMod(mods, Mod::EASY)) multiplier *= 0.5;
+  if (HasMod(mods, Mod::HALF_TIME)) multiplier *= 0.3;
+  if (HasMod(mods, Mod::HIDDEN)) multiplier *= 1.06;
+  if (HasMod(mods, Mod::HARD_ROCK)) multiplier *= 1.06;
+  if (HasMod(mods, Mod::DOUBLE_TIME)) multiplier *= 1.12;
+  if (HasMod(mods, Mod::FLASHLIGHT)) multiplier *= 1.12;
+  if (HasMod(mods, Mod::SPUN_OUT)) multiplier *= 0.9;
+  return multiplier;
+}
+
+// Drain time excludes the breaks listed in [Events].
+double DrainSeconds(const Beatmap& map, double start, double end) {
+  double drain = end - start;
+  for (const auto& row : map.GetEvents()) {
+    if (row.size() < 3 || (row[0] != "2" && row[0] != "Break")) continue;
+    auto breakStart = ParseString<double>(row[1]);
+    auto breakEnd = ParseString<double>(row[2]);
+    if (breakStart && breakEnd) {
+      drain -= breakEnd.Value() - breakStart.Value();
+    }
+  }
+  return std::max(drain, 0.0) / 1000.0;
+}
+
+// Left mouse, right mouse, K1 and K2. K1 and K2 also set the mouse bits,
+// so the mouse buttons only count when the key is not down.
+uint32_t LogicalButtons(uint32_t keys) {
+  uint32_t buttons = keys & 0xC;
+  if ((keys & 0x1) && !(keys & 0x4)) buttons |= 0x1;
+  if ((keys & 0x2) && !(keys & 0x8)) buttons |= 0x2;
+  return buttons;
+}
+}  // namespace
+
+HitWindows::HitWindows(double overallDifficulty)
+    // Whole milliseconds, with hits exactly on the boundary falling outside,
+    // like osu!stable.
+    : great(std::floor(DifficultyRange(overallDifficulty, 80, 50, 20)) - 0.5),
+      ok(std::floor(DifficultyRange(overallDifficulty, 140, 100, 60)) - 0.5),
+      meh(std::floor(DifficultyRange(overallDifficulty, 200, 150, 100)) -
+          0.5) {}
+
+HitResult HitWindows::ResultFor(double offset) const {
+  offset = std::abs(offset);
+  if (offset <= great) return HitResult::HIT300;
+  if (offset <= ok) return HitResult::HIT100;
+  if (offset <= meh) return HitResult::HIT50;
+  return HitResult::MISS;
+}
+
+JudgementMap::JudgementMap(const Beatmap& map, int32_t mods) {
+  using S = KeyValueSection;
+  auto difficulty = [&](std::string_view key, double fallback) {
+    auto value = map.GetProperty<double>(S::DIFFICULTY, key);
+    return value.HasValue() ? value.Value() : fallback;
+  };
+  const auto& modded = map.GetModded(mods);
+  double od = modded.overallDifficulty;
+  double sliderMultiplier = difficulty("SliderMultiplier", 1.4);
+  double tickRate = difficulty("SliderTickRate", 1.0);
+  // Before v8 the slider velocity did not scale the tick spacing, so faster
+  // sections have more ticks over the same distance.
+  bool legacyTickDistance = map.GetFormatVersion() < 8;
+  windows = HitWindows(od);
+  circleRadius = modded.circleRadius;
+
+  const auto& objects = map.GetHitObjects().objects;
+  const auto& paths = map.GetSliderPaths();
+  TimingCursor timing(map.GetTimingTimeline());
+  size_t count = objects.size();
+  times.resize(count);
+  endTimes.resize(count);
+  xs.resize(count);
+  ys.resize(count);
+  types.resize(count);
+  sliderParts.assign(count, 0);
+  spinsRequired.assign(count, 0.0f);
+
+  for (size_t i = 0; i < count; i++) {
+    const auto& object = objects[i];
+    auto pos = modded.positions[i];
+    times[i] = object.time;
+    endTimes[i] = object.endTime;
+    xs[i] = pos.x;
+    ys[i] = pos.y;
+    types[i] = object.type;
+    maxCombo++;
+
+    if (object.type == HitObjectType::SPINNER) {
+      spinners.push_back(static_cast<uint32_t>(i));
+      // osu!stable's 3-7.5 "rotations" are half turns.
+      double rotationsPerSecond = DifficultyRange(od, 1.5, 2.5, 3.75);
+      spinsRequired[i] = static_cast<float>(
+          (object.endTime - object.time) / 1000.0 * rotationsPerSecond);
+      continue;
+    }
+    if (object.type != HitObjectType::SLIDER) continue;
+
+    const auto& state = timing.Seek(object.time);
+    double spanDuration = state.GetSlideDuration(object.length,
+                                                 sliderMultiplier);
+    auto addCheckpoint = [&](double time, glm::vec2 checkpointPos,
+                             CheckpointType type) {
+      checkpoints.push_back(Checkpoint{time,
+                                       modded.Transform(i, checkpointPos),
+                                       static_cast<uint32_t>(i), type});
+      sliderParts[i]++;
+      maxCombo++;
+    };
+    // A slider without length or duration has no ball to follow: only its
+    // head and a tail at the head's time and position count.
+    if (!(object.length > 0.0f) || !(spanDuration > 0.0) ||
+        !std::isfinite(spanDuration)) {
+      addCheckpoint(object.time, object.pos, CheckpointType::TAIL);
+      continue;
+    }
+    double endTime = object.time + spanDuration * object.slides;
+    endTimes[i] = endTime;
+
+    // Ticks are spaced in pixels; none too close to the span end.
+    double velocity = object.length / spanDuration;
+    double tickDistance = sliderMultiplier * 100.0 / tickRate;
+    if (!legacyTickDistance) tickDistance *= state.sliderVelocity;
+    double minDistanceFromEnd = velocity * 10.0;
+    for (int32_t span = 0; span < object.slides; span++) {
+      double spanStart = object.time + span * spanDuration;
+      bool reversed = span % 2 == 1;
+      for (double d = tickDistance; d < object.length - minDistanceFromEnd;
+           d += tickDistance) {
+        float progress = static_cast<float>(d / object.length);
+        addCheckpoint(spanStart + d / velocity,
+                      paths.GetPosition(i, reversed ? 1.0f - progress
+                                                    : progress),
+                      CheckpointType::TICK);
+      }
+      if (span + 1 < object.slides) {
+        addCheckpoint(spanStart + spanDuration,
+                      paths.GetPosition(i, reversed ? 0.0f : 1.0f),
+                      CheckpointType::REPEAT);
+      }
+    }
+    // The tail is checked where the ball is at that time, not at the end.
+    double tailTime = std::max(object.time + spanDuration * object.slides / 2.0,
+                               endTime - TAIL_LENIENCY);
+    addCheckpoint(tailTime,
+                  paths.GetBallPosition(i, static_cast<float>(
+                                               (tailTime - object.time) /
+                                               (endTime - object.time))),
+                  CheckpointType::TAIL);
+  }
+
+  std::stable_sort(checkpoints.begin(), checkpoints.end(),
+                   [](const Checkpoint& a, const Checkpoint& b) {
+                     return a.time < b.time;
+                   });
+  for (size_t i = 0; i < count; i++) {
+    if (types[i] == HitObjectType::SLIDER) sliderParts[i]++;
+  }
+
+  if (count > 0) {
+    // Uses the difficulty values before mods.
+    double lastEnd = *std::max_element(endTimes.begin(), endTimes.end());
+    double drain = DrainSeconds(map, times.front(), lastEnd);
+    double density =
+        drain > 0.0 ? std::clamp(count / drain * 8.0, 0.0, 16.0) : 16.0;
+    double difficultyPoints = difficulty("HPDrainRate", 5.0) +
+                              difficulty("CircleSize", 5.0) +
+                              difficulty("OverallDifficulty", 5.0) + density;
+    scoreMultiplier =
+        std::round(difficultyPoints / 38.0 * 5.0) * ModScoreMultiplier(mods);
+  }
+}
+
+bool JudgementResult::MatchesHeader(const ReplayHeader& header) const {
+  return count300 == static_cast<uint32_t>(header.no_300s) &&
+         count100 == static_cast<uint32_t>(header.no_100s) &&
+         count50 == static_cast<uint32_t>(header.no_50s) &&
+         countMiss == static_cast<uint32_t>(header.no_misses) &&
+         maxCombo == static_cast<uint32_t>(header.maxCombo);
+}
+
+JudgementResult Judge(const JudgementMap& map, const FrameArray& frames) {
+  size_t count = map.size();
+  JudgementResult result;
+  result.results.assign(count, HitResult::MISS);
+
+  // Circles and slider heads still waiting for a press.
+  std::vector<uint8_t> headJudged(count, 0);
+  // Slider parts hit and still unresolved.
+  std::vector<uint32_t> partsHit(count, 0), partsLeft(map.sliderParts);
+  std::vector<double> spinRotation(count, 0.0);
+
+  uint32_t combo = 0;
+  auto addCombo = [&]() {
+    combo++;
+    result.maxCombo = std::max(result.maxCombo, combo);
+  };
+  // Judgement score scaled by the combo before the hit.
+  auto addScore = [&](HitResult hit) {
+    constexpr int32_t VALUES[] = {0, 50, 100, 300};
+    int32_t value = VALUES[static_cast<size_t>(hit)];
+    int64_t comboMultiplier = std::max<int64_t>(int64_t{combo} - 1, 0);
+    result.score += value + static_cast<int64_t>(value * comboMultiplier *
+                                                 map.scoreMultiplier / 25.0);
+  };
+  auto resolveSliderPart = [&](size_t object, bool hit, int32_t points) {
+    if (hit) {
+      partsHit[object]++;
+      result.sliderPartsHit++;
+      result.score += points;
+    } else {
+      result.sliderPartsMissed++;
+    }
+    if (--partsLeft[object] > 0) return;
+    double fraction =
+        static_cast<double>(partsHit[object]) / map.sliderParts[object];
+    auto sliderHit = fraction >= 1.0   ? HitResult::HIT300
+                     : fraction >= 0.5 ? HitResult::HIT100
+                     : fraction > 0.0  ? HitResult::HIT50
+                                       : HitResult::MISS;
+    result.results[object] = sliderHit;
+    addScore(sliderHit);
+  };
+  auto judgeHead = [&](size_t object, HitResult hit) {
+    headJudged[object] = 1;
+    bool isSlider = map.types[object] == HitObjectType::SLIDER;
+    if (!isSlider) addScore(hit);
+    if (hit == HitResult::MISS) {
+      combo = 0;
+    } else {
+      addCombo();
+    }
+    if (isSlider) {
+      resolveSliderPart(object, hit != HitResult::MISS, 30);
+    } else {
+      result.results[object] = hit;
+    }
+  };
+
+  size_t firstHead = 0, nextCheckpoint = 0, nextSpinner = 0;
+  auto skipJudged = [&]() {
+    while (firstHead < count &&
+           (headJudged[firstHead] ||
+            map.types[firstHead] == HitObjectType::SPINNER)) {
+      firstHead++;
+    }
+  };
+
+  glm::vec2 pos(0.0f);
+  uint32_t buttons = 0;
+  double lastTime = -std::numeric_limits<double>::infinity();
+  float followRadius = map.circleRadius * FOLLOW_RADIUS_SCALE;
+
+  // Settles everything that happens before time with the input state of
+  // the previous frame.
+  auto advance = [&](double time) {
+    for (; nextCheckpoint < map.checkpoints.size() &&
+           map.checkpoints[nextCheckpoint].time < time;
+         nextCheckpoint++) {
+      const auto& checkpoint = map.checkpoints[nextCheckpoint];
+      bool tracking = buttons != 0 &&
+                      glm::distance(pos, checkpoint.pos) <= followRadius;
+      if (tracking) {
+        addCombo();
+      } else if (checkpoint.type != JudgementMap::CheckpointType::TAIL) {
+        combo = 0;
+      }
+      resolveSliderPart(
+          checkpoint.object, tracking,
+          checkpoint.type == JudgementMap::CheckpointType::TICK ? 10 : 30);
+    }
+
+    for (skipJudged(); firstHead < count &&
+                       map.times[firstHead] + map.windows.meh < time;
+         skipJudged()) {
+      judgeHead(firstHead, HitResult::MISS);
+    }
+
+    for (; nextSpinner < map.spinners.size() &&
+           map.endTimes[map.spinners[nextSpinner]] < time;
+         nextSpinner++) {
+      auto spinner = map.spinners[nextSpinner];
+      double progress = spinRotation[spinner] / (2.0 * PI) /
+                        std::max(map.spinsRequired[spinner], 1.0f);
+      auto hit = progress >= 1.0   ? HitResult::HIT300
+                 : progress > 0.9  ? HitResult::HIT100
+                 : progress > 0.75 ? HitResult::HIT50
+                                   : HitResult::MISS;
+      result.results[spinner] = hit;
+      addScore(hit);
+      // 100 per required rotation, 1000 per bonus rotation.
+      auto rotations = static_cast<int64_t>(spinRotation[spinner] / (2.0 * PI));
+      auto required = static_cast<int64_t>(map.spinsRequired[spinner]);
+      result.score += 100 * std::min(rotations, required) +
+                      1000 * std::max<int64_t>(rotations - required, 0);
+      if (hit == HitResult::MISS) {
+        combo = 0;
+      } else {
+        addCombo();
+      }
+    }
+  };
+
+  auto isPending = [&](size_t i) {
+    return !headJudged[i] && map.types[i] != HitObjectType::SPINNER;
+  };
+  std::vector<uint32_t> nearby;
+  auto press = [&](double time) {
+    skipJudged();
+    // Candidates are the objects whose hit window has opened, up to and
+    // including the first pending one still ahead of time: note lock makes
+    // later objects hittable only once its time has passed. Expired ones
+    // were already missed by advance.
+    size_t end = firstHead;
+    while (end < count && map.times[end] - map.windows.meh <= time) {
+      if (isPending(end++) && map.times[end - 1] > time) break;
+    }
+    if (end == firstHead) return;
+
+    nearby.resize(end - firstHead);
+    size_t found = FindPointsInRadius(
+        map.xs.data() + firstHead, map.ys.data() + firstHead, end - firstHead,
+        pos, map.circleRadius, nearby.data());
+    for (size_t n = 0; n < found; n++) {
+      size_t i = firstHead + nearby[n];
+      if (!isPending(i)) continue;
+      // Hitting an object misses the ones before it.
+      for (size_t j = firstHead; j < i; j++) {
+        if (isPending(j)) judgeHead(j, HitResult::MISS);
+      }
+      judgeHead(i, map.windows.ResultFor(time - map.times[i]));
+      return;
+    }
+  };
+
+  const auto& times = frames.GetTimes();
+  const auto& xs = frames.GetXs();
+  const auto& ys = frames.GetYs();
+  const auto& keys = frames.GetKeys();
+  for (size_t i = 0; i < frames.size(); i++) {
+    // The lead-in frames may go back in time; never judge backwards.
+    double time = std::max<double>(times[i], lastTime);
+    advance(time);
+
+    glm::vec2 newPos(xs[i], ys[i]);
+    // Spinning only counts while a button is held.
+    if (buttons != 0 && nextSpinner < map.spinners.size()) {
+      auto spinner = map.spinners[nextSpinner];
+      if (time >= map.times[spinner]) {
+        auto from = pos - SPINNER_CENTER, to = newPos - SPINNER_CENTER;
+        double angle = std::atan2(from.x * to.y - from.y * to.x,
+                                  glm::dot(from, to));
+        spinRotation[spinner] += std::min(std::abs(angle),
+                                          MAX_SPIN_PER_MS * (time - lastTime));
+      }
+    }
+    pos = newPos;
+    auto newButtons = LogicalButtons(keys[i]);
+    for (auto pressed = newButtons & ~buttons; pressed != 0;
+         pressed &= pressed - 1) {
+      press(time);
+    }
+    buttons = newButtons;
+    lastTime = time;
+  }
+  advance(std::numeric_limits<double>::infinity());
+
+  for (auto hit : result.results) {
+    switch (hit) {
+      case HitResult::HIT300:
+        result.count300++;
+        break;
+      case HitResult::HIT100:
+        result.count100++;
+        break;
+      case HitResult::HIT50:
+        result.count50++;
+        break;
+      case HitResult::MISS:
+        result.countMiss++;
+        break;
+    }
+  }
+  return result;
+}
+
+}  // namespace osrp
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "beatmap.hpp"
+#include "frames.hpp"
+#include "replay.hpp"
+
+namespace osrp {
+
+enum class HitResult : uint8_t { MISS, HIT50, HIT100, HIT300 };
+
+// osu!standard difficulty values after mods, in milliseconds and osu!
+// pixels.
+struct HitWindows {
+  double great, ok, meh;
+
+  explicit HitWindows(double overallDifficulty);
+  HitResult ResultFor(double offset) const;
+};
+
+// Everything judging needs from a beatmap for one mod combination, laid out
+// as arrays sorted by time. Immutable once built, so any number of replays
+// can be judged against one instance concurrently.
+struct JudgementMap {
+  enum class CheckpointType : uint8_t { TICK, REPEAT, TAIL };
+
+  // Slider tick, repeat or tail, checked for tracking at time.
+  struct Checkpoint {
+    double time;
+    glm::vec2 pos;
+    uint32_t object;
+    CheckpointType type;
+  };
+
+  JudgementMap(const Beatmap& map, int32_t mods);
+
+  size_t size() const { return times.size(); }
+
+  // Per hit object, in beatmap order.
+  std::vector<int32_t> times;
+  std::vector<double> endTimes;
+  std::vector<float> xs, ys;
+  std::vector<HitObjectType> types;
+  // Slider checkpoints plus one for the head; spinner rotations needed.
+  std::vector<uint32_t> sliderParts;
+  std::vector<float> spinsRequired;
+
+  // All slider checkpoints, sorted by time.
+  std::vector<Checkpoint> checkpoints;
+  // Indices of the spinners, in beatmap order.
+  std::vector<uint32_t> spinners;
+
+  HitWindows windows{5.0};
+  float circleRadius = 0.0f;
+  // Combo of a full combo play.
+  uint32_t maxCombo = 0;
+  // Score V1 difficulty multiplier times the mod multiplier.
+  double scoreMultiplier = 1.0;
+};
+
+struct JudgementResult {
+  std::vector<HitResult> results;
+  uint32_t count300 = 0, count100 = 0, count50 = 0, countMiss = 0;
+  uint32_t maxCombo = 0;
+  // Score V1, including slider part and spinner bonus points.
+  int64_t score = 0;
+  // Slider heads, ticks, repeats and tails, which count towards combo.
+  uint32_t sliderPartsHit = 0, sliderPartsMissed = 0;
+
+  // Whether the counts and combo equal those stored in the replay.
+  bool MatchesHeader(const ReplayHeader& header) const;
+};
+
+// Replays frames against map in a single pass. Presses are judged with
+// osu!stable style note lock: a press can only hit an object once every
+// earlier one has been judged or its hit time has passed, and hitting an
+// object misses the unjudged ones before it.
+JudgementResult Judge(const JudgementMap& map, const FrameArray& frames);
+
+}  // namespace osrp
@@ -0,0 +1,280 @@
+#include "library.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "beatmap.hpp"
+
+// Index layout, native little-endian:
+//   "OSRL", u32 version, u32 record count, u32 string table size,
+//   LibraryString root, records sorted by (md5, path), string table
+
+namespace osrp {
+
+namespace {
+constexpr char INDEX_MAGIC[4] = {'O', 'S', 'R', 'L'};
+constexpr uint32_t INDEX_VERSION = 1;
+constexpr size_t HEADER_SIZE = 24;
+static_assert(HEADER_SIZE % alignof(LibraryRecord) == 0);
+
+// Record whose strings are owned, before they go into the string table.
+struct PendingRecord {
+  LibraryRecord record{};
+  std::string path, artist, title, creator, version;
+  // Taken unchanged from the previous index.
+  bool reused = false;
+};
+
+template <typename T>
+T PropertyOr(const Beatmap& map, KeyValueSection section,
+             std::string_view key, T fallback) {
+  auto value = map.GetProperty<T>(section, key);
+  return value.HasValue() ? value.Value() : fallback;
+}
+
+void ReadBeatmap(const fs::path& path, PendingRecord& pending) {
+  auto& record = pending.record;
+  // The digest comes from the same mapping the properties are read from.
+  Beatmap map(path, BeatmapLoading::LAZY);
+  record.md5 = map.GetMD5();
+  using S = KeyValueSection;
+  pending.artist = PropertyOr<std::string_view>(map, S::METADATA, "Artist", "");
+  pending.title = PropertyOr<std::string_view>(map, S::METADATA, "Title", "");
+  pending.creator =
+      PropertyOr<std::string_view>(map, S::METADATA, "Creator", "");
+  pending.version =
+      PropertyOr<std::string_view>(map, S::METADATA, "Version", "");
+  record.beatmapId = PropertyOr(map, S::METADATA, "BeatmapID", 0);
+  record.beatmapSetId = PropertyOr(map, S::METADATA, "BeatmapSetID", -1);
+  record.mode = PropertyOr(map, S::GENERAL, "Mode", 0);
+  record.circleSize = PropertyOr(map, S::DIFFICULTY, "CircleSize", 5.0f);
+  record.overallDifficulty =
+      PropertyOr(map, S::DIFFICULTY, "OverallDifficulty", 5.0f);
+  // Old maps have no ApproachRate and use the OD for it.
+  record.approachRate = PropertyOr(map, S::DIFFICULTY, "ApproachRate",
+                                   record.overallDifficulty);
+  record.hpDrainRate = PropertyOr(map, S::DIFFICULTY, "HPDrainRate", 5.0f);
+
+  auto summary = map.SummarizeHitObjects();
+  record.hitObjectCount = summary.count;
+  record.length = summary.lastEndTime;
+}
+
+LibraryString AddString(std::string& table, std::string_view string) {
+  LibraryString ref{static_cast<uint32_t>(table.size()),
+                    static_cast<uint32_t>(string.size())};
+  table.append(string);
+  return ref;
+}
+
+void WriteIndex(const fs::path& path, const fs::path& root,
+                std::vector<PendingRecord>& pending) {
+  std::sort(pending.begin(), pending.end(),
+            [](const PendingRecord& a, const PendingRecord& b) {
+              if (a.record.md5 != b.record.md5) {
+                return a.record.md5 < b.record.md5;
+              }
+              return a.path < b.path;
+            });
+
+  std::string table;
+  auto rootRef = AddString(table, root.generic_string());
+  std::vector<LibraryRecord> records;
+  records.reserve(pending.size());
+  for (auto& p : pending) {
+    auto record = p.record;
+    record.path = AddString(table, p.path);
+    record.artist = AddString(table, p.artist);
+    record.title = AddString(table, p.title);
+    record.creator = AddString(table, p.creator);
+    record.version = AddString(table, p.version);
+    records.push_back(record);
+  }
+
+  BinaryWriter output;
+  output.WriteBytes(reinterpret_cast<const uint8_t*>(INDEX_MAGIC),
+                    sizeof(INDEX_MAGIC));
+  output.Write(INDEX_VERSION);
+  output.Write(static_cast<uint32_t>(records.size()));
+  output.Write(static_cast<uint32_t>(table.size()));
+  output.Write(rootRef.offset);
+  output.Write(rootRef.length);
+  output.WriteBytes(reinterpret_cast<const uint8_t*>(records.data()),
+                    records.size() * sizeof(LibraryRecord));
+  output.WriteBytes(reinterpret_cast<const uint8_t*>(table.data()),
+                    table.size());
+  const auto& buffer = output.GetBuffer();
+  WriteFileAtomic(path, buffer.data(), buffer.size());
+}
+}  // namespace
+
+LibraryIndex::LibraryIndex(const fs::path& path) : file(path) {
+  if (!IsLittleEndian) {
+    throw std::runtime_error("library index requires a little-endian host");
+  }
+  BinaryReader input(file);
+  auto magic = input.ReadBytes(sizeof(INDEX_MAGIC));
+  if (std::memcmp(magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+      input.Read<uint32_t>() != INDEX_VERSION) {
+    throw std::runtime_error("not a library index: " + path.string());
+  }
+  count = input.Read<uint32_t>();
+  auto stringsSize = input.Read<uint32_t>();
+  root.offset = input.Read<uint32_t>();
+  root.length = input.Read<uint32_t>();
+  if (input.Remaining() != count * sizeof(LibraryRecord) + stringsSize) {
+    throw std::runtime_error("truncated library index: " + path.string());
+  }
+  records = reinterpret_cast<const LibraryRecord*>(
+      input.ReadBytes(count * sizeof(LibraryRecord)));
+  strings = std::string_view(
+      reinterpret_cast<const char*>(input.ReadBytes(stringsSize)),
+      stringsSize);
+}
+
+std::string_view LibraryIndex::GetString(LibraryString string) const {
+  if (uint64_t(string.offset) + string.length > strings.size()) {
+    throw std::runtime_error("library index string out of range");
+  }
+  return strings.substr(string.offset, string.length);
+}
+
+fs::path LibraryIndex::GetRoot() const {
+  return fs::u8path(GetString(root));
+}
+
+fs::path LibraryIndex::GetPath(const LibraryRecord& record) const {
+  return GetRoot() / fs::u8path(GetString(record.path));
+}
+
+const LibraryRecord* LibraryIndex::Find(const Md5Digest& md5) const {
+  auto it = std::lower_bound(
+      begin(), end(), md5,
+      [](const LibraryRecord& r, const Md5Digest& d) { return r.md5 < d; });
+  return it != end() && it->md5 == md5 ? it : nullptr;
+}
+
+const LibraryRecord* LibraryIndex::Find(std::string_view md5Hex) const {
+  auto md5 = ParseMD5(md5Hex);
+  return md5 ? Find(*md5) : nullptr;
+}
+
+LibraryIndex ScanLibrary(const fs::path& songsDir, const fs::path& indexPath,
+                         ThreadPool& pool, LibraryScanStats* stats) {
+  auto start = std::chrono::steady_clock::now();
+  auto root = fs::absolute(songsDir).lexically_normal();
+  if (root.filename().empty()) root = root.parent_path();
+
+  // A missing, corrupt or differently rooted index just means a full scan.
+  LibraryIndex previous;
+  std::error_code err;
+  if (fs::is_regular_file(indexPath, err)) {
+    try {
+      previous = LibraryIndex(indexPath);
+      if (previous.GetRoot() != root) previous = LibraryIndex();
+    } catch (const std::runtime_error&) {
+    }
+  }
+  std::unordered_map<std::string_view, const LibraryRecord*> previousByPath;
+  previousByPath.reserve(previous.size());
+  for (const auto& record : previous) {
+    previousByPath.emplace(previous.GetString(record.path), &record);
+  }
+
+  auto addFile = [&](const fs::directory_entry& entry,
+                     std::vector<PendingRecord>& found) {
+    std::error_code err;
+    if (!entry.is_regular_file(err) || entry.path().extension() != ".osu") {
+      return;
+    }
+    auto& p = found.emplace_back();
+    p.path = entry.path().lexically_relative(root).generic_string();
+    p.record.mtime = entry.last_write_time(err).time_since_epoch().count();
+    p.record.fileSize = entry.file_size(err);
+
+    auto it = previousByPath.find(p.path);
+    if (it != previousByPath.end() && it->second->mtime == p.record.mtime &&
+        it->second->fileSize == p.record.fileSize) {
+      auto& old = *it->second;
+      p.record = old;
+      p.artist = previous.GetString(old.artist);
+      p.title = previous.GetString(old.title);
+      p.creator = previous.GetString(old.creator);
+      p.version = previous.GetString(old.version);
+      p.reused = true;
+    }
+  };
+
+  // Every top-level folder is a beatmap set; each is walked on the pool.
+  std::vector<PendingRecord> pending;
+  std::vector<fs::path> folders;
+  auto options = fs::directory_options::skip_permission_denied;
+  for (const auto& entry : fs::directory_iterator(root, options)) {
+    if (entry.is_directory(err)) {
+      folders.push_back(entry.path());
+    } else {
+      addFile(entry, pending);
+    }
+  }
+  std::vector<std::vector<PendingRecord>> found(folders.size());
+  ParallelFor(pool, folders.size(), [&](size_t i) {
+    for (const auto& entry :
+         fs::recursive_directory_iterator(folders[i], options)) {
+      addFile(entry, found[i]);
+    }
+  });
+  for (auto& records : found) {
+    std::move(records.begin(), records.end(), std::back_inserter(pending));
+  }
+
+  std::vector<size_t> changed;
+  size_t reused = 0;
+  for (size_t i = 0; i < pending.size(); i++) {
+    if (pending[i].reused) {
+      reused++;
+    } else {
+      changed.push_back(i);
+    }
+  }
+
+  std::atomic<size_t> failures = 0;
+  ParallelFor(pool, changed.size(), [&](size_t i) {
+    auto& p = pending[changed[i]];
+    try {
+      ReadBeatmap(root / fs::u8path(p.path), p);
+    } catch (const std::exception&) {
+      // Keep the file in the index so it is not retried until it changes.
+      p.record.invalid = 1;
+      failures++;
+    }
+  });
+
+  bool unchanged = changed.empty() && reused == previous.size();
+  if (!unchanged) {
+    // Release the mapping first, it cannot be replaced while open on Windows.
+    previousByPath.clear();
+    previous = LibraryIndex();
+    WriteIndex(indexPath, root, pending);
+    previous = LibraryIndex(indexPath);
+  }
+
+  if (stats) {
+    stats->files = pending.size();
+    stats->parsed = changed.size();
+    stats->reused = reused;
+    stats->failures = failures;
+    stats->written = !unchanged;
+    stats->seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  }
+  return previous;
+}
+
+}  // namespace osrp
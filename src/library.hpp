@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "io.hpp"
+#include "md5.hpp"
+#include "thread_pool.hpp"
+
+namespace osrp {
+
+// Range of the index string table.
+struct LibraryString {
+  uint32_t offset, length;
+};
+
+// One .osu file of the library. Records are stored as-is in the index file,
+// so this struct is its on-disk layout and must stay trivially copyable.
+struct LibraryRecord {
+  Md5Digest md5;
+  // File modification time (file_time_type ticks) and size at scan time.
+  int64_t mtime;
+  uint64_t fileSize;
+  // path is relative to the scanned songs directory.
+  LibraryString path, artist, title, creator, version;
+  int32_t beatmapId, beatmapSetId, mode;
+  float circleSize, approachRate, overallDifficulty, hpDrainRate;
+  uint32_t hitObjectCount;
+  // Time of the end of the last hit object, in milliseconds.
+  int32_t length;
+  // Set when the file could not be parsed; only md5 and path are valid.
+  uint32_t invalid;
+};
+static_assert(std::is_trivially_copyable_v<LibraryRecord> &&
+              sizeof(LibraryRecord) == 112);
+
+// Memory mapped song library index, sorted by MD5. Opening it only maps the
+// file; lookups binary search the records in place.
+class LibraryIndex {
+ public:
+  LibraryIndex() = default;
+  // Throws std::runtime_error if the file is missing or malformed.
+  explicit LibraryIndex(const fs::path& path);
+
+  const LibraryRecord* begin() const { return records; }
+  const LibraryRecord* end() const { return records + count; }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  // Songs directory the index was built from.
+  fs::path GetRoot() const;
+  std::string_view GetString(LibraryString string) const;
+  fs::path GetPath(const LibraryRecord& record) const;
+
+  // First record with the given digest, or nullptr. Copies of a map in
+  // several folders share a digest and are adjacent.
+  const LibraryRecord* Find(const Md5Digest& md5) const;
+  const LibraryRecord* Find(std::string_view md5Hex) const;
+
+ private:
+  MappedFile file;
+  const LibraryRecord* records = nullptr;
+  size_t count = 0;
+  std::string_view strings;
+  LibraryString root{};
+};
+
+struct LibraryScanStats {
+  // parsed counts files that were (re)hashed, reused those taken from the
+  // previous index because their size and mtime were unchanged.
+  size_t files = 0, parsed = 0, reused = 0, failures = 0;
+  // False if nothing changed and the index file was left untouched.
+  bool written = false;
+  double seconds = 0.0;
+};
+
+// Scans songsDir recursively for .osu files and brings the index at
+// indexPath up to date. Top-level folders are walked in parallel on the
+// pool. Only new or modified files are read, each mapped once for both its
+// hash and its metadata; hit objects are counted, not parsed.
+LibraryIndex ScanLibrary(const fs::path& songsDir, const fs::path& indexPath,
+                         ThreadPool& pool, LibraryScanStats* stats = nullptr);
+
+}  // namespace osrp
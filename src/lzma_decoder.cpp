@@ -0,0 +1,137 @@
+#include "lzma_decoder.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace osrp {
+
+namespace {
+constexpr size_t LZMA_HEADER_SIZE = LZMA_PROPS_SIZE + 8;
+// Dictionaries are capped to the stream size, rounded up to a power of two
+// from this minimum so that consecutive replays reuse the same block.
+constexpr UInt32 MIN_DICTIONARY_SIZE = 64 * 1024;
+}  // namespace
+
+LzmaArena::LzmaArena() : handle{{Alloc, Free}, this} {}
+
+LzmaArena::~LzmaArena() {
+  for (auto& block : freeBlocks) std::free(block.data);
+  for (auto& block : usedBlocks) std::free(block.data);
+}
+
+void* LzmaArena::Alloc(ISzAllocPtr p, size_t size) {
+  auto arena = reinterpret_cast<const Handle*>(p)->arena;
+  auto& blocks = arena->freeBlocks;
+  auto best = blocks.end();
+  for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+    if (it->capacity >= size &&
+        (best == blocks.end() || it->capacity < best->capacity)) {
+      best = it;
+    }
+  }
+
+  Block block;
+  if (best != blocks.end()) {
+    block = *best;
+    blocks.erase(best);
+  } else {
+    block = Block{std::malloc(size), size};
+    if (!block.data) return nullptr;
+  }
+  arena->usedBlocks.push_back(block);
+  return block.data;
+}
+
+void LzmaArena::Free(ISzAllocPtr p, void* address) {
+  if (!address) return;
+  auto arena = reinterpret_cast<const Handle*>(p)->arena;
+  auto& used = arena->usedBlocks;
+  auto it = std::find_if(used.begin(), used.end(), [&](const Block& block) {
+    return block.data == address;
+  });
+  if (it != used.end()) {
+    arena->freeBlocks.push_back(*it);
+    used.erase(it);
+  }
+}
+
+LzmaDecoder::LzmaDecoder() { LzmaDec_Construct(&dec); }
+
+LzmaDecoder::~LzmaDecoder() { LzmaDec_Free(&dec, arena.Get()); }
+
+UInt32 CapDictionarySize(UInt32 dictSize, UInt64 size) {
+  if (size >= dictSize) return dictSize;
+  // Rounded in 64 bits: for streams over 2 GiB a UInt32 would wrap to 0.
+  UInt64 capped = MIN_DICTIONARY_SIZE;
+  while (capped < size) capped <<= 1;
+  return static_cast<UInt32>(std::min<UInt64>(dictSize, capped));
+}
+
+LzmaDecoder& LzmaDecoder::ForThread() {
+  thread_local LzmaDecoder decoder;
+  return decoder;
+}
+
+void LzmaDecoder::Decode(const uint8_t* src, size_t srcSize,
+                         const std::function<void(std::string_view)>& func) {
+  if (srcSize < LZMA_HEADER_SIZE)
+    throw std::runtime_error("invalid LZMA header");
+
+  UInt64 size = 0;
+  for (int i = 0; i < 8; i++) {
+    size |= static_cast<UInt64>(src[LZMA_PROPS_SIZE + i]) << (i * 8);
+  }
+  const bool sizeKnown = size != static_cast<UInt64>(-1);
+
+  std::array<Byte, LZMA_PROPS_SIZE> props;
+  std::copy(src, src + LZMA_PROPS_SIZE, props.begin());
+  UInt32 dictSize = props[1] | (props[2] << 8) | (props[3] << 16) |
+                    (static_cast<UInt32>(props[4]) << 24);
+  if (sizeKnown) {
+    dictSize = CapDictionarySize(dictSize, size);
+    for (int i = 0; i < 4; i++) props[1 + i] = (dictSize >> (i * 8)) & 0xff;
+  }
+
+  // Reallocates only when lc/lp or the dictionary size change.
+  if (LzmaDec_Allocate(&dec, props.data(), LZMA_PROPS_SIZE, arena.Get()) !=
+      SZ_OK)
+    throw std::runtime_error("unable to allocate LZMA decoder");
+  LzmaDec_Init(&dec);
+
+  const Byte* in = src + LZMA_HEADER_SIZE;
+  SizeT inLeft = srcSize - LZMA_HEADER_SIZE;
+  UInt64 outLeft = size;
+
+  while (!sizeKnown || outLeft > 0) {
+    SizeT outSize = window.size();
+    auto finishMode = LZMA_FINISH_ANY;
+    if (sizeKnown && outLeft <= outSize) {
+      outSize = static_cast<SizeT>(outLeft);
+      finishMode = LZMA_FINISH_END;
+    }
+    SizeT inSize = inLeft;
+    ELzmaStatus status;
+    auto res = LzmaDec_DecodeToBuf(&dec, window.data(), &outSize, in, &inSize,
+                                   finishMode, &status);
+    in += inSize;
+    inLeft -= inSize;
+    if (sizeKnown) outLeft -= outSize;
+
+    if (res != SZ_OK)
+      throw std::runtime_error(
+          "An error occurred while decompressing LZMA data");
+    if (outSize > 0) {
+      func(std::string_view(reinterpret_cast<const char*>(window.data()),
+                            outSize));
+    }
+    if (status == LZMA_STATUS_FINISHED_WITH_MARK) break;
+    if (outSize == 0 && inSize == 0) {
+      if (!sizeKnown && status == LZMA_STATUS_MAYBE_FINISHED_WITHOUT_MARK)
+        break;
+      throw std::runtime_error("truncated LZMA data");
+    }
+  }
+}
+
+}  // namespace osrp
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "../lzma/LzmaDec.h"
+
+namespace osrp {
+
+// ISzAlloc that keeps blocks released by the decoder and hands them out again
+// for later requests of the same or smaller size, so a long-lived decoder
+// stops calling malloc once it has seen its largest stream.
+class LzmaArena {
+ public:
+  LzmaArena();
+  ~LzmaArena();
+
+  LzmaArena(const LzmaArena&) = delete;
+  LzmaArena& operator=(const LzmaArena&) = delete;
+
+  ISzAllocPtr Get() const { return &handle.alloc; }
+
+ private:
+  struct Block {
+    void* data;
+    size_t capacity;
+  };
+
+  // The decoder only passes the ISzAlloc pointer back, so it is embedded in a
+  // standard-layout struct that also records the owning arena.
+  struct Handle {
+    ISzAlloc alloc;
+    LzmaArena* arena;
+  };
+
+  Handle handle;
+  std::vector<Block> freeBlocks, usedBlocks;
+
+  static void* Alloc(ISzAllocPtr p, size_t size);
+  static void Free(ISzAllocPtr p, void* address);
+};
+
+// Dictionary size to allocate for a stream of the given uncompressed size:
+// the size rounded up to a power of two (64 KiB at least), but never more
+// than the dictSize the stream asks for.
+UInt32 CapDictionarySize(UInt32 dictSize, UInt64 size);
+
+// Reusable decoder for LZMA-alone streams (.osr payloads). The CLzmaDec
+// probability tables and dictionary survive between streams; output is
+// produced through a fixed window and handed to the callback chunk by chunk.
+class LzmaDecoder {
+ public:
+  LzmaDecoder();
+  ~LzmaDecoder();
+
+  LzmaDecoder(const LzmaDecoder&) = delete;
+  LzmaDecoder& operator=(const LzmaDecoder&) = delete;
+
+  void Decode(const uint8_t* src, size_t srcSize,
+              const std::function<void(std::string_view)>& func);
+
+  // Decoder owned by the calling thread.
+  static LzmaDecoder& ForThread();
+
+ private:
+  static constexpr size_t WINDOW_SIZE = 16 * 1024;
+
+  LzmaArena arena;
+  CLzmaDec dec;
+  std::array<Byte, WINDOW_SIZE> window;
+};
+
+}  // namespace osrp
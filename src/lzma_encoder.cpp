@@ -0,0 +1,47 @@
+#include "lzma_encoder.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "../lzma/LzmaEnc.h"
+
+namespace osrp {
+
+namespace {
+constexpr size_t LZMA_HEADER_SIZE = LZMA_PROPS_SIZE + 8;
+
+void* Alloc(ISzAllocPtr, size_t size) { return std::malloc(size); }
+void Free(ISzAllocPtr, void* address) { std::free(address); }
+const ISzAlloc ALLOCATOR = {Alloc, Free};
+}  // namespace
+
+std::vector<uint8_t> CompressLZMA(std::string_view data, int level) {
+  CLzmaEncProps props;
+  LzmaEncProps_Init(&props);
+  props.level = std::clamp(level, 0, 9);
+  props.reduceSize = data.size();
+
+  // Incompressible input grows by at most a third, plus the coder flush.
+  std::vector<uint8_t> output(LZMA_HEADER_SIZE + data.size() +
+                              data.size() / 3 + 128);
+  SizeT propsSize = LZMA_PROPS_SIZE;
+  SizeT compressedSize = output.size() - LZMA_HEADER_SIZE;
+  auto res = LzmaEncode(
+      output.data() + LZMA_HEADER_SIZE, &compressedSize,
+      reinterpret_cast<const Byte*>(data.data()), data.size(), &props,
+      output.data(), &propsSize, 0, nullptr, &ALLOCATOR, &ALLOCATOR);
+  if (res != SZ_OK) {
+    throw std::runtime_error("An error occurred while compressing LZMA data");
+  }
+  output.resize(LZMA_HEADER_SIZE + compressedSize);
+
+  // The size is always known, so no end marker is written after the data.
+  uint64_t size = data.size();
+  for (int i = 0; i < 8; i++) {
+    output[LZMA_PROPS_SIZE + i] = static_cast<uint8_t>(size >> (i * 8));
+  }
+  return output;
+}
+
+}  // namespace osrp
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace osrp {
+
+// Compresses data into an LZMA-alone stream (5 property bytes, 64-bit
+// uncompressed size, payload) as stored in .osr files. level is the usual
+// 0-9 preset; the dictionary is never made larger than the input needs.
+std::vector<uint8_t> CompressLZMA(std::string_view data, int level = 6);
+
+}  // namespace osrp
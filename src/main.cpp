@@ -1,9 +1,12 @@
 #include <iostream>
+#include <map>
 #include <memory>
 
 #include "beatmap.hpp"
+#include "cli.hpp"
 #include "glctx.hpp"
 #include "replay.hpp"
+#include "replay_cursor.hpp"
 #include "timer.hpp"
 #include "ui_renderer.hpp"
 
@@ -12,8 +15,12 @@
 
 #include "stb_image.h"
 
-int main() {
-  osrp::Beatmap map("res/magma/magma_top_diff.osu");
+int main(int argc, char** argv) {
+  if (auto exitCode = osrp::RunCommand(argc, argv)) {
+    return *exitCode;
+  }
+
+  auto map = osrp::LoadBeatmapCached("res/magma/magma_top_diff.osu", "cache");
   std::cout << map.GetProperty(osrp::KeyValueSection::METADATA, "Title").Value()
             << std::endl;
 
@@ -99,15 +106,25 @@ int main() {
     cursorTrail.MakeResident();
   }
 
-  auto frameBefore = replay.replayData.begin();
+  osrp::ReplayCursor playback(replay.replayData);
   constexpr size_t TRAIL_FRAMES = 4;
+  constexpr double SEEK_SECONDS = 5.0;
+  constexpr double SPEED_STEP = 0.25;
 
   std::unique_ptr<osrp::UIRenderer> renderer = osrp::CreateUIRenderer(*ctx);
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-  timer->SetSpeed(1.5);
+  timer->SetSpeed(osrp::GetClockRate(replay.mods));
+
+  std::map<int, bool> keyWasDown;
+  auto keyPressed = [&](int key) {
+    bool down = ctx->IsKeyDown(key);
+    bool pressed = down && !keyWasDown[key];
+    keyWasDown[key] = down;
+    return pressed;
+  };
 
   while (!ctx->ShouldClose()) {
     auto [w, h] = ctx->GetFramebufferSize();
@@ -134,39 +151,33 @@ int main() {
 
     renderer->BeginFrame();
 
-    auto time = timer->GetTime();
-
-    while (frameBefore < replay.replayData.end() - 1) {
-      if (time * 1000.0 >= (frameBefore + 1)->time) {
-        ++frameBefore;
-      } else {
-        break;
-      }
+    if (keyPressed(GLFW_KEY_LEFT)) {
+      timer->SetTime(std::max(timer->GetTime() - SEEK_SECONDS, 0.0));
+    }
+    if (keyPressed(GLFW_KEY_RIGHT)) {
+      timer->SetTime(timer->GetTime() + SEEK_SECONDS);
     }
-    if (frameBefore != replay.replayData.end() &&
-        time * 1000.0 >= frameBefore->time) {
-      size_t itr = 0;
+    if (keyPressed(GLFW_KEY_R)) {
+      timer->SetTime(0.0);
+    }
+    if (keyPressed(GLFW_KEY_UP)) {
+      timer->SetSpeed(timer->GetSpeed() + SPEED_STEP);
+    }
+    if (keyPressed(GLFW_KEY_DOWN)) {
+      timer->SetSpeed(std::max(timer->GetSpeed() - SPEED_STEP, SPEED_STEP));
+    }
+
+    auto time = timer->GetTime() * 1000.0;
+    size_t frameBefore = playback.Seek(time);
+    if (playback.IsStarted()) {
       const glm::vec2 off{30.0f, 30.0f};
-      for (auto it = frameBefore; it-- > replay.replayData.begin();) {
-        auto pos = playfieldToUIVector(it->pos);
+      for (size_t itr = 1; itr <= TRAIL_FRAMES && itr <= frameBefore; itr++) {
+        auto framePos = replay.replayData.GetPosition(frameBefore - itr);
+        auto pos = playfieldToUIVector(framePos);
         renderer->Quad(pos - off, pos + off, cursorTrail);
-        if (++itr >= TRAIL_FRAMES) {
-          break;
-        }
-      }
-
-      auto pos = frameBefore->pos;
-      if (frameBefore < replay.replayData.end() - 1) {
-        auto frameAfter = frameBefore + 1;
-        assert(frameAfter->time >= time * 1000.0);
-        float lerpFactor = (float)(time * 1000.0f - frameBefore->time) /
-                           (frameAfter->time - frameBefore->time);
-        std::cout << lerpFactor << std::endl;
-        pos =
-            frameBefore->pos * (1 - lerpFactor) + frameAfter->pos * lerpFactor;
       }
-      pos = playfieldToUIVector(pos);
 
+      auto pos = playfieldToUIVector(playback.GetPosition(time));
       renderer->Quad(pos - off, pos + off, cursor);
     }
 
@@ -0,0 +1,123 @@
+#include "md5.hpp"
+
+#include <cstring>
+
+namespace osrp {
+
+namespace {
+constexpr uint32_t K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+    0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+    0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+    0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+    0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+    0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+constexpr int SHIFTS[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+
+inline uint32_t RotateLeft(uint32_t x, int c) {
+  return (x << c) | (x >> (32 - c));
+}
+
+void ProcessBlock(uint32_t state[4], const uint8_t* block) {
+  uint32_t m[16];
+  for (int i = 0; i < 16; i++) {
+    m[i] = uint32_t(block[i * 4]) | uint32_t(block[i * 4 + 1]) << 8 |
+           uint32_t(block[i * 4 + 2]) << 16 | uint32_t(block[i * 4 + 3]) << 24;
+  }
+
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  for (int i = 0; i < 64; i++) {
+    uint32_t f;
+    int g;
+    if (i < 16) {
+      f = (b & c) | (~b & d);
+      g = i;
+    } else if (i < 32) {
+      f = (d & b) | (~d & c);
+      g = (5 * i + 1) % 16;
+    } else if (i < 48) {
+      f = b ^ c ^ d;
+      g = (3 * i + 5) % 16;
+    } else {
+      f = c ^ (b | ~d);
+      g = (7 * i) % 16;
+    }
+    f += a + K[i] + m[g];
+    a = d;
+    d = c;
+    c = b;
+    b += RotateLeft(f, SHIFTS[i]);
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+}
+}  // namespace
+
+Md5Digest ComputeMD5(const uint8_t* data, size_t size) {
+  uint32_t state[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+  size_t fullBlocks = size / 64;
+  for (size_t i = 0; i < fullBlocks; i++) ProcessBlock(state, data + i * 64);
+
+  // Padding: 0x80, zeros, then the message length in bits, which may spill
+  // into a second block.
+  uint8_t tail[128] = {};
+  size_t remaining = size - fullBlocks * 64;
+  if (remaining > 0) std::memcpy(tail, data + fullBlocks * 64, remaining);
+  tail[remaining] = 0x80;
+  size_t tailSize = remaining < 56 ? 64 : 128;
+  uint64_t bits = uint64_t(size) * 8;
+  for (int i = 0; i < 8; i++) {
+    tail[tailSize - 8 + i] = static_cast<uint8_t>(bits >> (i * 8));
+  }
+  for (size_t offset = 0; offset < tailSize; offset += 64) {
+    ProcessBlock(state, tail + offset);
+  }
+
+  Md5Digest digest;
+  for (int i = 0; i < 16; i++) {
+    digest[i] = static_cast<uint8_t>(state[i / 4] >> ((i % 4) * 8));
+  }
+  return digest;
+}
+
+std::string ToHex(const Md5Digest& digest) {
+  constexpr char DIGITS[] = "0123456789abcdef";
+  std::string hex(digest.size() * 2, '0');
+  for (size_t i = 0; i < digest.size(); i++) {
+    hex[i * 2] = DIGITS[digest[i] >> 4];
+    hex[i * 2 + 1] = DIGITS[digest[i] & 0xf];
+  }
+  return hex;
+}
+
+std::optional<Md5Digest> ParseMD5(std::string_view hex) {
+  if (hex.size() != 32) return std::nullopt;
+  auto nibble = [](char c) -> int {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  };
+  Md5Digest digest;
+  for (size_t i = 0; i < digest.size(); i++) {
+    int high = nibble(hex[i * 2]), low = nibble(hex[i * 2 + 1]);
+    if (high < 0 || low < 0) return std::nullopt;
+    digest[i] = static_cast<uint8_t>(high << 4 | low);
+  }
+  return digest;
+}
+
+}  // namespace osrp
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace osrp {
+
+using Md5Digest = std::array<uint8_t, 16>;
+
+// RFC 1321 MD5, as used by osu! to identify beatmaps and replays.
+Md5Digest ComputeMD5(const uint8_t* data, size_t size);
+
+// Lowercase hex, the format of Replay::mapMd5.
+std::string ToHex(const Md5Digest& digest);
+std::optional<Md5Digest> ParseMD5(std::string_view hex);
+
+}  // namespace osrp
@@ -0,0 +1,60 @@
+#include "modded_beatmap.hpp"
+
+#include <algorithm>
+
+#include "beatmap.hpp"
+
+namespace osrp {
+
+namespace {
+double ApplyDifficultyMods(double value, int32_t mods, double hardRockScale) {
+  if (HasMod(mods, Mod::HARD_ROCK)) {
+    value = std::min(value * hardRockScale, 10.0);
+  }
+  if (HasMod(mods, Mod::EASY)) value *= 0.5;
+  return value;
+}
+}  // namespace
+
+double GetClockRate(int32_t mods) {
+  if (HasMod(mods, Mod::DOUBLE_TIME) || HasMod(mods, Mod::NIGHTCORE)) {
+    return 1.5;
+  }
+  if (HasMod(mods, Mod::HALF_TIME)) return 0.75;
+  return 1.0;
+}
+
+double DifficultyRange(double difficulty, double min, double mid,
+                       double max) {
+  if (difficulty > 5.0) return mid + (max - mid) * (difficulty - 5.0) / 5.0;
+  if (difficulty < 5.0) return mid - (mid - min) * (5.0 - difficulty) / 5.0;
+  return mid;
+}
+
+ModdedBeatmap::ModdedBeatmap(const Beatmap& map, int32_t mods)
+    : mods(mods & DIFFICULTY_MODS),
+      clockRate(GetClockRate(mods)),
+      flipped(HasMod(mods, Mod::HARD_ROCK)) {
+  auto difficulty = [&](std::string_view key, double fallback) {
+    auto value = map.GetProperty<double>(KeyValueSection::DIFFICULTY, key);
+    return value.HasValue() ? value.Value() : fallback;
+  };
+  double od = difficulty("OverallDifficulty", 5.0);
+  // Old beatmaps have no ApproachRate and use the OD.
+  double ar = difficulty("ApproachRate", od);
+  circleSize = ApplyDifficultyMods(difficulty("CircleSize", 5.0), mods, 1.3);
+  approachRate = ApplyDifficultyMods(ar, mods, 1.4);
+  overallDifficulty = ApplyDifficultyMods(od, mods, 1.4);
+  hpDrainRate = ApplyDifficultyMods(difficulty("HPDrainRate", 5.0), mods, 1.4);
+  circleRadius = static_cast<float>(54.4 - 4.48 * circleSize);
+  preempt = DifficultyRange(approachRate, 1800.0, 1200.0, 450.0);
+
+  const auto& objects = map.GetHitObjects().objects;
+  stackHeights = ComputeStackHeights(map, preempt);
+  positions.reserve(objects.size());
+  for (size_t i = 0; i < objects.size(); i++) {
+    positions.push_back(Transform(i, objects[i].pos));
+  }
+}
+
+}  // namespace osrp
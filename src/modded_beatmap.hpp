@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "gameplay.hpp"
+#include "stacking.hpp"
+
+namespace osrp {
+
+class Beatmap;
+
+// Mods that change the difficulty settings, the hit object positions or the
+// playback rate of a beatmap. Other mods share a ModdedBeatmap.
+constexpr int32_t DIFFICULTY_MODS =
+    static_cast<int32_t>(Mod::EASY) | static_cast<int32_t>(Mod::HARD_ROCK) |
+    static_cast<int32_t>(Mod::DOUBLE_TIME) |
+    static_cast<int32_t>(Mod::HALF_TIME) | static_cast<int32_t>(Mod::NIGHTCORE);
+
+// Playback rate of DT/NC (1.5) and HT (0.75).
+double GetClockRate(int32_t mods);
+
+// Maps difficulty 0, 5 and 10 to the given values, linear in between.
+double DifficultyRange(double difficulty, double min, double mid, double max);
+
+// A beatmap as played with mods, see Beatmap::GetModded. Times stay in
+// beatmap time, which replay frames use as well; divide by clockRate for
+// real time.
+struct ModdedBeatmap {
+  ModdedBeatmap(const Beatmap& map, int32_t mods);
+
+  // Playfield position of a point of hit object `object` in the unmodded
+  // beatmap, e.g. on its slider path: flipped for HR, then stacked, so
+  // stacks still lean up and left under HR.
+  glm::vec2 Transform(size_t object, glm::vec2 pos) const {
+    if (flipped) pos.y = 384.0f - pos.y;
+    return pos + GetStackOffset(stackHeights[object], circleRadius);
+  }
+
+  // Only the DIFFICULTY_MODS bits.
+  int32_t mods;
+  // After HR (x1.4, x1.3 for CS, at most 10) and EZ (x0.5).
+  double circleSize, approachRate, overallDifficulty, hpDrainRate;
+  double clockRate;
+  float circleRadius;
+  // How long before its time an object appears, in beatmap milliseconds.
+  double preempt;
+  // HR flips the playfield vertically.
+  bool flipped;
+  // Indexed like HitObjectList::objects. Stacking depends on the approach
+  // time, so HR and EZ can change it.
+  std::vector<int32_t> stackHeights;
+  std::vector<glm::vec2> positions;
+};
+
+}  // namespace osrp
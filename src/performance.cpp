@@ -0,0 +1,140 @@
+#include "performance.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace osrp {
+
+namespace {
+constexpr double STAR_SCALING = 0.0675;
+constexpr size_t CHUNK_SIZE = 4096;
+
+double SkillBase(double rating) {
+  return std::pow(5.0 * std::max(1.0, rating / STAR_SCALING) - 4.0, 3.0) /
+         100000.0;
+}
+}  // namespace
+
+ScoreStatistics::ScoreStatistics(const ReplayHeader& header)
+    : count300(static_cast<uint16_t>(header.no_300s)),
+      count100(static_cast<uint16_t>(header.no_100s)),
+      count50(static_cast<uint16_t>(header.no_50s)),
+      countMiss(static_cast<uint16_t>(header.no_misses)),
+      maxCombo(static_cast<uint16_t>(header.maxCombo)) {}
+
+ScoreStatistics::ScoreStatistics(const JudgementResult& judgement)
+    : count300(judgement.count300),
+      count100(judgement.count100),
+      count50(judgement.count50),
+      countMiss(judgement.countMiss),
+      maxCombo(judgement.maxCombo) {}
+
+double ScoreStatistics::GetAccuracy() const {
+  uint32_t totalHits = GetTotalHits();
+  if (totalHits == 0) return 0.0;
+  return (count50 * 50.0 + count100 * 100.0 + count300 * 300.0) /
+         (totalHits * 300.0);
+}
+
+PerformanceMap::PerformanceMap(const DifficultyAttributes& attributes,
+                               int32_t mods)
+    : maxCombo(attributes.maxCombo),
+      circleCount(attributes.circleCount),
+      flashlight(HasMod(mods, Mod::FLASHLIGHT)) {
+  multiplier = 1.12;
+  if (HasMod(mods, Mod::NO_FAIL)) multiplier *= 0.9;
+  if (HasMod(mods, Mod::SPUN_OUT)) multiplier *= 0.95;
+  if (HasMod(mods, Mod::RELAX) || HasMod(mods, Mod::AUTOPILOT) ||
+      HasMod(mods, Mod::AUTOPLAY)) {
+    multiplier = 0.0;
+  }
+
+  double aimRating = attributes.aimRating;
+  if (HasMod(mods, Mod::TOUCH_DEVICE)) aimRating = std::pow(aimRating, 0.8);
+  aimBase = SkillBase(aimRating);
+  speedBase = SkillBase(attributes.speedRating);
+
+  double ar = attributes.approachRate;
+  double od = attributes.overallDifficulty;
+  double arFactor = 1.0;
+  if (ar > 10.33) {
+    arFactor += 0.3 * (ar - 10.33);
+  } else if (ar < 8.0) {
+    arFactor += 0.01 * (8.0 - ar);
+  }
+  double hiddenFactor =
+      HasMod(mods, Mod::HIDDEN) ? 1.0 + 0.04 * (12.0 - ar) : 1.0;
+  aimScale = arFactor * hiddenFactor * (0.98 + od * od / 2500.0);
+  speedScale = (ar > 10.33 ? 1.0 + 0.3 * (ar - 10.33) : 1.0) * hiddenFactor *
+               (0.96 + od * od / 1600.0);
+
+  // Only circles are judged on timing in Score V1.
+  accuracyBase = std::pow(1.52163, od) * 2.83 *
+                 std::min(1.15, std::pow(circleCount / 1000.0, 0.3));
+  if (HasMod(mods, Mod::HIDDEN)) accuracyBase *= 1.08;
+  if (flashlight) accuracyBase *= 1.02;
+}
+
+PerformanceAttributes PerformanceMap::Evaluate(
+    const ScoreStatistics& score) const {
+  PerformanceAttributes result;
+  double totalHits = score.GetTotalHits();
+  if (totalHits == 0 || multiplier == 0.0) return result;
+  double accuracy = score.GetAccuracy();
+
+  double lengthBonus = 0.95 + 0.4 * std::min(1.0, totalHits / 2000.0) +
+                       (totalHits > 2000.0
+                            ? std::log10(totalHits / 2000.0) * 0.5
+                            : 0.0);
+  double missPenalty = std::pow(0.97, score.countMiss);
+  double comboScaling =
+      maxCombo > 0
+          ? std::min(std::pow(score.maxCombo / maxCombo, 0.8), 1.0)
+          : 1.0;
+  double common = lengthBonus * missPenalty * comboScaling;
+
+  double aimFactor = aimScale * (0.5 + accuracy / 2.0);
+  if (flashlight) {
+    double bonus = 1.0 + 0.35 * std::min(1.0, totalHits / 200.0);
+    if (totalHits > 200.0) {
+      bonus += 0.3 * std::min(1.0, (totalHits - 200.0) / 300.0);
+      if (totalHits > 500.0) bonus += (totalHits - 500.0) / 1200.0;
+    }
+    aimFactor *= bonus;
+  }
+  result.aim = aimBase * common * aimFactor;
+  result.speed = speedBase * common * speedScale * (0.02 + accuracy);
+
+  if (circleCount > 0.0) {
+    // Accuracy on circles, assuming slider and spinner judgements are 300s.
+    double better = ((score.count300 - (totalHits - circleCount)) * 6.0 +
+                     score.count100 * 2.0 + score.count50) /
+                    (circleCount * 6.0);
+    better = std::clamp(better, 0.0, 1.0);
+    result.accuracy = accuracyBase * std::pow(better, 24.0);
+  }
+
+  result.total = std::pow(std::pow(result.aim, 1.1) +
+                              std::pow(result.speed, 1.1) +
+                              std::pow(result.accuracy, 1.1),
+                          1.0 / 1.1) *
+                 multiplier;
+  return result;
+}
+
+std::vector<double> CalculatePerformance(
+    const std::vector<PerformanceMap>& maps,
+    const std::vector<ScoreEntry>& scores, ThreadPool& pool) {
+  std::vector<double> results(scores.size());
+  size_t chunks = (scores.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  ParallelFor(pool, chunks, [&](size_t chunk) {
+    size_t end = std::min(scores.size(), (chunk + 1) * CHUNK_SIZE);
+    for (size_t i = chunk * CHUNK_SIZE; i < end; i++) {
+      const auto& score = scores[i];
+      results[i] = maps[score.map].Evaluate(score.statistics).total;
+    }
+  });
+  return results;
+}
+
+}  // namespace osrp
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "difficulty.hpp"
+#include "judgement.hpp"
+#include "replay.hpp"
+#include "thread_pool.hpp"
+
+namespace osrp {
+
+// Hit counts and combo of one play.
+struct ScoreStatistics {
+  uint32_t count300 = 0, count100 = 0, count50 = 0, countMiss = 0;
+  uint32_t maxCombo = 0;
+
+  ScoreStatistics() = default;
+  explicit ScoreStatistics(const ReplayHeader& header);
+  explicit ScoreStatistics(const JudgementResult& judgement);
+
+  uint32_t GetTotalHits() const {
+    return count300 + count100 + count50 + countMiss;
+  }
+  // Score V1 accuracy in [0, 1].
+  double GetAccuracy() const;
+};
+
+struct PerformanceAttributes {
+  double total = 0.0;
+  double aim = 0.0, speed = 0.0, accuracy = 0.0;
+};
+
+// The parts of the osu!standard pp formula that only depend on the beatmap
+// and the mods, computed once so that evaluating a score is a handful of
+// arithmetic operations.
+class PerformanceMap {
+ public:
+  // attributes must have been calculated with the same mods.
+  PerformanceMap(const DifficultyAttributes& attributes, int32_t mods);
+
+  PerformanceAttributes Evaluate(const ScoreStatistics& score) const;
+
+ private:
+  // Zero for mods that do not give pp, e.g. relax.
+  double multiplier;
+  double aimBase, speedBase;
+  // Approach rate, Hidden and OD scaling of aim and speed.
+  double aimScale, speedScale;
+  double accuracyBase;
+  double maxCombo;
+  double circleCount;
+  bool flashlight;
+};
+
+// A score of maps[map] in a CalculatePerformance batch.
+struct ScoreEntry {
+  uint32_t map;
+  ScoreStatistics statistics;
+};
+
+// Total pp of every score, split into chunks across the pool.
+std::vector<double> CalculatePerformance(
+    const std::vector<PerformanceMap>& maps,
+    const std::vector<ScoreEntry>& scores, ThreadPool& pool);
+
+}  // namespace osrp
@@ -0,0 +1,98 @@
+#include "proximity.hpp"
+
+#include "simd.hpp"
+
+namespace osrp {
+
+namespace {
+
+size_t ScanPointsScalar(const float* xs, const float* ys, size_t begin,
+                        size_t end, glm::vec2 pos, float radiusSquared,
+                        uint32_t* indices) {
+  size_t found = 0;
+  for (size_t i = begin; i < end; i++) {
+    float dx = xs[i] - pos.x, dy = ys[i] - pos.y;
+    if (dx * dx + dy * dy <= radiusSquared) indices[found++] = i;
+  }
+  return found;
+}
+
+#ifdef OSRP_X86
+size_t FindPointsInRadiusSSE2(const float* xs, const float* ys, size_t count,
+                              glm::vec2 pos, float radius, uint32_t* indices) {
+  const __m128 px = _mm_set1_ps(pos.x), py = _mm_set1_ps(pos.y);
+  const __m128 limit = _mm_set1_ps(radius * radius);
+  size_t found = 0, i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), px);
+    __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), py);
+    // Separate multiplies and add, no FMA, to round like the scalar loop.
+    __m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+    uint32_t mask = _mm_movemask_ps(_mm_cmple_ps(distance, limit));
+    while (mask) {
+      indices[found++] = i + CountTrailingZeros(mask);
+      mask &= mask - 1;
+    }
+  }
+  return found + ScanPointsScalar(xs, ys, i, count, pos, radius * radius,
+                                  indices + found);
+}
+
+OSRP_TARGET_AVX2 size_t FindPointsInRadiusAVX2(const float* xs,
+                                               const float* ys, size_t count,
+                                               glm::vec2 pos, float radius,
+                                               uint32_t* indices) {
+  const __m256 px = _mm256_set1_ps(pos.x), py = _mm256_set1_ps(pos.y);
+  const __m256 limit = _mm256_set1_ps(radius * radius);
+  size_t found = 0, i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(xs + i), px);
+    __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(ys + i), py);
+    __m256 distance =
+        _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    uint32_t mask = _mm256_movemask_ps(
+        _mm256_cmp_ps(distance, limit, _CMP_LE_OQ));
+    while (mask) {
+      indices[found++] = i + CountTrailingZeros(mask);
+      mask &= mask - 1;
+    }
+  }
+  return found + ScanPointsScalar(xs, ys, i, count, pos, radius * radius,
+                                  indices + found);
+}
+#else
+size_t FindPointsInRadiusScalar(const float* xs, const float* ys,
+                                size_t count, glm::vec2 pos, float radius,
+                                uint32_t* indices) {
+  return ScanPointsScalar(xs, ys, 0, count, pos, radius * radius, indices);
+}
+#endif
+
+struct ProximityKernel {
+  size_t (*find)(const float*, const float*, size_t, glm::vec2, float,
+                 uint32_t*);
+  const char* name;
+};
+
+const ProximityKernel& GetKernel() {
+  static const ProximityKernel kernel = []() -> ProximityKernel {
+#ifdef OSRP_X86
+    if (CpuSupportsAVX2()) return {FindPointsInRadiusAVX2, "avx2"};
+    return {FindPointsInRadiusSSE2, "sse2"};
+#else
+    return {FindPointsInRadiusScalar, "scalar"};
+#endif
+  }();
+  return kernel;
+}
+
+}  // namespace
+
+size_t FindPointsInRadius(const float* xs, const float* ys, size_t count,
+                          glm::vec2 pos, float radius, uint32_t* indices) {
+  return GetKernel().find(xs, ys, count, pos, radius, indices);
+}
+
+const char* GetProximityKernel() { return GetKernel().name; }
+
+}  // namespace osrp
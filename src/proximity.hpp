@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace osrp {
+
+// Writes the index of every point (xs[i], ys[i]), i < count, at most radius
+// away from pos to indices in ascending order and returns how many there
+// were. indices must have room for count entries. Uses AVX2 or SSE2 when
+// the CPU supports them; all variants compare squared distances and agree
+// exactly.
+size_t FindPointsInRadius(const float* xs, const float* ys, size_t count,
+                          glm::vec2 pos, float radius, uint32_t* indices);
+
+// Name of the kernel selected for this CPU.
+const char* GetProximityKernel();
+
+}  // namespace osrp
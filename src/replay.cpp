@@ -1,85 +1,15 @@
 #include "replay.hpp"
 
-#include <iostream>
-#include <memory>
+#include "frame_parser.hpp"
+#include "lzma_decoder.hpp"
+#include "lzma_encoder.hpp"
 
-#include "../lzma/LzmaDec.h"
-#include "strings.hpp"
-
-void* SzAlloc(ISzAllocPtr p, size_t size) {
-  p = p;
-  return malloc(size);
-}
-void SzFree(ISzAllocPtr p, void* address) {
-  p = p;
-  free(address);
-}
-ISzAlloc alloc = {SzAlloc, SzFree};
-
-std::unique_ptr<uint8_t[]> decompressLZMA(uint8_t* src, size_t src_size,
-                                          size_t& dst_size) {
-  if (src_size < 13) throw std::runtime_error("invalid LZMA header");
-
-  UInt64 size = 0;
-  for (int i = 0; i < 8; i++) {
-    size |= (src[5 + i] << (i * 8));
-  }
-
-  auto dst = std::make_unique<uint8_t[]>(size);
-
-  ELzmaStatus lzmaStatus;
-  SizeT procOutSize = size, procInSize = src_size - 13;
-  auto status = LzmaDecode(dst.get(), &procOutSize, &src[13], &procInSize, src,
-                           5, LZMA_FINISH_END, &lzmaStatus, &alloc);
-
-  if (status == SZ_OK && procOutSize == size) {
-    dst_size = size;
-    return dst;
-  }
-
-  throw std::runtime_error("An error occurred while decompressing LZMA data");
-}
 namespace osrp {
-Result<Replay::Frame> ParseFrame(const std::string_view& str,
-                                 int64_t& timeOffset) {
-  Replay::Frame frame;
-  int tokenIndex = 0;
-  std::error_code err{};
-  Split(str, '|', [&](const auto& token) {
-#define PARSE(x)                                           \
-  if (auto result = ParseString<decltype(frame.x)>(token); \
-      result.HasValue()) {                                 \
-    frame.x = result.Value();                              \
-  } else {                                                 \
-    err = result.Error();                                  \
-  }
-    switch (tokenIndex++) {
-      case 0:
-        PARSE(time);
-      case 1:
-        PARSE(pos.x);
-      case 2:
-        PARSE(pos.y);
-      case 3:
-        PARSE(keys);
-    }
-  });
-  if (err == std::error_code()) {
-    frame.time += timeOffset;
-    timeOffset = frame.time;
-    return Result<Replay::Frame>(frame);
-  } else {
-    return Result<Replay::Frame>(err);
-  }
-}
-
-Replay::Replay(const fs::path& path) {
-  std::ifstream input;
-  Open(input, path, std::ios::in | std::ios::binary);
+#define READ(x) x = input.template Read<decltype(x)>()
 
-#define READ(x) x = ReadBinary<decltype(x)>(input)
-
-  mode = static_cast<GameMode>(ReadBinary<uint8_t>(input));
+template <typename Reader>
+void ReplayHeader::ReadHeader(Reader& input, bool readLifeBar) {
+  mode = static_cast<GameMode>(input.template Read<uint8_t>());
   READ(version);
   READ(mapMd5);
   READ(playerName);
@@ -94,39 +24,99 @@ Replay::Replay(const fs::path& path) {
   READ(maxCombo);
   READ(fullCombo);
   READ(mods);
-  READ(lifeBar);
+  if (readLifeBar) {
+    READ(lifeBar);
+  } else {
+    SkipString(input);
+  }
   READ(timestamp);
+}
 
-  size_t compressedSize = ReadBinary<int32_t>(input);
-  auto compressedData = ReadBytes<uint8_t>(input, compressedSize);
+void ReplayHeader::WriteHeader(BinaryWriter& output) const {
+  output.Write(static_cast<uint8_t>(mode));
+  output.Write(version);
+  output.Write(mapMd5);
+  output.Write(playerName);
+  output.Write(replayMd5);
+  output.Write(no_300s);
+  output.Write(no_100s);
+  output.Write(no_50s);
+  output.Write(no_gekis);
+  output.Write(no_katus);
+  output.Write(no_misses);
+  output.Write(score);
+  output.Write(maxCombo);
+  output.Write(fullCombo);
+  output.Write(mods);
+  output.Write(lifeBar);
+  output.Write(timestamp);
+}
 
-  size_t decompressedSize;
-  auto decompressedData =
-      decompressLZMA(compressedData.data(), compressedSize, decompressedSize);
+ReplayHeader::ReplayHeader(const fs::path& path, bool readLifeBar) {
+  std::ifstream stream;
+  Open(stream, path, std::ios::in | std::ios::binary);
+  if (!stream) throw std::runtime_error("unable to open " + path.string());
+  StreamReader input(stream);
+  ReadHeader(input, readLifeBar);
+}
 
-  std::string_view replayDataString(
-      reinterpret_cast<char*>(decompressedData.get()), decompressedSize);
+ReplayHeader::ReplayHeader(BinaryReader& input, bool readLifeBar) {
+  ReadHeader(input, readLifeBar);
+}
 
-  int64_t timeOffset = 0;
-  Split(replayDataString, ',', [&](const std::string_view& str) {
-    if (TrimWhitespace(str).size() <= 0) return;
-    if (auto seedString = RemovePrefix(str, "-12345|0|0|");
-        seedString.has_value()) {
-      auto seedStringValue = seedString.value();
-      seedStringValue.remove_suffix(1);
-      auto seedResult = ParseString<decltype(replaySeed)>(seedStringValue);
-      if (seedResult) {
-        replaySeed = seedResult.Value();
-      } else {
-        std::cerr << "Replay seed parsing unsuccessfully. Error: "
-                  << seedResult.Error().message() << std::endl;
-      }
-    } else {
-      if (auto frame = ParseFrame(str, timeOffset); frame.HasValue()) {
-        replayData.push_back(frame.Value());
-      }
-    }
-  });
+std::string ReadReplayFrameText(const fs::path& path) {
+  MappedFile file(path);
+  BinaryReader input(file);
+  ReplayHeader header(input, false);
+
+  size_t compressedSize = input.Read<int32_t>();
+  auto compressedData = input.ReadBytes(compressedSize);
+  std::string text;
+  LzmaDecoder::ForThread().Decode(
+      compressedData, compressedSize,
+      [&](std::string_view chunk) { text.append(chunk); });
+  return text;
 }
-}  // namespace osrp
 
+Replay::Replay(const fs::path& path) : Replay(BinaryReader(MappedFile(path))) {}
+
+Replay::Replay(BinaryReader input) : ReplayHeader(input) {
+  size_t compressedSize = input.Read<int32_t>();
+  auto compressedData = input.ReadBytes(compressedSize);
+
+  FrameParser parser(replayData, replaySeed);
+  LzmaDecoder::ForThread().Decode(
+      compressedData, compressedSize,
+      [&](std::string_view chunk) { parser.Feed(chunk); });
+  parser.Finish();
+  replayData.shrink_to_fit();
+
+  if (input.Remaining() >= sizeof(scoreID)) {
+    READ(scoreID);
+  }
+  if (HasMod(mods, Mod::TARGET_PRACTICE) &&
+      input.Remaining() >= sizeof(additionalModInfo)) {
+    READ(additionalModInfo);
+  }
+}
+
+std::vector<uint8_t> Replay::Encode(int compressionLevel) const {
+  auto text = FormatFrames(replayData, replaySeed);
+  auto compressedData = CompressLZMA(text, compressionLevel);
+
+  BinaryWriter output;
+  WriteHeader(output);
+  output.Write(static_cast<int32_t>(compressedData.size()));
+  output.WriteBytes(compressedData.data(), compressedData.size());
+  output.Write(scoreID);
+  if (HasMod(mods, Mod::TARGET_PRACTICE)) {
+    output.Write(additionalModInfo);
+  }
+  return output.GetBuffer();
+}
+
+void Replay::Write(const fs::path& path, int compressionLevel) const {
+  auto data = Encode(compressionLevel);
+  WriteFileAtomic(path, data.data(), data.size());
+}
+}  // namespace osrp
@@ -1,24 +1,29 @@
 #pragma once
 
 #include <cstdint>
-#include <glm/glm.hpp>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "frames.hpp"
 #include "gameplay.hpp"
 #include "io.hpp"
 #include "stdfloat.hpp"
 
 namespace osrp {
-struct Replay {
+// The fixed-layout part of an .osr file preceding the compressed frames.
+struct ReplayHeader {
  public:
-  struct Frame {
-    glm::vec2 pos;
-    int64_t time;
-    uint32_t keys;
-  };
+  // Reads only the header, leaving the LZMA payload untouched. With
+  // readLifeBar set to false the life bar graph is skipped as well.
+  explicit ReplayHeader(const fs::path& path, bool readLifeBar = true);
+  // Reads the header from the start of input and leaves input positioned at
+  // the compressed frame data.
+  explicit ReplayHeader(BinaryReader& input, bool readLifeBar = true);
 
-  explicit Replay(const fs::path& path);
+  // Serializes the header in .osr layout.
+  void WriteHeader(BinaryWriter& output) const;
 
   GameMode mode;
   int32_t version;
@@ -30,11 +35,52 @@ struct Replay {
   int32_t mods;
   std::string lifeBar;
   int64_t timestamp;
-  std::vector<Frame> replayData;
-  int64_t scoreID;
-  float64_t additionalModInfo;
-  int32_t replaySeed;
+
+ protected:
+  ReplayHeader() = default;
+
+  template <typename Reader>
+  void ReadHeader(Reader& input, bool readLifeBar);
 };
 
-}  // namespace osrp
+struct Replay : public ReplayHeader {
+ public:
+  using Frame = osrp::Frame;
+
+  explicit Replay(const fs::path& path);
+
+  // Reads a cache file written by WriteCache. Returns std::nullopt if it is
+  // missing, from another format version, corrupted, or (when replayMd5 is
+  // given) belongs to a different replay.
+  static std::optional<Replay> ReadCache(const fs::path& path,
+                                         std::string_view replayMd5 = {});
+  void WriteCache(const fs::path& path) const;
 
+  // Serializes the replay as an .osr file, compressing the frames with the
+  // given LZMA preset (0-9).
+  std::vector<uint8_t> Encode(int compressionLevel = 6) const;
+  void Write(const fs::path& path, int compressionLevel = 6) const;
+
+  FrameArray replayData;
+  int64_t scoreID = 0;
+  float64_t additionalModInfo = 0.0;
+  // RNG seed from the final frame, which replays before 2013-03-19 lack.
+  std::optional<int32_t> replaySeed;
+
+ private:
+  Replay() = default;
+  explicit Replay(BinaryReader input);
+};
+
+// Returns the decompressed "w|x|y|z," frame text of an .osr file as stored,
+// without parsing it.
+std::string ReadReplayFrameText(const fs::path& path);
+
+// Loads replayPath through a cache file in cacheDir named after the replay
+// MD5, parsing the .osr and writing the cache on a miss. Replays whose
+// header has no well-formed MD5 bypass the cache. If hit is non-null it
+// receives whether the cache was used.
+Replay LoadReplayCached(const fs::path& replayPath, const fs::path& cacheDir,
+                        bool* hit = nullptr);
+
+}  // namespace osrp
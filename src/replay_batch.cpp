@@ -0,0 +1,167 @@
+#include "replay_batch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+
+#include "strings.hpp"
+
+namespace osrp {
+
+namespace {
+bool IsReplayFile(const fs::path& path) {
+  return path.extension() == ".osr";
+}
+}  // namespace
+
+std::vector<fs::path> CollectReplayPaths(const std::vector<fs::path>& inputs) {
+  std::vector<fs::path> paths;
+  for (const auto& input : inputs) {
+    if (fs::is_directory(input)) {
+      std::vector<fs::path> found;
+      for (const auto& entry : fs::recursive_directory_iterator(input)) {
+        if (entry.is_regular_file() && IsReplayFile(entry.path())) {
+          found.push_back(entry.path());
+        }
+      }
+      // Directory iteration order is unspecified, keep batches reproducible.
+      std::sort(found.begin(), found.end());
+      paths.insert(paths.end(), found.begin(), found.end());
+    } else if (IsReplayFile(input)) {
+      paths.push_back(input);
+    } else {
+      ReadLines(input, [&](const std::string_view& line) {
+        auto trimmed = TrimWhitespace(line);
+        if (!trimmed.empty()) paths.emplace_back(trimmed);
+      });
+    }
+  }
+  return paths;
+}
+
+std::vector<ReplayBatchResult> DecodeReplays(const std::vector<fs::path>& paths,
+                                             ThreadPool& pool,
+                                             ReplayBatchStats* stats) {
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<ReplayBatchResult> results(paths.size());
+  std::vector<uintmax_t> sizes(paths.size(), 0);
+  for (size_t i = 0; i < paths.size(); i++) {
+    results[i].path = paths[i];
+    std::error_code err;
+    auto size = fs::file_size(paths[i], err);
+    if (!err) sizes[i] = size;
+  }
+
+  // Hand out the largest replays first so a long one is not picked up last.
+  std::vector<size_t> order(paths.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+  ParallelFor(pool, order.size(), [&](size_t i) {
+    auto& result = results[order[i]];
+    try {
+      result.replay.emplace(result.path);
+    } catch (const std::exception& e) {
+      result.error = e.what();
+    }
+  });
+
+  if (stats) {
+    stats->replays = results.size();
+    stats->failures = std::count_if(
+        results.begin(), results.end(),
+        [](const ReplayBatchResult& r) { return !r.replay.has_value(); });
+    stats->bytes = std::accumulate(sizes.begin(), sizes.end(), uintmax_t{0});
+    stats->seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  }
+  return results;
+}
+
+std::vector<JudgementBatchResult> JudgeReplays(
+    const Beatmap& map, const std::vector<fs::path>& paths, ThreadPool& pool,
+    JudgementBatchStats* stats) {
+  auto start = std::chrono::steady_clock::now();
+
+  // Parse everything the JudgementMaps need up front instead of having the
+  // first workers wait on each other.
+  map.GetSliderPaths();
+  map.GetTimingTimeline();
+  auto mapMd5 = ToHex(map.GetMD5());
+
+  // One JudgementMap per mod combination. The mutex only guards inserting
+  // the entry; building happens under its once_flag, so workers with other
+  // mods are not held up. std::map never moves its nodes.
+  struct LazyJudgementMap {
+    std::once_flag built;
+    std::unique_ptr<JudgementMap> judgementMap;
+  };
+  std::mutex judgementMapsMutex;
+  std::map<int32_t, LazyJudgementMap> judgementMaps;
+  auto getJudgementMap = [&](int32_t mods) -> const JudgementMap& {
+    LazyJudgementMap* entry;
+    {
+      std::lock_guard<std::mutex> lock(judgementMapsMutex);
+      entry = &judgementMaps[mods];
+    }
+    std::call_once(entry->built, [&]() {
+      entry->judgementMap = std::make_unique<JudgementMap>(map, mods);
+    });
+    return *entry->judgementMap;
+  };
+
+  std::vector<JudgementBatchResult> results(paths.size());
+  std::atomic<int64_t> judgeNanoseconds{0};
+  ParallelFor(pool, paths.size(), [&](size_t i) {
+    auto& result = results[i];
+    result.path = paths[i];
+    try {
+      Replay replay(paths[i]);
+      const auto& judgementMap = getJudgementMap(replay.mods);
+      auto judgeStart = std::chrono::steady_clock::now();
+      result.judgement = Judge(judgementMap, replay.replayData);
+      judgeNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - judgeStart)
+                              .count();
+      result.header = std::move(static_cast<ReplayHeader&>(replay));
+    } catch (const std::exception& e) {
+      result.error = e.what();
+    }
+  });
+
+  if (stats) {
+    *stats = JudgementBatchStats();
+    stats->replays = results.size();
+    for (const auto& result : results) {
+      if (!result.judgement) {
+        stats->failures++;
+        continue;
+      }
+      const auto& judgement = *result.judgement;
+      const auto& header = *result.header;
+      stats->scoreMismatches += judgement.score != header.score;
+      stats->comboMismatches +=
+          judgement.maxCombo != static_cast<uint32_t>(header.maxCombo);
+      stats->countMismatches +=
+          judgement.count300 != static_cast<uint32_t>(header.no_300s) ||
+          judgement.count100 != static_cast<uint32_t>(header.no_100s) ||
+          judgement.count50 != static_cast<uint32_t>(header.no_50s) ||
+          judgement.countMiss != static_cast<uint32_t>(header.no_misses);
+      stats->mapMismatches += header.mapMd5 != mapMd5;
+    }
+    stats->judgeSeconds = judgeNanoseconds * 1e-9;
+    stats->seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  }
+  return results;
+}
+
+}  // namespace osrp
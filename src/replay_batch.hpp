@@ -0,0 +1,63 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "beatmap.hpp"
+#include "io.hpp"
+#include "judgement.hpp"
+#include "replay.hpp"
+#include "thread_pool.hpp"
+
+namespace osrp {
+
+struct ReplayBatchResult {
+  fs::path path;
+  std::optional<Replay> replay;
+  std::string error;
+};
+
+struct ReplayBatchStats {
+  size_t replays = 0, failures = 0;
+  uintmax_t bytes = 0;
+  double seconds = 0.0;
+};
+
+// Expands inputs into a list of .osr files. Directories are searched
+// recursively, .osr files are taken as-is and any other file is read as a
+// newline separated list of paths.
+std::vector<fs::path> CollectReplayPaths(const std::vector<fs::path>& inputs);
+
+// Decodes every replay on the pool. Results are returned in the order of
+// paths regardless of which worker finished first; failures are reported
+// through ReplayBatchResult::error instead of aborting the batch.
+std::vector<ReplayBatchResult> DecodeReplays(
+    const std::vector<fs::path>& paths, ThreadPool& pool,
+    ReplayBatchStats* stats = nullptr);
+
+struct JudgementBatchResult {
+  fs::path path;
+  std::optional<ReplayHeader> header;
+  std::optional<JudgementResult> judgement;
+  std::string error;
+};
+
+struct JudgementBatchStats {
+  size_t replays = 0, failures = 0;
+  // Replays whose stored values differ from the re-judged ones, and those
+  // recorded on another version of the beatmap.
+  size_t scoreMismatches = 0, comboMismatches = 0, countMismatches = 0;
+  size_t mapMismatches = 0;
+  // Wall time, and the time spent in Judge summed over all workers.
+  double seconds = 0.0, judgeSeconds = 0.0;
+};
+
+// Decodes every replay on the pool and judges it against map. A
+// JudgementMap is built once per mod combination and shared by all workers.
+// Results are returned in the order of paths.
+std::vector<JudgementBatchResult> JudgeReplays(
+    const Beatmap& map, const std::vector<fs::path>& paths, ThreadPool& pool,
+    JudgementBatchStats* stats = nullptr);
+
+}  // namespace osrp
@@ -0,0 +1,142 @@
+#include <cstring>
+
+#include "md5.hpp"
+#include "replay.hpp"
+
+// Cache layout, little-endian:
+//   "OSRC", u32 version
+//   .osr header (ReplayHeader::WriteHeader), i64 scoreID, f64
+//   additionalModInfo, u8 has seed, i32 replaySeed (0 if none), ULEB128
+//   frame count
+//   time column: ZigZag ULEB128 deltas
+//   x and y columns: raw float32
+//   keys column: ULEB128
+//   u64 FNV-1a of everything after the version, seeded with replayMd5
+
+namespace osrp {
+
+namespace {
+constexpr char CACHE_MAGIC[4] = {'O', 'S', 'R', 'C'};
+constexpr uint32_t CACHE_VERSION = 2;
+
+uint64_t CacheChecksum(const uint8_t* data, size_t size,
+                       std::string_view replayMd5) {
+  auto seed = HashFNV1a(reinterpret_cast<const uint8_t*>(replayMd5.data()),
+                        replayMd5.size());
+  return HashFNV1a(data, size, seed);
+}
+}  // namespace
+
+void Replay::WriteCache(const fs::path& path) const {
+  BinaryWriter output;
+  output.WriteBytes(reinterpret_cast<const uint8_t*>(CACHE_MAGIC),
+                    sizeof(CACHE_MAGIC));
+  output.Write(CACHE_VERSION);
+  size_t bodyOffset = output.Size();
+
+  WriteHeader(output);
+  output.Write(scoreID);
+  output.Write(additionalModInfo);
+  output.Write(static_cast<uint8_t>(replaySeed.has_value()));
+  output.Write(replaySeed.value_or(0));
+
+  output.WriteULEB128(replayData.size());
+  int64_t lastTime = 0;
+  for (auto time : replayData.GetTimes()) {
+    output.WriteULEB128(ZigZagEncode(time - lastTime));
+    lastTime = time;
+  }
+  for (auto x : replayData.GetXs()) output.Write(x);
+  for (auto y : replayData.GetYs()) output.Write(y);
+  for (auto keys : replayData.GetKeys()) output.WriteULEB128(keys);
+
+  const auto& buffer = output.GetBuffer();
+  output.Write(CacheChecksum(buffer.data() + bodyOffset,
+                             buffer.size() - bodyOffset, replayMd5));
+  WriteFileAtomic(path, buffer.data(), buffer.size());
+}
+
+std::optional<Replay> Replay::ReadCache(const fs::path& path,
+                                        std::string_view replayMd5) {
+  std::error_code err;
+  if (!fs::is_regular_file(path, err)) return std::nullopt;
+
+  try {
+    MappedFile file(path);
+    constexpr size_t prefixSize = sizeof(CACHE_MAGIC) + sizeof(CACHE_VERSION);
+    if (file.Size() < prefixSize + sizeof(uint64_t)) return std::nullopt;
+
+    BinaryReader input(file);
+    if (std::memcmp(input.ReadBytes(sizeof(CACHE_MAGIC)), CACHE_MAGIC,
+                    sizeof(CACHE_MAGIC)) != 0 ||
+        input.Read<uint32_t>() != CACHE_VERSION) {
+      return std::nullopt;
+    }
+
+    Replay replay;
+    replay.ReadHeader(input, true);
+    if (!replayMd5.empty() && replay.replayMd5 != replayMd5) {
+      return std::nullopt;
+    }
+
+    size_t checksumOffset = file.Size() - sizeof(uint64_t);
+    BinaryReader checksumInput(file.Data() + checksumOffset, sizeof(uint64_t));
+    if (checksumInput.Read<uint64_t>() !=
+        CacheChecksum(file.Data() + prefixSize, checksumOffset - prefixSize,
+                      replay.replayMd5)) {
+      return std::nullopt;
+    }
+
+    replay.scoreID = input.Read<int64_t>();
+    replay.additionalModInfo = input.Read<float64_t>();
+    bool hasSeed = input.Read<uint8_t>() != 0;
+    auto replaySeed = input.Read<int32_t>();
+    if (hasSeed) replay.replaySeed = replaySeed;
+
+    size_t frameCount = input.ReadULEB128();
+    if (frameCount > input.Remaining()) return std::nullopt;
+    std::vector<int32_t> times(frameCount);
+    std::vector<float> xs(frameCount), ys(frameCount);
+    std::vector<uint16_t> keys(frameCount);
+    int64_t time = 0;
+    for (auto& t : times) {
+      time += ZigZagDecode(input.ReadULEB128());
+      t = static_cast<int32_t>(time);
+    }
+    for (auto& x : xs) x = input.Read<float>();
+    for (auto& y : ys) y = input.Read<float>();
+    for (auto& k : keys) k = static_cast<uint16_t>(input.ReadULEB128());
+
+    replay.replayData = FrameArray(std::move(times), std::move(xs),
+                                   std::move(ys), std::move(keys));
+    return replay;
+  } catch (const std::exception&) {
+    return std::nullopt;
+  }
+}
+
+Replay LoadReplayCached(const fs::path& replayPath, const fs::path& cacheDir,
+                        bool* hit) {
+  ReplayHeader header(replayPath, false);
+  // The header is untrusted input; only a well-formed digest may name a
+  // file, so "../x" or an absolute path cannot escape cacheDir.
+  auto digest = ParseMD5(header.replayMd5);
+  if (!digest) {
+    if (hit) *hit = false;
+    return Replay(replayPath);
+  }
+
+  auto cachePath = cacheDir / (ToHex(*digest) + ".osrc");
+  if (auto cached = Replay::ReadCache(cachePath, header.replayMd5)) {
+    if (hit) *hit = true;
+    return std::move(*cached);
+  }
+
+  if (hit) *hit = false;
+  Replay replay(replayPath);
+  fs::create_directories(cacheDir);
+  replay.WriteCache(cachePath);
+  return replay;
+}
+
+}  // namespace osrp
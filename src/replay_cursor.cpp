@@ -0,0 +1,66 @@
+#include "replay_cursor.hpp"
+
+#include <algorithm>
+
+namespace osrp {
+
+ReplayCursor::ReplayCursor(const FrameArray& frames) : frames(frames) {
+  const auto& times = frames.GetTimes();
+  // Usually frames at 0 and -1 ms, followed by the lead-in from about -1s.
+  while (first + 1 < times.size() && times[first + 1] < times[first]) first++;
+  int32_t maxTime = times.empty() ? 0 : times[first];
+  for (size_t i = first; i < times.size(); i++) {
+    maxTime = std::max(maxTime, times[i]);
+    if ((i - first) % INDEX_STRIDE == 0) blockTimes.push_back(maxTime);
+  }
+}
+
+size_t ReplayCursor::Seek(double time) {
+  const auto& times = frames.GetTimes();
+  if (times.empty()) return index = 0;
+
+  // Playback usually moves forward by a frame or two per rendered frame.
+  if (started && time >= times[index]) {
+    size_t steps = 0;
+    while (index + 1 < times.size() && time >= times[index + 1] &&
+           steps < MAX_LINEAR_STEPS) {
+      ++index;
+      ++steps;
+    }
+    if (index + 1 == times.size() || time < times[index + 1]) return index;
+  }
+
+  auto block = std::upper_bound(blockTimes.begin(), blockTimes.end(), time,
+                                [](double t, int32_t blockTime) {
+                                  return t < blockTime;
+                                });
+  if (block == blockTimes.begin()) {
+    started = false;
+    return index = 0;
+  }
+  size_t blockIndex = (block - blockTimes.begin()) - 1;
+  auto begin = times.begin() + first + blockIndex * INDEX_STRIDE;
+  auto end = times.begin() +
+             std::min(times.size(), first + (blockIndex + 2) * INDEX_STRIDE);
+  auto it = std::upper_bound(begin, end, time, [](double t, int32_t frameTime) {
+    return t < frameTime;
+  });
+  index = (it - times.begin()) - 1;
+  started = true;
+  return index;
+}
+
+glm::vec2 ReplayCursor::GetPosition(double time) const {
+  auto pos = frames.GetPosition(index);
+  if (started && index + 1 < frames.size()) {
+    double before = frames.GetTime(index), after = frames.GetTime(index + 1);
+    if (after > before) {
+      float lerpFactor = static_cast<float>(
+          std::clamp((time - before) / (after - before), 0.0, 1.0));
+      pos = pos * (1 - lerpFactor) + frames.GetPosition(index + 1) * lerpFactor;
+    }
+  }
+  return pos;
+}
+
+}  // namespace osrp
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "frames.hpp"
+
+namespace osrp {
+
+// Playback position inside a FrameArray. Seeking forward by a few frames, the
+// common case when playing back, is a short linear step; anything else goes
+// through a sparse index of every INDEX_STRIDE-th frame time followed by a
+// binary search inside one block, so jumps in either direction are
+// O(log n) while touching only a couple of cache lines.
+class ReplayCursor {
+ public:
+  static constexpr size_t INDEX_STRIDE = 256;
+
+  explicit ReplayCursor(const FrameArray& frames);
+
+  // Moves to the last frame whose time is at most time (in milliseconds)
+  // and returns its index. The frames osu! writes ahead of the lead-in, each
+  // later than the next one, are skipped; before the lead-in the cursor rests
+  // on frame 0.
+  size_t Seek(double time);
+
+  size_t GetIndex() const { return index; }
+  // Whether the last seek landed at or after the first frame.
+  bool IsStarted() const { return started; }
+
+  // Cursor position at time, interpolated between the current frame and the
+  // next one. Only meaningful after Seek(time).
+  glm::vec2 GetPosition(double time) const;
+
+ private:
+  static constexpr size_t MAX_LINEAR_STEPS = 8;
+
+  const FrameArray& frames;
+  // First frame of the lead-in, where the blocks start.
+  size_t first = 0;
+  // Running maximum of the frame times at each block start, so the index
+  // stays sorted even if later frames are out of order.
+  std::vector<int32_t> blockTimes;
+  size_t index = 0;
+  bool started = false;
+};
+
+}  // namespace osrp
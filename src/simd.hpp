@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+// Helpers shared by the runtime dispatched SIMD kernels. OSRP_X86 is set
+// when SSE2 is available at compile time; AVX2 variants are compiled with
+// OSRP_TARGET_AVX2 and only called when CpuSupportsAVX2() says so.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define OSRP_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define OSRP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define OSRP_TARGET_AVX2
+#endif
+
+namespace osrp {
+
+inline unsigned CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+#ifdef OSRP_X86
+inline bool CpuSupportsAVX2() {
+#if defined(__GNUC__)
+  return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  bool osxsave = info[2] & (1 << 27);
+  __cpuidex(info, 7, 0);
+  bool avx2 = info[1] & (1 << 5);
+  return osxsave && avx2 && (_xgetbv(0) & 6) == 6;
+#else
+  return false;
+#endif
+}
+#endif
+
+}  // namespace osrp
@@ -0,0 +1,231 @@
+#include "slider_path.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace osrp {
+
+namespace {
+constexpr double PI = 3.14159265358979323846;
+// Maximum distance of the circle flattening from the true arc.
+constexpr float CIRCLE_TOLERANCE = 0.1f;
+// Control polygon length per evaluated Bezier point.
+constexpr float BEZIER_STEP = 2.0f;
+// Bound on interpolations per Bezier segment. De Casteljau is quadratic in
+// the control point count, so high degree segments get fewer steps.
+constexpr size_t BEZIER_MAX_WORK = size_t(1) << 24;
+constexpr int CATMULL_DETAIL = 50;
+
+void FlattenBezier(const glm::vec2* control, size_t count,
+                   std::vector<glm::vec2>& scratch,
+                   std::vector<glm::vec2>& out) {
+  if (count < 3) {
+    out.insert(out.end(), control, control + count);
+    return;
+  }
+  float polygonLength = 0.0f;
+  for (size_t i = 1; i < count; i++) {
+    polygonLength += glm::distance(control[i - 1], control[i]);
+  }
+  int maxSteps = static_cast<int>(
+      std::clamp<size_t>(BEZIER_MAX_WORK / (count * count), 1, 10000));
+  float idealSteps = polygonLength / BEZIER_STEP;
+  int steps = idealSteps < maxSteps
+                  ? std::max(1, static_cast<int>(idealSteps))
+                  : maxSteps;
+  for (int step = 0; step <= steps; step++) {
+    float t = static_cast<float>(step) / steps;
+    // De Casteljau, numerically stable for the high degree curves some
+    // maps use.
+    scratch.assign(control, control + count);
+    for (size_t level = count - 1; level > 0; level--) {
+      for (size_t i = 0; i < level; i++) {
+        scratch[i] = glm::mix(scratch[i], scratch[i + 1], t);
+      }
+    }
+    out.push_back(scratch[0]);
+  }
+}
+
+// Returns false for (nearly) collinear points, which osu! draws as Bezier.
+bool FlattenCircle(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c,
+                   std::vector<glm::vec2>& out) {
+  double d = 2.0 * (a.x * (b.y - c.y) + b.x * (c.y - a.y) + c.x * (a.y - b.y));
+  if (std::abs(d) < 1e-3) return false;
+
+  // Doubles keep the head on the arc to well within a pixel fraction.
+  double aSq = glm::dot(a, a), bSq = glm::dot(b, b), cSq = glm::dot(c, c);
+  glm::dvec2 center(
+      (aSq * (b.y - c.y) + bSq * (c.y - a.y) + cSq * (a.y - b.y)) / d,
+      (aSq * (c.x - b.x) + bSq * (a.x - c.x) + cSq * (b.x - a.x)) / d);
+  double radius = glm::distance(a, center);
+  double thetaStart = std::atan2(a.y - center.y, a.x - center.x);
+  double thetaEnd = std::atan2(c.y - center.y, c.x - center.x);
+  while (thetaEnd < thetaStart) thetaEnd += 2.0 * PI;
+  double direction = 1.0, range = thetaEnd - thetaStart;
+  // Go the other way around if b is not on the arc from a to c.
+  glm::dvec2 ortho(c.y - a.y, -(c.x - a.x));
+  if (glm::dot(ortho, b - a) < 0.0) {
+    direction = -1.0;
+    range = 2.0 * PI - range;
+  }
+
+  int count = 2;
+  if (2.0 * radius > CIRCLE_TOLERANCE) {
+    double step = 2.0 * std::acos(1.0 - CIRCLE_TOLERANCE / radius);
+    count = std::max(2, static_cast<int>(std::ceil(range / step)) + 1);
+  }
+  for (int i = 0; i < count; i++) {
+    double theta = thetaStart + direction * range * i / (count - 1);
+    out.emplace_back(center.x + radius * std::cos(theta),
+                     center.y + radius * std::sin(theta));
+  }
+  return true;
+}
+
+glm::vec2 CatmullPoint(glm::vec2 v1, glm::vec2 v2, glm::vec2 v3, glm::vec2 v4,
+                       float t) {
+  float t2 = t * t, t3 = t2 * t;
+  return 0.5f * (2.0f * v2 + (-v1 + v3) * t +
+                 (2.0f * v1 - 5.0f * v2 + 4.0f * v3 - v4) * t2 +
+                 (-v1 + 3.0f * v2 - 3.0f * v3 + v4) * t3);
+}
+
+void FlattenCatmull(const std::vector<glm::vec2>& control,
+                    std::vector<glm::vec2>& out) {
+  size_t n = control.size();
+  for (size_t i = 0; i + 1 < n; i++) {
+    glm::vec2 v1 = i > 0 ? control[i - 1] : control[i];
+    glm::vec2 v2 = control[i], v3 = control[i + 1];
+    glm::vec2 v4 = i + 2 < n ? control[i + 2] : 2.0f * v3 - v2;
+    for (int c = 0; c < CATMULL_DETAIL; c++) {
+      out.push_back(CatmullPoint(v1, v2, v3, v4,
+                                 static_cast<float>(c) / CATMULL_DETAIL));
+    }
+  }
+  out.push_back(control.back());
+}
+
+void Flatten(CurveType type, const std::vector<glm::vec2>& control,
+             std::vector<glm::vec2>& scratch, std::vector<glm::vec2>& out) {
+  switch (type) {
+    case CurveType::LINEAR:
+      out = control;
+      return;
+    case CurveType::CATMULL:
+      FlattenCatmull(control, out);
+      return;
+    case CurveType::PERFECT_CIRCLE:
+      if (control.size() == 3 &&
+          FlattenCircle(control[0], control[1], control[2], out)) {
+        return;
+      }
+      out.clear();
+      [[fallthrough]];
+    case CurveType::BEZIER: {
+      // A repeated control point ends one Bezier segment and starts the
+      // next.
+      size_t segmentStart = 0;
+      for (size_t i = 1; i <= control.size(); i++) {
+        if (i == control.size() || control[i] == control[i - 1]) {
+          FlattenBezier(control.data() + segmentStart, i - segmentStart,
+                        scratch, out);
+          segmentStart = i;
+        }
+      }
+      return;
+    }
+  }
+}
+
+// Appends count points spaced length / (count - 1) apart along polyline,
+// extending its last segment if the slider is longer than the curve.
+void Resample(const std::vector<glm::vec2>& polyline, float length,
+              uint32_t count, std::vector<glm::vec2>& out) {
+  float spacing = length / (count - 1);
+  size_t segment = 0;
+  float segmentStart = 0.0f;
+  for (uint32_t k = 0; k < count; k++) {
+    float distance = k * spacing;
+    float segmentLength = 0.0f;
+    while (true) {
+      segmentLength = glm::distance(polyline[segment], polyline[segment + 1]);
+      if (segment + 2 >= polyline.size() ||
+          segmentStart + segmentLength >= distance) {
+        break;
+      }
+      segmentStart += segmentLength;
+      segment++;
+    }
+    if (segmentLength <= 0.0f) {
+      out.push_back(polyline[segment]);
+    } else {
+      out.push_back(glm::mix(polyline[segment], polyline[segment + 1],
+                             (distance - segmentStart) / segmentLength));
+    }
+  }
+}
+}  // namespace
+
+SliderPaths::SliderPaths(const HitObjectList& hitObjects) {
+  paths.resize(hitObjects.objects.size());
+  std::vector<glm::vec2> control, polyline, scratch;
+  for (size_t i = 0; i < hitObjects.objects.size(); i++) {
+    const auto& object = hitObjects.objects[i];
+    auto& path = paths[i];
+    path.offset = static_cast<uint32_t>(points.size());
+    if (object.type != HitObjectType::SLIDER) {
+      path.count = 1;
+      points.push_back(object.pos);
+      continue;
+    }
+
+    control.assign(1, object.pos);
+    auto curveBegin = hitObjects.curvePoints.begin() + object.curvePointOffset;
+    control.insert(control.end(), curveBegin,
+                   curveBegin + object.curvePointCount);
+    polyline.clear();
+    Flatten(object.curveType, control, scratch, polyline);
+    // Drop zero-length pieces so every remaining segment has a direction.
+    polyline.erase(std::unique(polyline.begin(), polyline.end()),
+                   polyline.end());
+
+    float curveLength = 0.0f;
+    for (size_t j = 1; j < polyline.size(); j++) {
+      curveLength += glm::distance(polyline[j - 1], polyline[j]);
+    }
+    path.slides = object.slides;
+    path.length = object.length > 0.0f ? object.length : curveLength;
+    // The curve itself can be huge when the slider has no length of its own.
+    path.length = std::min(path.length, HitObjectList::MAX_SLIDER_LENGTH);
+    if (polyline.size() < 2 || !(path.length > 0.0f)) {
+      path.count = 1;
+      path.length = 0.0f;
+      points.push_back(object.pos);
+      continue;
+    }
+    path.count = std::max<uint32_t>(
+        2, static_cast<uint32_t>(std::ceil(path.length / SAMPLE_SPACING)) + 1);
+    path.spacing = path.length / (path.count - 1);
+    Resample(polyline, path.length, path.count, points);
+  }
+}
+
+glm::vec2 SliderPaths::GetPosition(size_t object, float progress) const {
+  const auto& path = paths[object];
+  const auto* pathPoints = points.data() + path.offset;
+  if (path.count == 1) return pathPoints[0];
+  float position = std::clamp(progress, 0.0f, 1.0f) * (path.count - 1);
+  auto index = std::min(static_cast<uint32_t>(position), path.count - 2);
+  return glm::mix(pathPoints[index], pathPoints[index + 1], position - index);
+}
+
+glm::vec2 SliderPaths::GetBallPosition(size_t object, float completion) const {
+  int32_t slides = paths[object].slides;
+  float slide = std::clamp(completion, 0.0f, 1.0f) * slides;
+  int32_t pass = std::min(static_cast<int32_t>(slide), slides - 1);
+  float progress = slide - pass;
+  return GetPosition(object, pass % 2 == 0 ? progress : 1.0f - progress);
+}
+
+}  // namespace osrp
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+
+#include "hit_objects.hpp"
+
+namespace osrp {
+
+// Slider curves of a HitObjectList, flattened once and resampled to points
+// spaced evenly by arc length so a position is a single lerp.
+class SliderPaths {
+ public:
+  // Maximum distance between resampled points, in osu! pixels.
+  static constexpr float SAMPLE_SPACING = 2.0f;
+
+  struct Path {
+    uint32_t offset = 0, count = 0;
+    int32_t slides = 1;
+    // Arc length between consecutive points.
+    float spacing = 0.0f;
+    float length = 0.0f;
+  };
+
+  SliderPaths() = default;
+  explicit SliderPaths(const HitObjectList& hitObjects);
+  // Takes over previously built paths, e.g. from the beatmap cache.
+  SliderPaths(std::vector<Path> paths, std::vector<glm::vec2> points)
+      : paths(std::move(paths)), points(std::move(points)) {}
+
+  // Indexed like HitObjectList::objects. Objects other than sliders get a
+  // single point at their position.
+  const Path& GetPath(size_t object) const { return paths[object]; }
+  const std::vector<Path>& GetPaths() const { return paths; }
+  const std::vector<glm::vec2>& GetPoints() const { return points; }
+
+  // Position after progress in [0, 1] of one slide from the head.
+  glm::vec2 GetPosition(size_t object, float progress) const;
+  // Position of the ball after completion in [0, 1] of the whole slider,
+  // following the repeats back and forth.
+  glm::vec2 GetBallPosition(size_t object, float completion) const;
+  // Where the ball is when the slider ends, the head for even slides.
+  glm::vec2 GetEndPosition(size_t object) const {
+    return GetBallPosition(object, 1.0f);
+  }
+
+ private:
+  std::vector<Path> paths;
+  std::vector<glm::vec2> points;
+};
+
+}  // namespace osrp
@@ -0,0 +1,129 @@
+#include "stacking.hpp"
+
+#include "beatmap.hpp"
+
+namespace osrp {
+
+namespace {
+constexpr float STACK_DISTANCE = 3.0f;
+
+bool IsNear(glm::vec2 a, glm::vec2 b) {
+  return glm::distance(a, b) < STACK_DISTANCE;
+}
+
+struct StackInput {
+  const std::vector<HitObject>& objects;
+  // Slider ends from the timing points, the object's endTime otherwise.
+  std::vector<double> endTimes;
+  std::vector<glm::vec2> endPositions;
+  double threshold;
+};
+
+// Walks backwards from every object and pulls earlier objects under it up
+// the stack, so the latest object of a stack stays on top.
+void ApplyStacking(const StackInput& input, std::vector<int32_t>& heights) {
+  const auto& objects = input.objects;
+  for (size_t i = objects.size(); i-- > 0;) {
+    if (heights[i] != 0 || objects[i].type == HitObjectType::SPINNER) {
+      continue;
+    }
+    size_t top = i;
+    if (objects[i].type == HitObjectType::CIRCLE) {
+      for (size_t n = i; n-- > 0;) {
+        if (objects[n].type == HitObjectType::SPINNER) continue;
+        if (objects[top].time - input.endTimes[n] > input.threshold) break;
+        // A circle on a slider end pushes the stack down and right instead.
+        if (objects[n].type == HitObjectType::SLIDER &&
+            IsNear(input.endPositions[n], objects[top].pos)) {
+          int32_t offset = heights[top] - heights[n] + 1;
+          for (size_t j = n + 1; j <= i; j++) {
+            if (IsNear(input.endPositions[n], objects[j].pos)) {
+              heights[j] -= offset;
+            }
+          }
+          break;
+        }
+        if (IsNear(objects[n].pos, objects[top].pos)) {
+          heights[n] = heights[top] + 1;
+          top = n;
+        }
+      }
+    } else if (objects[i].type == HitObjectType::SLIDER) {
+      for (size_t n = i; n-- > 0;) {
+        if (objects[n].type == HitObjectType::SPINNER) continue;
+        if (objects[top].time - objects[n].time > input.threshold) break;
+        if (IsNear(input.endPositions[n], objects[top].pos)) {
+          heights[n] = heights[top] + 1;
+          top = n;
+        }
+      }
+    }
+  }
+}
+
+// Before v6 only later objects at the same spot, or at the end of a
+// slider's first slide, are stacked.
+void ApplyStackingOld(const StackInput& input, const SliderPaths& paths,
+                      std::vector<int32_t>& heights) {
+  const auto& objects = input.objects;
+  for (size_t i = 0; i < objects.size(); i++) {
+    bool slider = objects[i].type == HitObjectType::SLIDER;
+    if (heights[i] != 0 && !slider) continue;
+    double startTime = input.endTimes[i];
+    glm::vec2 slideEnd = slider ? paths.GetPosition(i, 1.0f) : objects[i].pos;
+    int32_t sliderStack = 0;
+    for (size_t j = i + 1; j < objects.size(); j++) {
+      if (objects[j].time - input.threshold > startTime) break;
+      if (IsNear(objects[j].pos, objects[i].pos)) {
+        heights[i]++;
+        startTime = input.endTimes[j];
+      } else if (IsNear(objects[j].pos, slideEnd)) {
+        sliderStack++;
+        heights[j] -= sliderStack;
+        startTime = input.endTimes[j];
+      }
+    }
+  }
+}
+}  // namespace
+
+std::vector<int32_t> ComputeStackHeights(const Beatmap& map, double preempt) {
+  auto leniency = map.GetProperty<double>(KeyValueSection::GENERAL,
+                                          "StackLeniency");
+  auto sliderMultiplierValue = map.GetProperty<double>(
+      KeyValueSection::DIFFICULTY, "SliderMultiplier");
+  double sliderMultiplier =
+      sliderMultiplierValue.HasValue() ? sliderMultiplierValue.Value() : 1.4;
+  const auto& objects = map.GetHitObjects().objects;
+  const auto& paths = map.GetSliderPaths();
+  StackInput input{objects, {}, {}, 0.0};
+  input.threshold = preempt * (leniency.HasValue() ? leniency.Value() : 0.7);
+  input.endTimes.reserve(objects.size());
+  input.endPositions.reserve(objects.size());
+
+  TimingCursor timing(map.GetTimingTimeline());
+  for (size_t i = 0; i < objects.size(); i++) {
+    const auto& object = objects[i];
+    if (object.type != HitObjectType::SLIDER) {
+      input.endTimes.push_back(object.endTime);
+      input.endPositions.push_back(object.pos);
+      continue;
+    }
+    const auto& state = timing.Seek(object.time);
+    input.endTimes.push_back(
+        object.time +
+        state.GetSlideDuration(object.length, sliderMultiplier) *
+            object.slides);
+    input.endPositions.push_back(paths.GetEndPosition(i));
+  }
+
+  std::vector<int32_t> heights(objects.size(), 0);
+  if (map.GetFormatVersion() >= 6) {
+    ApplyStacking(input, heights);
+  } else {
+    ApplyStackingOld(input, paths, heights);
+  }
+  return heights;
+}
+
+}  // namespace osrp
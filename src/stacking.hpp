@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace osrp {
+
+class Beatmap;
+
+// Stack height of every hit object, indexed like HitObjectList::objects.
+// Objects less than 3 osu! pixels apart whose times are within
+// preempt * StackLeniency of each other form a stack. preempt is the
+// approach time after mods, see ModdedBeatmap. Beatmaps before format v6
+// use osu!'s older algorithm.
+std::vector<int32_t> ComputeStackHeights(const Beatmap& map, double preempt);
+
+// Every level of a stack moves an object up and left by a tenth of the
+// circle radius; negative heights (below a slider end) move it down right.
+inline glm::vec2 GetStackOffset(int32_t height, float circleRadius) {
+  return glm::vec2(height * circleRadius * -0.1f);
+}
+
+}  // namespace osrp
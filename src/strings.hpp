@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <charconv>
+#include <cmath>
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -12,8 +15,8 @@ namespace osrp {
 inline std::string_view TrimWhitespace(const std::string_view& str) {
   auto begin = str.begin();
   auto end = str.end();
-  while (isspace(*begin) && begin <= end) begin++;
-  while (isspace(*(end - 1)) && begin <= end) end--;
+  while (begin < end && isspace(*begin)) begin++;
+  while (begin < end && isspace(*(end - 1))) end--;
   return std::string_view(begin, static_cast<size_t>(end - begin));
 }
 
@@ -36,10 +39,85 @@ inline Result<std::string_view> ParseString(const std::string_view& str) {
   return Result<std::string_view>(str);
 }
 
+// Allocation-free parser for the decimal notations found in .osr and .osu
+// files ("-12.5", "3", "1.525879E-05"). Digits past the 19th significant one
+// are dropped, which is well below float precision. Returns false unless the
+// whole string is consumed.
+inline bool ParseDecimal(const std::string_view& str, double& value) {
+  static constexpr double POWERS_OF_TEN[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  const char* p = str.data();
+  const char* end = p + str.size();
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+  uint64_t mantissa = 0;
+  int exponent = 0, significantDigits = 0;
+  bool anyDigits = false, fraction = false;
+  for (; p < end; p++) {
+    if (*p == '.' && !fraction) {
+      fraction = true;
+      continue;
+    }
+    unsigned digit = static_cast<unsigned char>(*p) - '0';
+    if (digit > 9) break;
+    anyDigits = true;
+    if (significantDigits < 19) {
+      mantissa = mantissa * 10 + digit;
+      if (mantissa != 0) significantDigits++;
+      if (fraction) exponent--;
+    } else if (!fraction) {
+      exponent++;
+    }
+  }
+  if (!anyDigits) return false;
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    // Far beyond the double range either way, and safe to add to.
+    constexpr int MAX_EXPONENT = 100000;
+    int explicitExponent = 0;
+    const char* digits = p + 1 + (p + 1 < end && p[1] == '+');
+    auto [ptr, errc] = std::from_chars(digits, end, explicitExponent);
+    if (errc == std::errc::result_out_of_range) {
+      explicitExponent = *digits == '-' ? -MAX_EXPONENT : MAX_EXPONENT;
+    } else if (errc != std::errc()) {
+      return false;
+    }
+    exponent += std::clamp(explicitExponent, -MAX_EXPONENT, MAX_EXPONENT);
+    p = ptr;
+  }
+  if (p != end) return false;
+
+  double result = static_cast<double>(mantissa);
+  if (mantissa == 0) exponent = 0;
+  if (exponent < 0 && exponent >= -22) {
+    result /= POWERS_OF_TEN[-exponent];
+  } else if (exponent > 0 && exponent <= 22) {
+    result *= POWERS_OF_TEN[exponent];
+  } else if (exponent != 0) {
+    result *= std::pow(10.0, exponent);
+  }
+  value = negative ? -result : result;
+  return true;
+}
+
 // gcc-10 doesn't support std::from_chars for floating-point types
-template<>
+template <>
+inline Result<double> ParseString(const std::string_view& str) {
+  double value;
+  if (ParseDecimal(TrimWhitespace(str), value)) {
+    return Result<double>(value);
+  } else {
+    return Result<double>(std::make_error_code(std::errc::invalid_argument));
+  }
+}
+
+template <>
 inline Result<float> ParseString(const std::string_view& str) {
-  return Result<float>(std::stof(std::string(TrimWhitespace(str))));
+  return ParseString<double>(str).Map(
+      [](double value) { return static_cast<float>(value); });
 }
 
 template <typename T>
@@ -0,0 +1,114 @@
+#include "thread_pool.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+namespace osrp {
+
+namespace {
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threadCount) {
+  if (threadCount == 0) threadCount = 1;
+  for (size_t i = 0; i < threadCount; i++) {
+    queues.push_back(std::make_unique<Queue>());
+  }
+  for (size_t i = 0; i < threadCount; i++) {
+    threads.emplace_back([this, i]() { WorkerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  taskAvailable.notify_all();
+  for (auto& thread : threads) thread.join();
+}
+
+size_t ThreadPool::GetWorkerIndex() const {
+  return currentPool == this ? currentWorker : threads.size();
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  size_t index = GetWorkerIndex();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (index == threads.size()) {
+      index = nextQueue;
+      nextQueue = (nextQueue + 1) % queues.size();
+    }
+    ++queuedTasks;
+    ++unfinishedTasks;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queues[index]->mutex);
+    queues[index]->tasks.push_back(std::move(task));
+  }
+  taskAvailable.notify_one();
+}
+
+void ThreadPool::Wait() {
+  if (GetWorkerIndex() != threads.size()) {
+    throw std::logic_error("ThreadPool::Wait called from a task of its pool");
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  allDone.wait(lock, [this]() { return unfinishedTasks == 0; });
+  if (firstError) std::rethrow_exception(std::exchange(firstError, nullptr));
+}
+
+bool ThreadPool::TryPop(size_t index, std::function<void()>& task) {
+  {
+    auto& own = *queues[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.front());
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues.size(); i++) {
+    auto& victim = *queues[(index + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+  currentPool = this;
+  currentWorker = index;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      taskAvailable.wait(lock,
+                         [this]() { return stopping || queuedTasks > 0; });
+      if (queuedTasks == 0) return;
+      --queuedTasks;
+    }
+
+    // A task is reserved for us, but it may still be in flight to its queue.
+    std::function<void()> task;
+    while (!TryPop(index, task)) std::this_thread::yield();
+    std::exception_ptr error;
+    try {
+      task();
+    } catch (...) {
+      // Handed to the thread in Wait instead of terminating the process.
+      error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error && !firstError) firstError = error;
+    if (--unfinishedTasks == 0) allDone.notify_all();
+  }
+}
+
+}  // namespace osrp
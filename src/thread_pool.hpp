@@ -0,0 +1,73 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace osrp {
+
+// Fixed-size pool where every worker owns a task deque. Workers run their own
+// queue in submission order and steal from the front of the others when it
+// runs dry, so a few long tasks do not leave the remaining threads idle and
+// tasks submitted first also start first.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void Submit(std::function<void()> task);
+  // Blocks until every submitted task has finished, then rethrows the first
+  // exception a task threw since the previous Wait, if any. Tasks must not
+  // wait on their own pool, since they would wait for themselves; doing so
+  // throws std::logic_error.
+  void Wait();
+
+  size_t GetThreadCount() const { return threads.size(); }
+
+  // Index of the calling pool worker, or GetThreadCount() for other threads.
+  size_t GetWorkerIndex() const;
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable taskAvailable, allDone;
+  size_t queuedTasks = 0, unfinishedTasks = 0, nextQueue = 0;
+  bool stopping = false;
+  std::exception_ptr firstError;
+
+  void WorkerLoop(size_t index);
+  bool TryPop(size_t index, std::function<void()>& task);
+};
+
+// Runs func(i) for every i in [0, count) on the pool and waits for them.
+// If any call throws, the remaining ones still run and the first exception
+// is rethrown. Like Wait, it must not be called from a task of the pool.
+template <typename Func>
+void ParallelFor(ThreadPool& pool, size_t count, Func func) {
+  if (pool.GetWorkerIndex() != pool.GetThreadCount()) {
+    throw std::logic_error("ParallelFor called from a task of its pool");
+  }
+  for (size_t i = 0; i < count; i++) {
+    pool.Submit([&func, i]() { func(i); });
+  }
+  pool.Wait();
+}
+
+}  // namespace osrp
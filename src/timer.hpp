@@ -12,6 +12,8 @@ class AbstractTimer {
   virtual double GetTime() const = 0;
   virtual double GetSpeed() const = 0;
   virtual void SetSpeed(double speed) = 0;
+  // Jumps to time (in seconds) without changing the speed.
+  virtual void SetTime(double time) = 0;
 };
 
 template <typename TimePoint>
@@ -19,19 +21,35 @@ class Timer : public AbstractTimer {
  public:
   Timer(std::function<TimePoint()> rawTimer,
         std::function<double(TimePoint, TimePoint)> diff)
-      : rawTimer(rawTimer), diff(diff), startTime(rawTimer()), speed(1.0) {}
+      : rawTimer(rawTimer),
+        diff(diff),
+        startTime(rawTimer()),
+        startOffset(0.0),
+        speed(1.0) {}
 
   TimePoint GetRawTime() const { return rawTimer(); }
 
-  double GetTime() const { return diff(startTime, rawTimer()) * speed; }
+  double GetTime() const {
+    return startOffset + diff(startTime, rawTimer()) * speed;
+  }
 
   double GetSpeed() const { return speed; }
-  void SetSpeed(double speed) { this->speed = speed; }
+  // Time stays continuous across speed changes, only its rate changes.
+  void SetSpeed(double speed) {
+    SetTime(GetTime());
+    this->speed = speed;
+  }
+
+  void SetTime(double time) {
+    startTime = rawTimer();
+    startOffset = time;
+  }
 
  private:
   std::function<TimePoint()> rawTimer;
   std::function<double(TimePoint, TimePoint)> diff;
   TimePoint startTime;
+  double startOffset;
   double speed;
 };
 
@@ -0,0 +1,84 @@
+#include "timing_timeline.hpp"
+
+#include <algorithm>
+
+namespace osrp {
+
+TimingTimeline::TimingTimeline(const std::vector<TimingPoint>& points) {
+  TimingState current;
+  // Time of the last inherited point, which wins over an uninherited point
+  // at the same time regardless of their order in the file.
+  double inheritedTime = -1e300;
+  size_t firstUninherited = points.size();
+
+  for (const auto& point : points) {
+    if (point.uninherited) {
+      current.beatLength = point.beatLength;
+      current.beatOffset = point.time;
+      current.meter = point.meter;
+      if (inheritedTime != point.time) current.sliderVelocity = 1.0;
+    } else {
+      current.sliderVelocity =
+          point.beatLength < 0.0
+              ? std::clamp(-100.0 / point.beatLength, 0.1, 10.0)
+              : 1.0;
+      inheritedTime = point.time;
+    }
+    current.sampleSet = point.sampleSet;
+    current.sampleIndex = point.sampleIndex;
+    current.volume = point.volume;
+    current.effects = point.effects;
+
+    if (!times.empty() && times.back() == point.time) {
+      states.back() = current;
+    } else {
+      times.push_back(point.time);
+      states.push_back(current);
+    }
+    // The state that received the point, which is the merged one when an
+    // inherited point came first at the same time.
+    if (point.uninherited && firstUninherited == points.size()) {
+      firstUninherited = states.size() - 1;
+    }
+  }
+
+  if (states.empty()) {
+    times.push_back(0.0);
+    states.emplace_back();
+    return;
+  }
+  // Inherited points before the first uninherited one still need a tempo;
+  // osu! uses the first uninherited point for everything before it.
+  if (firstUninherited < states.size()) {
+    const auto& first = states[firstUninherited];
+    for (size_t i = 0; i < firstUninherited; i++) {
+      states[i].beatLength = first.beatLength;
+      states[i].beatOffset = first.beatOffset;
+      states[i].meter = first.meter;
+    }
+  }
+}
+
+size_t TimingTimeline::Find(double time) const {
+  auto it = std::upper_bound(times.begin(), times.end(), time);
+  return std::max<size_t>(it - times.begin(), 1) - 1;
+}
+
+const TimingState& TimingCursor::Seek(double time) {
+  const auto& times = timeline.GetTimes();
+  if (time >= times[index]) {
+    size_t steps = 0;
+    while (index + 1 < times.size() && time >= times[index + 1] &&
+           steps < MAX_LINEAR_STEPS) {
+      ++index;
+      ++steps;
+    }
+    if (index + 1 == times.size() || time < times[index + 1]) {
+      return timeline.GetStates()[index];
+    }
+  }
+  index = timeline.Find(time);
+  return timeline.GetStates()[index];
+}
+
+}  // namespace osrp
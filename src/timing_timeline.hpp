@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "hit_objects.hpp"
+
+namespace osrp {
+
+// Timing in effect from one timing point until the next.
+struct TimingState {
+  // From the active uninherited point, the origin of beat snapping.
+  double beatLength = 500.0;
+  double beatOffset = 0.0;
+  int32_t meter = 4;
+  // Multiplier of the active inherited point, reset to 1 by every
+  // uninherited point.
+  double sliderVelocity = 1.0;
+  // From the latest point of either kind.
+  uint8_t sampleSet = 0, sampleIndex = 0, volume = 100, effects = 0;
+
+  // Duration of one slide of a slider length osu! pixels long.
+  double GetSlideDuration(double length, double sliderMultiplier) const {
+    return length / (sliderMultiplier * 100.0 * sliderVelocity) * beatLength;
+  }
+};
+
+// Timing points compiled into one state per distinct point time, with the
+// inherited/uninherited precedence already resolved. Before the first point
+// the first state applies; a map without timing points gets a single
+// default (120 BPM) state.
+class TimingTimeline {
+ public:
+  TimingTimeline() : times{0.0}, states(1) {}
+  // points must be sorted by time, as Beatmap::GetTimingPoints is.
+  explicit TimingTimeline(const std::vector<TimingPoint>& points);
+
+  // Index of the state active at time, by binary search.
+  size_t Find(double time) const;
+  const TimingState& At(double time) const { return states[Find(time)]; }
+
+  size_t size() const { return states.size(); }
+  const std::vector<double>& GetTimes() const { return times; }
+  const std::vector<TimingState>& GetStates() const { return states; }
+
+ private:
+  std::vector<double> times;
+  std::vector<TimingState> states;
+};
+
+// Position in a TimingTimeline for sequential queries, e.g. walking hit
+// objects in order or following playback. Moving forward past a few points
+// is a linear step, anything else a binary search.
+class TimingCursor {
+ public:
+  explicit TimingCursor(const TimingTimeline& timeline)
+      : timeline(timeline) {}
+
+  const TimingState& Seek(double time);
+  size_t GetIndex() const { return index; }
+
+ private:
+  static constexpr size_t MAX_LINEAR_STEPS = 8;
+
+  const TimingTimeline& timeline;
+  size_t index = 0;
+};
+
+}  // namespace osrp
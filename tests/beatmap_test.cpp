@@ -0,0 +1,141 @@
+#include <algorithm>
+
+#include "beatmap.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+const fs::path MAP_PATH = "res/magma/magma_top_diff.osu";
+
+fs::path WriteMap(const fs::path& dir, const std::string& name,
+                  const std::string& text) {
+  auto path = dir / name;
+  WriteFileAtomic(path, reinterpret_cast<const uint8_t*>(text.data()),
+                  text.size());
+  return path;
+}
+}  // namespace
+
+TEST(HitObjectListRejectsExcessiveSlides) {
+  HitObjectList list;
+  EXPECT(list.Parse("100,100,1000,2,0,L|200:100,2,100").HasValue());
+  EXPECT_EQ(list.sliderEdges.size(), size_t{3});
+  EXPECT(list.Parse("100,100,2000,2,0,L|200:100,9000,100").HasValue());
+  EXPECT(!list.Parse("100,100,3000,2,0,L|200:100,9001,100").HasValue());
+  EXPECT(!list.Parse("100,100,3000,2,0,L|200:100,2147483647,100").HasValue());
+  EXPECT_EQ(list.objects.size(), size_t{2});
+  EXPECT_EQ(list.sliderEdges.size(), size_t{3 + 9001});
+}
+
+TEST(BeatmapEventsAreRawRows) {
+  for (auto loading : {BeatmapLoading::EAGER, BeatmapLoading::LAZY}) {
+    Beatmap map(MAP_PATH, loading);
+    const auto& events = map.GetEvents();
+    EXPECT(!events.empty());
+    for (const auto& row : events) EXPECT(!row.empty());
+    EXPECT(!map.GetHitObjects().objects.empty());
+    EXPECT(!map.GetTimingPoints().empty());
+  }
+}
+
+TEST(BeatmapWithoutEventsHasNoEventRows) {
+  test::TempDirectory dir("beatmap_events");
+  const std::string head =
+      "osu file format v14\n\n[General]\nMode: 0\n\n"
+      "[Difficulty]\nCircleSize:4\n\n";
+  const std::string tail =
+      "[TimingPoints]\n0,500,4,2,0,100,1,0\n\n"
+      "[HitObjects]\n256,192,1000,1,0,0:0:0:0:\n";
+  fs::path paths[] = {
+      WriteMap(dir.path, "missing.osu", head + tail),
+      WriteMap(dir.path, "empty.osu", head + "[Events]\n" + tail),
+      WriteMap(dir.path, "last.osu", head + tail + "[Events]\n")};
+  for (const auto& path : paths) {
+    for (auto loading : {BeatmapLoading::EAGER, BeatmapLoading::LAZY}) {
+      Beatmap map(path, loading);
+      EXPECT(map.GetEvents().empty());
+      EXPECT_EQ(map.GetHitObjects().objects.size(), size_t{1});
+
+      map.WriteCache(dir.path / "map.osuc");
+      auto cached = Beatmap::ReadCache(dir.path / "map.osuc", path);
+      EXPECT(cached.has_value());
+      if (cached) EXPECT(cached->GetEvents().empty());
+    }
+  }
+}
+
+TEST(BeatmapCacheRoundTripIsExact) {
+  test::TempDirectory dir("beatmap_cache");
+  Beatmap map(MAP_PATH);
+  map.WriteCache(dir.path / "a.osuc");
+  map.WriteCache(dir.path / "b.osuc");
+  MappedFile a(dir.path / "a.osuc"), b(dir.path / "b.osuc");
+  EXPECT(a.Size() == b.Size() &&
+         std::equal(a.Data(), a.Data() + a.Size(), b.Data()));
+
+  auto cached = Beatmap::ReadCache(dir.path / "a.osuc", MAP_PATH);
+  EXPECT(cached.has_value());
+  if (!cached) return;
+  const auto& objects = map.GetHitObjects().objects;
+  const auto& cachedObjects = cached->GetHitObjects().objects;
+  EXPECT_EQ(cachedObjects.size(), objects.size());
+  for (size_t i = 0; i < objects.size() && i < cachedObjects.size(); i++) {
+    const auto &x = objects[i], &y = cachedObjects[i];
+    EXPECT(x.pos == y.pos && x.time == y.time && x.endTime == y.endTime &&
+           x.type == y.type && x.newCombo == y.newCombo &&
+           x.comboSkip == y.comboSkip && x.hitSound == y.hitSound &&
+           x.sample.normalSet == y.sample.normalSet &&
+           x.sample.additionSet == y.sample.additionSet &&
+           x.sample.volume == y.sample.volume &&
+           x.sample.index == y.sample.index && x.curveType == y.curveType &&
+           x.slides == y.slides && x.length == y.length &&
+           x.curvePointOffset == y.curvePointOffset &&
+           x.curvePointCount == y.curvePointCount &&
+           x.sliderEdgeOffset == y.sliderEdgeOffset);
+  }
+  const auto& points = map.GetTimingPoints();
+  const auto& cachedPoints = cached->GetTimingPoints();
+  EXPECT_EQ(cachedPoints.size(), points.size());
+  for (size_t i = 0; i < points.size() && i < cachedPoints.size(); i++) {
+    const auto &x = points[i], &y = cachedPoints[i];
+    EXPECT(x.time == y.time && x.beatLength == y.beatLength &&
+           x.meter == y.meter && x.sampleSet == y.sampleSet &&
+           x.sampleIndex == y.sampleIndex && x.volume == y.volume &&
+           x.uninherited == y.uninherited && x.effects == y.effects);
+  }
+}
+
+TEST(BeatmapCacheRejectsInvalidEnums) {
+  test::TempDirectory dir("beatmap_cache_enums");
+  Beatmap map(MAP_PATH);
+  map.WriteCache(dir.path / "map.osuc");
+  std::vector<uint8_t> data;
+  {
+    MappedFile file(dir.path / "map.osuc");
+    data.assign(file.Data(), file.Data() + file.Size());
+  }
+
+  // The first hit object record starts with its position and times.
+  const auto& first = map.GetHitObjects().objects[0];
+  BinaryWriter prefix;
+  prefix.Write(first.pos.x);
+  prefix.Write(first.pos.y);
+  prefix.Write(first.time);
+  prefix.Write(first.endTime);
+  const auto& needle = prefix.GetBuffer();
+  auto record = std::search(data.begin(), data.end(), needle.begin(),
+                            needle.end());
+  EXPECT(record != data.end());
+  if (record == data.end()) return;
+  size_t typeOffset = record - data.begin() + needle.size();
+
+  for (size_t offset : {typeOffset, typeOffset + 1}) {
+    auto corrupt = data;
+    corrupt[offset] = 7;
+    WriteFileAtomic(dir.path / "corrupt.osuc", corrupt.data(), corrupt.size());
+    EXPECT(!Beatmap::ReadCache(dir.path / "corrupt.osuc", MAP_PATH));
+  }
+}
+
+}  // namespace osrp
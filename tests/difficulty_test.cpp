@@ -0,0 +1,48 @@
+#include <fstream>
+#include <string>
+
+#include "beatmap.hpp"
+#include "difficulty.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+// Objects alternating between two spots 600ms apart at CS4, either circles
+// or 90px sliders that start there.
+fs::path WriteJumpMap(const fs::path& dir, bool sliders) {
+  auto path = dir / (sliders ? "sliders.osu" : "circles.osu");
+  std::ofstream file(path);
+  file << "osu file format v14\n\n"
+       << "[General]\nMode: 0\n\n"
+       << "[Difficulty]\nCircleSize:4\nOverallDifficulty:5\n"
+       << "ApproachRate:9\nSliderMultiplier:1\nSliderTickRate:1\n\n"
+       << "[TimingPoints]\n0,500,4,2,0,100,1,0\n\n"
+       << "[HitObjects]\n";
+  for (int i = 0; i < 16; i++) {
+    int x = i % 2 ? 400 : 100, time = 1000 + i * 600;
+    if (sliders) {
+      file << x << ",192," << time << ",2,0,L|" << x << ":282,1,90\n";
+    } else {
+      file << x << ",192," << time << ",1,0\n";
+    }
+  }
+  return path;
+}
+}  // namespace
+
+TEST(SlidersInsideTheFollowCircleAddNoTravel) {
+  test::TempDirectory dir("difficulty_travel");
+  Beatmap sliders(WriteJumpMap(dir.path, true));
+  Beatmap circles(WriteJumpMap(dir.path, false));
+  // The ball stays within 3 radii of the head (about 109px at CS4), so the
+  // lazy cursor never moves even though the scaled length would exceed it.
+  auto sliderAttributes = CalculateDifficulty(sliders);
+  auto circleAttributes = CalculateDifficulty(circles);
+  EXPECT_EQ(sliderAttributes.sliderCount, uint32_t{16});
+  EXPECT(sliderAttributes.aimRating > 0.0);
+  EXPECT_EQ(sliderAttributes.aimRating, circleAttributes.aimRating);
+  EXPECT_EQ(sliderAttributes.speedRating, circleAttributes.speedRating);
+}
+
+}  // namespace osrp
@@ -0,0 +1,79 @@
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+#include "frame_parser.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+FrameArray ParseFrameText(std::string_view text,
+                          std::optional<int32_t>* seed = nullptr) {
+  FrameArray frames;
+  std::optional<int32_t> replaySeed;
+  FrameParser parser(frames, replaySeed);
+  parser.Feed(text);
+  parser.Finish();
+  if (seed) *seed = replaySeed;
+  return frames;
+}
+}  // namespace
+
+TEST(FrameParserAccumulatesDeltas) {
+  std::optional<int32_t> seed;
+  auto frames = ParseFrameText("0|256|-500|0,-1|256|-500|0,16|1.5|2.25|5,"
+                               "-12345|0|0|1234,",
+                               &seed);
+  EXPECT_EQ(frames.size(), size_t{3});
+  EXPECT_EQ(frames[1].time, int64_t{-1});
+  EXPECT_EQ(frames[2].time, int64_t{15});
+  EXPECT_EQ(frames[2].pos.x, 1.5f);
+  EXPECT_EQ(frames[2].keys, uint32_t{5});
+  EXPECT(seed == 1234);
+}
+
+TEST(FormatFramesWritesSeedOnlyIfParsed) {
+  std::optional<int32_t> seed;
+  auto frames = ParseFrameText("0|256|-500|0,16|1.5|2.25|5,", &seed);
+  EXPECT(!seed);
+  EXPECT_EQ(FormatFrames(frames, seed),
+            std::string("0|256|-500|0,16|1.5|2.25|5,"));
+
+  std::optional<int32_t> reparsedSeed;
+  auto text = FormatFrames(frames, 1234);
+  auto reparsed = ParseFrameText(text, &reparsedSeed);
+  EXPECT_EQ(reparsed.size(), frames.size());
+  EXPECT(reparsedSeed == 1234);
+}
+
+TEST(FrameParserSkipsFramesOutOfRange) {
+  // Keys above 16 bits and times beyond int32 are dropped on their own; the
+  // dropped delta still moves the clock.
+  auto frames = ParseFrameText(
+      "10|1|1|65536,10|2|2|1,4294967296|3|3|0,-4294967296|4|4|0,5|5|5|0");
+  EXPECT_EQ(frames.size(), size_t{3});
+  EXPECT_EQ(frames[0].time, int64_t{20});
+  EXPECT_EQ(frames[0].keys, uint32_t{1});
+  EXPECT_EQ(frames[1].time, int64_t{20});
+  EXPECT_EQ(frames[1].pos.x, 4.0f);
+  EXPECT_EQ(frames[2].time, int64_t{25});
+}
+
+TEST(FrameArrayRejectsValuesItCannotStore) {
+  FrameArray frames;
+  Frame frame{glm::vec2(0.0f), 0, 0x10000};
+  bool threw = false;
+  try {
+    frames.push_back(frame);
+  } catch (const std::out_of_range&) {
+    threw = true;
+  }
+  EXPECT(threw);
+  EXPECT(frames.empty());
+  frame.keys = 0xFFFF;
+  frame.time = std::numeric_limits<int32_t>::max();
+  EXPECT(FrameArray::CanStore(frame));
+}
+
+}  // namespace osrp
@@ -0,0 +1,132 @@
+#include <random>
+#include <vector>
+
+#include "beatmap.hpp"
+#include "hit_object_index.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+// Random objects in time order, some off the playfield and every tenth
+// held for up to 5 seconds like a spinner.
+struct RandomObjects {
+  std::vector<int32_t> times;
+  std::vector<double> endTimes;
+  std::vector<float> xs, ys;
+
+  explicit RandomObjects(std::mt19937& rng) {
+    int32_t time = 0;
+    for (int i = 0; i < 5000; i++) {
+      time += rng() % 200;
+      times.push_back(time);
+      endTimes.push_back(time + (rng() % 10 == 0 ? rng() % 5000 : 0));
+      xs.push_back(static_cast<int>(rng() % 700) - 90);
+      ys.push_back(static_cast<int>(rng() % 500) - 60);
+    }
+  }
+
+  bool IsActive(size_t i, double t0, double t1) const {
+    return times[i] <= t1 && endTimes[i] >= t0;
+  }
+  bool IsNear(size_t i, glm::vec2 pos, float radius) const {
+    return glm::distance(glm::vec2(xs[i], ys[i]), pos) <= radius;
+  }
+};
+}  // namespace
+
+TEST(HitObjectIndexQueriesMatchScan) {
+  std::mt19937 rng(3);
+  RandomObjects objects(rng);
+  HitObjectIndex index(objects.times, objects.endTimes, objects.xs,
+                       objects.ys);
+  int32_t lastTime = objects.times.back();
+  size_t mismatches = 0;
+  std::vector<uint32_t> found, expected;
+  for (int query = 0; query < 20000; query++) {
+    glm::vec2 pos(static_cast<int>(rng() % 700) - 90,
+                  static_cast<int>(rng() % 500) - 60);
+    float radius = rng() % 150;
+    double t0 = rng() % lastTime, t1 = t0 + rng() % 800;
+
+    found.clear();
+    expected.clear();
+    index.FindNear(pos, radius, found);
+    for (size_t i = 0; i < index.size(); i++) {
+      if (objects.IsNear(i, pos, radius)) expected.push_back(i);
+    }
+    mismatches += found != expected;
+
+    found.clear();
+    expected.clear();
+    index.FindNear(pos, radius, t0, t1, found);
+    for (size_t i = 0; i < index.size(); i++) {
+      if (objects.IsNear(i, pos, radius) && objects.IsActive(i, t0, t1)) {
+        expected.push_back(i);
+      }
+    }
+    mismatches += found != expected;
+
+    found.clear();
+    expected.clear();
+    index.FindActive(t0, t1, found);
+    for (size_t i = 0; i < index.size(); i++) {
+      if (objects.IsActive(i, t0, t1)) expected.push_back(i);
+    }
+    mismatches += found != expected;
+  }
+  EXPECT_EQ(mismatches, size_t{0});
+}
+
+TEST(HitObjectWindowMatchesScan) {
+  std::mt19937 rng(5);
+  RandomObjects objects(rng);
+  HitObjectIndex index(objects.times, objects.endTimes, objects.xs,
+                       objects.ys);
+  HitObjectWindow window(index, 600.0, 200.0);
+  int32_t lastTime = objects.times.back();
+  size_t mismatches = 0;
+  std::vector<uint32_t> expected;
+  // Forward playback first, then random seeks in both directions.
+  for (int query = 0; query < 20000; query++) {
+    double time = query < 10000 ? query * (lastTime / 10000.0)
+                                : rng() % lastTime;
+    expected.clear();
+    for (size_t i = 0; i < index.size(); i++) {
+      if (objects.IsActive(i, time - 200.0, time + 600.0)) {
+        expected.push_back(i);
+      }
+    }
+    mismatches += window.Seek(time) != expected;
+  }
+  EXPECT_EQ(mismatches, size_t{0});
+}
+
+TEST(HitObjectIndexMatchesScanOnBeatmap) {
+  Beatmap map("res/magma/magma_top_diff.osu");
+  JudgementMap judgement(map, 0);
+  HitObjectIndex index(judgement);
+  EXPECT_EQ(index.size(), judgement.size());
+  size_t mismatches = 0;
+  std::vector<uint32_t> found, expected;
+  for (size_t object = 0; object < judgement.size(); object++) {
+    glm::vec2 pos(judgement.xs[object], judgement.ys[object]);
+    double t0 = judgement.times[object] - 1000.0, t1 = t0 + 2000.0;
+    found.clear();
+    expected.clear();
+    index.FindNear(pos, judgement.circleRadius, t0, t1, found);
+    for (size_t i = 0; i < judgement.size(); i++) {
+      glm::vec2 other(judgement.xs[i], judgement.ys[i]);
+      if (judgement.times[i] <= t1 && judgement.endTimes[i] >= t0 &&
+          glm::distance(other, pos) <= judgement.circleRadius) {
+        expected.push_back(i);
+      }
+    }
+    // The object itself is always found.
+    EXPECT(!found.empty());
+    mismatches += found != expected;
+  }
+  EXPECT_EQ(mismatches, size_t{0});
+}
+
+}  // namespace osrp
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "io.hpp"
+#include "test.hpp"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace osrp {
+
+#ifndef _WIN32
+TEST(WriteFileAtomicFromTwoProcesses) {
+  test::TempDirectory dir("io_atomic_processes");
+  auto path = dir.path / "shared.bin";
+  // Large enough that the writes overlap, different content per process.
+  constexpr size_t SIZE = 1 << 20;
+  constexpr int WRITES = 50;
+
+  auto writeRepeatedly = [&](uint8_t value) {
+    std::vector<uint8_t> data(SIZE, value);
+    int failures = 0;
+    for (int i = 0; i < WRITES; i++) {
+      try {
+        WriteFileAtomic(path, data.data(), data.size());
+      } catch (const std::exception&) {
+        failures++;
+      }
+    }
+    return failures;
+  };
+
+  // Both main threads, which may well share a thread id hash.
+  pid_t child = fork();
+  if (child == 0) _exit(writeRepeatedly('c'));
+  EXPECT_EQ(writeRepeatedly('p'), 0);
+  int status = 0;
+  EXPECT_EQ(waitpid(child, &status, 0), child);
+  EXPECT(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+
+  // Whichever write came last, complete and not mixed with the other.
+  MappedFile file(path);
+  EXPECT_EQ(file.Size(), SIZE);
+  if (file.Size() > 0) {
+    uint8_t first = file.Data()[0];
+    EXPECT(first == 'c' || first == 'p');
+    EXPECT(std::all_of(file.Data(), file.Data() + file.Size(),
+                       [&](uint8_t byte) { return byte == first; }));
+  }
+  size_t files = 0;
+  for (const auto& entry : fs::directory_iterator(dir.path)) {
+    (void)entry;
+    files++;
+  }
+  EXPECT_EQ(files, size_t{1});
+}
+#endif
+
+}  // namespace osrp
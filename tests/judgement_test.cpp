@@ -0,0 +1,85 @@
+#include <fstream>
+#include <string>
+
+#include "beatmap.hpp"
+#include "judgement.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+// One 400px slider at 2x slider velocity (200px per beat of 500ms).
+fs::path WriteSliderMap(const fs::path& dir, int formatVersion) {
+  auto path = dir / ("v" + std::to_string(formatVersion) + ".osu");
+  std::ofstream(path) << "osu file format v" << formatVersion << "\n\n"
+                      << "[General]\nMode: 0\n\n"
+                      << "[Difficulty]\nCircleSize:4\nOverallDifficulty:5\n"
+                      << "SliderMultiplier:1\nSliderTickRate:1\n\n"
+                      << "[TimingPoints]\n0,500,4,2,0,100,1,0\n"
+                      << "0,-50,4,2,0,100,0,0\n\n"
+                      << "[HitObjects]\n"
+                      << "0,192,1000,2,0,L|400:192,1,400\n";
+  return path;
+}
+
+// One slider at 1000ms from (0, 192) after the given timing point.
+fs::path WriteDegenerateSliderMap(const fs::path& dir, const std::string& name,
+                                  const std::string& timingPoint,
+                                  const std::string& length) {
+  auto path = dir / (name + ".osu");
+  std::ofstream(path) << "osu file format v14\n\n"
+                      << "[General]\nMode: 0\n\n"
+                      << "[Difficulty]\nCircleSize:4\nOverallDifficulty:5\n"
+                      << "SliderMultiplier:1\nSliderTickRate:1\n\n"
+                      << "[TimingPoints]\n" << timingPoint << "\n\n"
+                      << "[HitObjects]\n"
+                      << "0,192,1000,2,0,L|400:192,2," << length << "\n";
+  return path;
+}
+
+size_t CountTicks(const JudgementMap& judgement) {
+  size_t ticks = 0;
+  for (const auto& checkpoint : judgement.checkpoints) {
+    if (checkpoint.type == JudgementMap::CheckpointType::TICK) ticks++;
+  }
+  return ticks;
+}
+}  // namespace
+
+TEST(SliderTicksFollowTheLegacyDistanceBeforeV8) {
+  test::TempDirectory dir("judgement_ticks");
+  Beatmap modern(WriteSliderMap(dir.path, 14));
+  Beatmap legacy(WriteSliderMap(dir.path, 7));
+  JudgementMap modernJudgement(modern, 0), legacyJudgement(legacy, 0);
+
+  // 200px apart from v8 on, 100px before: the velocity is ignored.
+  EXPECT_EQ(CountTicks(modernJudgement), size_t{1});
+  EXPECT_EQ(CountTicks(legacyJudgement), size_t{3});
+  // The slider lasts 1000ms either way.
+  EXPECT_EQ(modernJudgement.endTimes[0], 2000.0);
+  EXPECT_EQ(legacyJudgement.endTimes[0], 2000.0);
+  EXPECT_EQ(legacyJudgement.maxCombo, modernJudgement.maxCombo + 2);
+}
+
+TEST(DegenerateSlidersOnlyHaveHeadAndTail) {
+  test::TempDirectory dir("judgement_degenerate");
+  fs::path paths[] = {
+      WriteDegenerateSliderMap(dir.path, "zero_length", "0,500,4,2,0,100,1,0",
+                               "0"),
+      WriteDegenerateSliderMap(dir.path, "zero_beat", "0,0,4,2,0,100,1,0",
+                               "400")};
+  for (const auto& path : paths) {
+    Beatmap map(path);
+    JudgementMap judgement(map, 0);
+    EXPECT_EQ(judgement.endTimes[0], 1000.0);
+    EXPECT_EQ(judgement.maxCombo, uint32_t{2});
+    EXPECT_EQ(judgement.checkpoints.size(), size_t{1});
+    if (judgement.checkpoints.empty()) continue;
+    const auto& tail = judgement.checkpoints[0];
+    EXPECT(tail.type == JudgementMap::CheckpointType::TAIL);
+    EXPECT_EQ(tail.time, 1000.0);
+    EXPECT(tail.pos == glm::vec2(judgement.xs[0], judgement.ys[0]));
+  }
+}
+
+}  // namespace osrp
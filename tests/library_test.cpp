@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <fstream>
+
+#include "beatmap.hpp"
+#include "library.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+const fs::path MAPS_DIR = "res/magma";
+
+// Lays out the sample maps as a songs directory: two sets, one with a nested
+// folder, and a stray map at the top level.
+std::vector<fs::path> MakeSongsDirectory(const fs::path& songs) {
+  std::vector<fs::path> maps;
+  for (const auto& entry : fs::directory_iterator(MAPS_DIR)) {
+    if (entry.path().extension() == ".osu") maps.push_back(entry.path());
+  }
+  std::sort(maps.begin(), maps.end());
+  fs::create_directories(songs / "1 Set A" / "nested");
+  fs::create_directories(songs / "2 Set B");
+  for (size_t i = 0; i < maps.size(); i++) {
+    auto folder = i % 3 == 0 ? songs / "1 Set A"
+                  : i % 3 == 1 ? songs / "1 Set A" / "nested"
+                               : songs / "2 Set B";
+    fs::copy_file(maps[i], folder / maps[i].filename());
+  }
+  fs::copy_file(maps[0], songs / "stray.osu");
+  std::ofstream(songs / "2 Set B" / "broken.osu") << "[HitObjects]\n1,2\n";
+  return maps;
+}
+}  // namespace
+
+TEST(LibraryIndexMatchesFullParse) {
+  test::TempDirectory dir("library");
+  auto songs = dir.path / "Songs";
+  auto maps = MakeSongsDirectory(songs);
+  ThreadPool pool(4);
+
+  LibraryScanStats stats;
+  auto index = ScanLibrary(songs, dir.path / "library.idx", pool, &stats);
+  EXPECT_EQ(stats.files, maps.size() + 2);
+  EXPECT_EQ(stats.parsed, stats.files);
+  EXPECT_EQ(stats.failures, size_t{1});
+  EXPECT(stats.written);
+  EXPECT_EQ(index.size(), stats.files);
+
+  size_t checked = 0;
+  for (const auto& record : index) {
+    auto path = index.GetPath(record);
+    EXPECT(fs::exists(path));
+    MappedFile file(path);
+    EXPECT(record.md5 == ComputeMD5(file.Data(), file.Size()));
+    EXPECT(index.Find(record.md5) != nullptr);
+    checked++;
+    // Only md5 and path are kept for files that failed to parse.
+    if (record.invalid) continue;
+
+    Beatmap map(path);
+    const auto& objects = map.GetHitObjects().objects;
+    int32_t length = 0;
+    for (const auto& object : objects) {
+      length = std::max(length, object.endTime);
+    }
+    EXPECT_EQ(record.hitObjectCount, static_cast<uint32_t>(objects.size()));
+    EXPECT_EQ(record.length, length);
+    auto title = map.GetProperty(KeyValueSection::METADATA, "Title");
+    EXPECT_EQ(index.GetString(record.title),
+              title.HasValue() ? title.Value() : std::string_view());
+  }
+  EXPECT_EQ(checked, index.size());
+
+  // Unchanged files are reused and the index is left alone.
+  index = ScanLibrary(songs, dir.path / "library.idx", pool, &stats);
+  EXPECT_EQ(stats.reused, stats.files);
+  EXPECT(!stats.written);
+
+  std::ofstream(songs / "2 Set B" / "broken.osu", std::ios::app) << "\n";
+  index = ScanLibrary(songs, dir.path / "library.idx", pool, &stats);
+  EXPECT_EQ(stats.parsed, size_t{1});
+  EXPECT(stats.written);
+}
+
+}  // namespace osrp
@@ -0,0 +1,65 @@
+#include <random>
+#include <string>
+
+#include "lzma_decoder.hpp"
+#include "lzma_encoder.hpp"
+#include "replay.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+std::string Decompress(const std::vector<uint8_t>& compressed) {
+  std::string text;
+  LzmaDecoder::ForThread().Decode(
+      compressed.data(), compressed.size(),
+      [&](std::string_view chunk) { text.append(chunk); });
+  return text;
+}
+}  // namespace
+
+TEST(LzmaRoundTrip) {
+  std::mt19937 rng(7);
+  std::string random(100000, '\0');
+  for (auto& c : random) c = static_cast<char>(rng());
+  std::string repetitive;
+  for (int i = 0; i < 20000; i++) repetitive += std::to_string(i % 97) + "|";
+
+  std::string inputs[] = {"",
+                          "a",
+                          "abcabcabcabcabcabc",
+                          std::string(70000, 'x'),
+                          random,
+                          repetitive,
+                          ReadReplayFrameText("res/magma/wc_replay.osr")};
+  for (const auto& input : inputs) {
+    for (int level : {0, 1, 5, 9}) {
+      auto compressed = CompressLZMA(input, level);
+      EXPECT(Decompress(compressed) == input);
+    }
+  }
+}
+
+TEST(LzmaCompressesReplayFrames) {
+  auto text = ReadReplayFrameText("res/magma/wc_replay.osr");
+  auto fast = CompressLZMA(text, 0).size();
+  auto best = CompressLZMA(text, 9).size();
+  EXPECT(fast < text.size() / 2);
+  EXPECT(best < fast);
+}
+
+TEST(LzmaDecodesStreamsWithHugeDictionaries) {
+  std::string text = ReadReplayFrameText("res/magma/wc_replay.osr");
+  auto compressed = CompressLZMA(text);
+  for (int i = 1; i < LZMA_PROPS_SIZE; i++) compressed[i] = 0xFF;
+  EXPECT(Decompress(compressed) == text);
+
+  EXPECT_EQ(CapDictionarySize(0xFFFFFFFF, 100), UInt32{64 * 1024});
+  EXPECT_EQ(CapDictionarySize(0xFFFFFFFF, 100000), UInt32{128 * 1024});
+  EXPECT_EQ(CapDictionarySize(0xFFFFFFFF, 0x80000001), UInt32{0xFFFFFFFF});
+  EXPECT_EQ(CapDictionarySize(0xFFFFFFFF, 0xFFFFFFFE), UInt32{0xFFFFFFFF});
+  EXPECT_EQ(CapDictionarySize(0x90000000, 0x80000001), UInt32{0x90000000});
+  EXPECT_EQ(CapDictionarySize(1 << 16, uint64_t{1} << 40), UInt32{1 << 16});
+}
+
+}  // namespace osrp
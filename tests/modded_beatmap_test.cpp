@@ -0,0 +1,103 @@
+#include <cmath>
+#include <fstream>
+
+#include "beatmap.hpp"
+#include "modded_beatmap.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+constexpr int32_t HR = static_cast<int32_t>(Mod::HARD_ROCK);
+constexpr int32_t EZ = static_cast<int32_t>(Mod::EASY);
+
+// Two circles too far apart to stack.
+fs::path WriteDifficultyMap(const fs::path& dir) {
+  auto path = dir / "difficulty.osu";
+  std::ofstream(path) << "osu file format v14\n\n"
+                      << "[General]\nMode: 0\n\n"
+                      << "[Difficulty]\nHPDrainRate:6\nCircleSize:4\n"
+                      << "OverallDifficulty:8\nApproachRate:9\n"
+                      << "SliderMultiplier:1\nSliderTickRate:1\n\n"
+                      << "[TimingPoints]\n0,500,4,2,0,100,1,0\n\n"
+                      << "[HitObjects]\n"
+                      << "100,100,1000,1,0\n200,300,5000,1,0\n";
+  return path;
+}
+
+bool Near(double a, double b) { return std::abs(a - b) < 1e-9; }
+}  // namespace
+
+TEST(ModdedBeatmapDifficultyMods) {
+  test::TempDirectory dir("modded_difficulty");
+  Beatmap map(WriteDifficultyMap(dir.path));
+
+  ModdedBeatmap nomod(map, 0);
+  EXPECT(Near(nomod.circleSize, 4.0));
+  EXPECT(Near(nomod.approachRate, 9.0));
+  EXPECT(Near(nomod.overallDifficulty, 8.0));
+  EXPECT(Near(nomod.hpDrainRate, 6.0));
+  EXPECT(!nomod.flipped);
+
+  // x1.3 for CS, x1.4 for the rest, at most 10.
+  ModdedBeatmap hardRock(map, HR);
+  EXPECT(Near(hardRock.circleSize, 5.2));
+  EXPECT(Near(hardRock.approachRate, 10.0));
+  EXPECT(Near(hardRock.overallDifficulty, 10.0));
+  EXPECT(Near(hardRock.hpDrainRate, 8.4));
+  EXPECT(hardRock.circleRadius < nomod.circleRadius);
+  EXPECT(hardRock.preempt < nomod.preempt);
+
+  ModdedBeatmap easy(map, EZ);
+  EXPECT(Near(easy.circleSize, 2.0));
+  EXPECT(Near(easy.approachRate, 4.5));
+  EXPECT(Near(easy.overallDifficulty, 4.0));
+  EXPECT(Near(easy.hpDrainRate, 3.0));
+  EXPECT(!easy.flipped);
+}
+
+TEST(ModdedBeatmapHardRockFlipsY) {
+  test::TempDirectory dir("modded_flip");
+  Beatmap map(WriteDifficultyMap(dir.path));
+  ModdedBeatmap nomod(map, 0), hardRock(map, HR);
+  EXPECT(hardRock.flipped);
+  EXPECT(nomod.positions[0] == glm::vec2(100.0f, 100.0f));
+  EXPECT(nomod.positions[1] == glm::vec2(200.0f, 300.0f));
+  EXPECT(hardRock.positions[0] == glm::vec2(100.0f, 284.0f));
+  EXPECT(hardRock.positions[1] == glm::vec2(200.0f, 84.0f));
+}
+
+TEST(ModdedBeatmapClockRate) {
+  int32_t dt = static_cast<int32_t>(Mod::DOUBLE_TIME);
+  int32_t nc = static_cast<int32_t>(Mod::NIGHTCORE);
+  int32_t ht = static_cast<int32_t>(Mod::HALF_TIME);
+  EXPECT_EQ(GetClockRate(0), 1.0);
+  EXPECT_EQ(GetClockRate(dt), 1.5);
+  // osu! sets the DT bit along with NC.
+  EXPECT_EQ(GetClockRate(nc), 1.5);
+  EXPECT_EQ(GetClockRate(dt | nc), 1.5);
+  EXPECT_EQ(GetClockRate(ht), 0.75);
+  EXPECT_EQ(GetClockRate(HR | static_cast<int32_t>(Mod::HIDDEN)), 1.0);
+
+  test::TempDirectory dir("modded_clock");
+  Beatmap map(WriteDifficultyMap(dir.path));
+  EXPECT_EQ(map.GetModded(dt | nc).clockRate, 1.5);
+  EXPECT_EQ(map.GetModded(ht).clockRate, 0.75);
+}
+
+TEST(GetModdedSharesMasksWithTheSameDifficultyMods) {
+  test::TempDirectory dir("modded_shared");
+  Beatmap map(WriteDifficultyMap(dir.path));
+  int32_t hidden = static_cast<int32_t>(Mod::HIDDEN);
+  int32_t noFail = static_cast<int32_t>(Mod::NO_FAIL);
+
+  const auto& hardRock = map.GetModded(HR);
+  EXPECT_EQ(hardRock.mods, HR);
+  EXPECT(&map.GetModded(HR | hidden) == &hardRock);
+  EXPECT(&map.GetModded(HR | hidden | noFail) == &hardRock);
+  EXPECT(&map.GetModded(hidden) == &map.GetModded(0));
+  EXPECT(&map.GetModded(EZ) != &hardRock);
+  EXPECT(&map.GetModded(HR | EZ) != &hardRock);
+}
+
+}  // namespace osrp
@@ -0,0 +1,72 @@
+#include <cmath>
+#include <vector>
+
+#include "beatmap.hpp"
+#include "performance.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+const fs::path REPLAY_PATH = "res/magma/wc_replay.osr";
+const fs::path BEATMAP_PATH = "res/magma/magma_top_diff.osu";
+
+bool Near(double a, double b) { return std::abs(a - b) < 1e-4; }
+}  // namespace
+
+TEST(PerformanceOfWcReplay) {
+  ReplayHeader header(REPLAY_PATH, false);
+  EXPECT_EQ(header.mods, 88);  // HD HR DT
+  ScoreStatistics score(header);
+  EXPECT_EQ(score.count300, uint32_t{308});
+  EXPECT_EQ(score.count100, uint32_t{8});
+  EXPECT_EQ(score.countMiss, uint32_t{0});
+  EXPECT_EQ(score.maxCombo, uint32_t{427});
+
+  PerformanceMap map(CalculateDifficulty(Beatmap(BEATMAP_PATH), header.mods),
+                     header.mods);
+  auto pp = map.Evaluate(score);
+  EXPECT(Near(pp.total, 1139.1216948938081));
+  EXPECT(Near(pp.aim, 774.65770496641983));
+  EXPECT(Near(pp.speed, 206.00405181871648));
+  EXPECT(Near(pp.accuracy, 109.49642639552738));
+
+  // The batch gives the same numbers.
+  ThreadPool pool(2);
+  auto batch = CalculatePerformance({map}, {{0, score}}, pool);
+  EXPECT_EQ(batch.size(), size_t{1});
+  EXPECT_EQ(batch[0], pp.total);
+}
+
+TEST(PerformanceMissEdgeCases) {
+  ReplayHeader header(REPLAY_PATH, false);
+  ScoreStatistics score(header);
+  PerformanceMap map(CalculateDifficulty(Beatmap(BEATMAP_PATH), header.mods),
+                     header.mods);
+  double played = map.Evaluate(score).total;
+
+  // With no misses, an SS at full combo is the most a score can get.
+  ScoreStatistics perfect = score;
+  perfect.count300 = score.GetTotalHits();
+  perfect.count100 = 0;
+  EXPECT(map.Evaluate(perfect).total > played);
+
+  ScoreStatistics oneMiss = score;
+  oneMiss.count300--;
+  oneMiss.countMiss = 1;
+  EXPECT(map.Evaluate(oneMiss).total < played);
+
+  ScoreStatistics allMisses;
+  allMisses.countMiss = score.GetTotalHits();
+  auto missed = map.Evaluate(allMisses);
+  EXPECT_EQ(missed.total, 0.0);
+  EXPECT_EQ(missed.aim, 0.0);
+  EXPECT_EQ(missed.speed, 0.0);
+  EXPECT_EQ(missed.accuracy, 0.0);
+
+  // No hits at all must not divide by zero.
+  auto empty = map.Evaluate(ScoreStatistics());
+  EXPECT_EQ(empty.total, 0.0);
+}
+
+}  // namespace osrp
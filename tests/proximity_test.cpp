@@ -0,0 +1,42 @@
+#include <random>
+#include <vector>
+
+#include "proximity.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+TEST(FindPointsInRadiusMatchesBruteForce) {
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<float> coordinate(-64.0f, 576.0f);
+  // Odd counts exercise the scalar tail after the vector loop.
+  for (size_t count : {0, 1, 7, 8, 9, 1001}) {
+    std::vector<float> xs(count), ys(count);
+    for (size_t i = 0; i < count; i++) {
+      xs[i] = coordinate(rng);
+      ys[i] = coordinate(rng);
+    }
+    // A point exactly on the radius counts.
+    if (count > 3) {
+      xs[3] = 256.0f + 30.0f;
+      ys[3] = 192.0f;
+    }
+    std::vector<uint32_t> indices(count);
+    for (int query = 0; query < 50; query++) {
+      glm::vec2 pos = query == 0 ? glm::vec2(256.0f, 192.0f)
+                                 : glm::vec2(coordinate(rng), coordinate(rng));
+      float radius = query == 0 ? 30.0f : 10.0f + query * 3.0f;
+      std::vector<uint32_t> expected;
+      for (size_t i = 0; i < count; i++) {
+        float dx = xs[i] - pos.x, dy = ys[i] - pos.y;
+        if (dx * dx + dy * dy <= radius * radius) expected.push_back(i);
+      }
+      size_t found = FindPointsInRadius(xs.data(), ys.data(), count, pos,
+                                        radius, indices.data());
+      EXPECT(std::vector<uint32_t>(indices.begin(),
+                                   indices.begin() + found) == expected);
+    }
+  }
+}
+
+}  // namespace osrp
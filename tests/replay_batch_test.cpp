@@ -0,0 +1,50 @@
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "beatmap.hpp"
+#include "judgement.hpp"
+#include "replay.hpp"
+#include "replay_batch.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+TEST(JudgeReplaysMatchesSerialJudging) {
+  test::TempDirectory dir("replay_batch");
+  Beatmap map("res/magma/magma_top_diff.osu");
+  Replay replay("res/magma/wc_replay.osr");
+  const int32_t modSets[] = {0, static_cast<int32_t>(Mod::HARD_ROCK),
+                             static_cast<int32_t>(Mod::EASY),
+                             static_cast<int32_t>(Mod::DOUBLE_TIME)};
+
+  // Several replays per mod combination, interleaved, so that workers race
+  // for the same JudgementMap and build different ones concurrently.
+  std::vector<fs::path> paths;
+  for (int copy = 0; copy < 4; copy++) {
+    for (size_t m = 0; m < std::size(modSets); m++) {
+      replay.mods = modSets[m];
+      paths.push_back(dir.path / (std::to_string(copy) + "_" +
+                                  std::to_string(m) + ".osr"));
+      replay.Write(paths.back(), 0);
+    }
+  }
+
+  ThreadPool pool(4);
+  JudgementBatchStats stats;
+  auto results = JudgeReplays(map, paths, pool, &stats);
+  EXPECT_EQ(results.size(), paths.size());
+  EXPECT_EQ(stats.failures, size_t{0});
+  for (size_t i = 0; i < results.size(); i++) {
+    int32_t mods = modSets[i % std::size(modSets)];
+    auto expected = Judge(JudgementMap(map, mods), replay.replayData);
+    EXPECT(results[i].judgement.has_value());
+    if (!results[i].judgement) continue;
+    const auto& actual = *results[i].judgement;
+    EXPECT(actual.results == expected.results);
+    EXPECT_EQ(actual.score, expected.score);
+    EXPECT_EQ(actual.maxCombo, expected.maxCombo);
+  }
+}
+
+}  // namespace osrp
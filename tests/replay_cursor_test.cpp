@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <vector>
+
+#include "replay.hpp"
+#include "replay_cursor.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+const fs::path REPLAY_PATH = "res/magma/wc_replay.osr";
+
+struct Expected {
+  size_t index;
+  bool started;
+};
+
+// Seek by scanning every frame: the last one at or before time, skipping the
+// frames osu! writes ahead of the lead-in, which are later than the next one.
+Expected LinearSeek(const std::vector<int32_t>& times, double time) {
+  size_t first = 0;
+  while (first + 1 < times.size() && times[first + 1] < times[first]) first++;
+  Expected expected{0, false};
+  for (size_t i = first; i < times.size() && times[i] <= time; i++) {
+    expected = {i, true};
+  }
+  return expected;
+}
+
+void ExpectSeek(ReplayCursor& cursor, const std::vector<int32_t>& times,
+                double time) {
+  auto expected = LinearSeek(times, time);
+  EXPECT_EQ(cursor.Seek(time), expected.index);
+  EXPECT_EQ(cursor.GetIndex(), expected.index);
+  EXPECT_EQ(cursor.IsStarted(), expected.started);
+}
+}  // namespace
+
+TEST(ReplayCursorSeeksLikeALinearScan) {
+  Replay replay(REPLAY_PATH);
+  const auto& times = replay.replayData.GetTimes();
+  EXPECT(times.size() > 4 * ReplayCursor::INDEX_STRIDE);
+  ReplayCursor cursor(replay.replayData);
+
+  // Every frame time and the gaps around it, forward then backward.
+  std::vector<double> seekTimes;
+  for (int32_t time : times) {
+    seekTimes.insert(seekTimes.end(), {time - 0.5, double(time), time + 0.5});
+  }
+  std::sort(seekTimes.begin(), seekTimes.end());
+  for (double time : seekTimes) ExpectSeek(cursor, times, time);
+  for (auto it = seekTimes.rbegin(); it != seekTimes.rend(); ++it) {
+    ExpectSeek(cursor, times, *it);
+  }
+
+  // Jumps across sparse index blocks in both directions, and past the ends.
+  for (double time : {40000.0, 1000.0, 76943.0, 1e9, -1e9, 20000.0, 19000.0,
+                      60000.0, 5.0}) {
+    ExpectSeek(cursor, times, time);
+  }
+}
+
+TEST(ReplayCursorLeadIn) {
+  Replay replay(REPLAY_PATH);
+  const auto& times = replay.replayData.GetTimes();
+  // osu! writes frames at 0 and -1 before the lead-in ones.
+  EXPECT_EQ(times[0], 0);
+  EXPECT_EQ(times[1], -1);
+  EXPECT(times[2] < -1);
+  ReplayCursor cursor(replay.replayData);
+
+  ExpectSeek(cursor, times, times[2] - 1.0);
+  ExpectSeek(cursor, times, times[2]);
+  ExpectSeek(cursor, times, -1.0);
+  ExpectSeek(cursor, times, 0.0);
+  // Back into the lead-in after playing past its end.
+  ExpectSeek(cursor, times, 500.0);
+  ExpectSeek(cursor, times, -2.0);
+  ExpectSeek(cursor, times, times[2] - 1.0);
+  EXPECT(cursor.GetPosition(times[2] - 1.0) ==
+         replay.replayData.GetPosition(0));
+}
+
+TEST(ReplayCursorFollowsSpeedChanges) {
+  Replay replay(REPLAY_PATH);
+  const auto& times = replay.replayData.GetTimes();
+  ReplayCursor cursor(replay.replayData);
+
+  // Playback at 60 fps, as the player steps through speeds: slow ones move
+  // less than a frame per update, fast ones skip past the linear steps.
+  double time = times[2] - 100.0;
+  for (double speed : {1.0, 0.25, 1.5, 8.0, 40.0, 0.75}) {
+    for (int update = 0; update < 120; update++) {
+      time += 1000.0 / 60.0 * speed;
+      ExpectSeek(cursor, times, time);
+    }
+  }
+}
+
+}  // namespace osrp
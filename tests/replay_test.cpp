@@ -0,0 +1,74 @@
+#include <string>
+
+#include "replay.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+const fs::path REPLAY_PATH = "res/magma/wc_replay.osr";
+}  // namespace
+
+TEST(ReplayEncodeRoundTrip) {
+  test::TempDirectory dir("replay_encode");
+  Replay replay(REPLAY_PATH);
+  EXPECT(replay.replaySeed.has_value());
+  for (int level : {0, 6, 9}) {
+    replay.Write(dir.path / "replay.osr", level);
+    Replay decoded(dir.path / "replay.osr");
+    EXPECT_EQ(decoded.replayMd5, replay.replayMd5);
+    EXPECT(decoded.replaySeed == replay.replaySeed);
+    EXPECT(decoded.replayData.GetTimes() == replay.replayData.GetTimes());
+    EXPECT(decoded.replayData.GetXs() == replay.replayData.GetXs());
+    EXPECT(decoded.replayData.GetYs() == replay.replayData.GetYs());
+    EXPECT(decoded.replayData.GetKeys() == replay.replayData.GetKeys());
+    EXPECT_EQ(decoded.scoreID, replay.scoreID);
+  }
+
+  // Replays without a seed frame must not gain one when rewritten.
+  replay.replaySeed.reset();
+  replay.Write(dir.path / "replay.osr");
+  auto text = ReadReplayFrameText(dir.path / "replay.osr");
+  EXPECT(text.find("-12345|") == std::string::npos);
+  EXPECT(!Replay(dir.path / "replay.osr").replaySeed);
+}
+
+TEST(ReplayReencodeAtLevel9DoesNotGrow) {
+  // The archive's replays must not get bigger when recompressed.
+  auto data = Replay(REPLAY_PATH).Encode(9);
+  EXPECT(data.size() <= fs::file_size(REPLAY_PATH));
+}
+
+TEST(ReplayCacheRoundTrip) {
+  test::TempDirectory dir("replay_cache");
+  bool hit = true;
+  auto parsed = LoadReplayCached(REPLAY_PATH, dir.path / "cache", &hit);
+  EXPECT(!hit);
+  auto cached = LoadReplayCached(REPLAY_PATH, dir.path / "cache", &hit);
+  EXPECT(hit);
+  EXPECT_EQ(cached.replayMd5, parsed.replayMd5);
+  EXPECT_EQ(cached.replayData.size(), parsed.replayData.size());
+  EXPECT(cached.replayData.GetTimes() == parsed.replayData.GetTimes());
+  EXPECT(cached.replaySeed == parsed.replaySeed);
+}
+
+TEST(ReplayCacheIgnoresMalformedReplayMd5) {
+  test::TempDirectory dir("replay_cache_md5");
+  Replay replay(REPLAY_PATH);
+  std::string badDigests[] = {"../escaped", (dir.path / "absolute").string(),
+                              std::string(32, 'z')};
+  for (const auto& md5 : badDigests) {
+    replay.replayMd5 = md5;
+    replay.Write(dir.path / "replay.osr");
+    bool hit = true;
+    auto loaded = LoadReplayCached(dir.path / "replay.osr",
+                                   dir.path / "cache", &hit);
+    EXPECT(!hit);
+    EXPECT_EQ(loaded.replayMd5, md5);
+    EXPECT(!fs::exists(dir.path / "cache"));
+    EXPECT(!fs::exists(dir.path / "escaped.osrc"));
+    EXPECT(!fs::exists(dir.path / "absolute.osrc"));
+  }
+}
+
+}  // namespace osrp
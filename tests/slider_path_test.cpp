@@ -0,0 +1,71 @@
+#include <cmath>
+#include <string_view>
+
+#include "slider_path.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+constexpr float PI = 3.14159265f;
+
+// Paths of a single [HitObjects] line.
+SliderPaths ParseSlider(std::string_view line, HitObjectList& hitObjects) {
+  EXPECT(hitObjects.Parse(line).HasValue());
+  return SliderPaths(hitObjects);
+}
+
+bool Near(glm::vec2 a, glm::vec2 b) { return glm::distance(a, b) < 0.5f; }
+}  // namespace
+
+TEST(SliderPathLinearLength) {
+  HitObjectList hitObjects;
+  auto paths = ParseSlider("0,0,1000,2,0,L|100:0|100:100,1,150", hitObjects);
+  const auto& path = paths.GetPath(0);
+  EXPECT_EQ(path.length, 150.0f);
+  EXPECT(path.spacing <= SliderPaths::SAMPLE_SPACING);
+  EXPECT(Near(paths.GetPosition(0, 0.5f), {75.0f, 0.0f}));
+  EXPECT(Near(paths.GetPosition(0, 1.0f), {100.0f, 50.0f}));
+}
+
+TEST(SliderPathPerfectCircleLength) {
+  // Half a circle of radius 100 around (200, 200), measured from the curve.
+  HitObjectList hitObjects;
+  auto paths =
+      ParseSlider("100,200,1000,2,0,P|200:100|300:200,1,0", hitObjects);
+  EXPECT(std::abs(paths.GetPath(0).length - 100.0f * PI) < 0.5f);
+  EXPECT(Near(paths.GetPosition(0, 0.5f), {200.0f, 100.0f}));
+  EXPECT(Near(paths.GetEndPosition(0), {300.0f, 200.0f}));
+}
+
+TEST(SliderPathBezierLength) {
+  // (200t, 200t(1 - t)), 100 * (sqrt(2) + asinh(1)) long.
+  HitObjectList hitObjects;
+  auto paths = ParseSlider("0,0,1000,2,0,B|100:100|200:0,1,0", hitObjects);
+  float expected = 100.0f * (std::sqrt(2.0f) + std::asinh(1.0f));
+  EXPECT(std::abs(paths.GetPath(0).length - expected) < 0.5f);
+  EXPECT(Near(paths.GetPosition(0, 0.5f), {100.0f, 50.0f}));
+}
+
+TEST(SliderPathCollinearCircleIsALine) {
+  HitObjectList hitObjects;
+  auto paths = ParseSlider("0,0,1000,2,0,P|50:0|100:0,1,0", hitObjects);
+  EXPECT(std::abs(paths.GetPath(0).length - 100.0f) < 0.01f);
+  EXPECT(Near(paths.GetPosition(0, 0.25f), {25.0f, 0.0f}));
+  EXPECT(Near(paths.GetEndPosition(0), {100.0f, 0.0f}));
+}
+
+TEST(SliderPathLengthIsBounded) {
+  HitObjectList hitObjects;
+  auto paths = ParseSlider("0,0,1000,2,0,L|100:0,1,1e30", hitObjects);
+  EXPECT_EQ(hitObjects.objects[0].length, HitObjectList::MAX_SLIDER_LENGTH);
+  EXPECT_EQ(paths.GetPath(0).length, HitObjectList::MAX_SLIDER_LENGTH);
+  EXPECT(paths.GetPoints().size() <=
+         HitObjectList::MAX_SLIDER_LENGTH / SliderPaths::SAMPLE_SPACING + 1);
+
+  // Without a length of its own, a huge curve is cut short as well.
+  auto huge = ParseSlider("0,0,1000,2,0,L|1e30:0,1,0", hitObjects);
+  EXPECT_EQ(huge.GetPath(1).length, HitObjectList::MAX_SLIDER_LENGTH);
+}
+
+}  // namespace osrp
@@ -0,0 +1,71 @@
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "beatmap.hpp"
+#include "modded_beatmap.hpp"
+#include "stacking.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+// Three circles 100ms apart on one spot, then a slider that repeats back to
+// its head and a circle on that head 200ms after it ends.
+fs::path WriteStackMap(const fs::path& dir, int formatVersion) {
+  auto path = dir / ("v" + std::to_string(formatVersion) + ".osu");
+  std::ofstream(path) << "osu file format v" << formatVersion << "\n\n"
+                      << "[General]\nMode: 0\nStackLeniency: 0.7\n\n"
+                      << "[Difficulty]\nCircleSize:4\nOverallDifficulty:5\n"
+                      << "ApproachRate:9\nSliderMultiplier:1\n"
+                      << "SliderTickRate:1\n\n"
+                      << "[TimingPoints]\n0,500,4,2,0,100,1,0\n\n"
+                      << "[HitObjects]\n"
+                      << "100,100,1000,1,0\n100,100,1100,1,0\n"
+                      << "100,100,1200,1,0\n"
+                      << "300,100,3000,2,0,L|400:100,2,100\n"
+                      << "300,100,4200,1,0\n";
+  return path;
+}
+}  // namespace
+
+TEST(StackHeightsOfV14Map) {
+  test::TempDirectory dir("stacking_v14");
+  Beatmap map(WriteStackMap(dir.path, 14));
+  ModdedBeatmap modded(map, 0);
+  // The circle on the slider's end is pushed down and right.
+  std::vector<int32_t> expected{2, 1, 0, 0, -1};
+  EXPECT(modded.stackHeights == expected);
+  EXPECT(modded.positions[0] ==
+         glm::vec2(100.0f) + GetStackOffset(2, modded.circleRadius));
+  EXPECT(modded.positions[4] ==
+         glm::vec2(300.0f, 100.0f) + GetStackOffset(-1, modded.circleRadius));
+}
+
+TEST(StackHeightsOfV5Map) {
+  test::TempDirectory dir("stacking_v5");
+  Beatmap map(WriteStackMap(dir.path, 5));
+  ModdedBeatmap modded(map, 0);
+  // The old algorithm only looks at the end of the first slide, so the
+  // circle back on the head lifts the slider instead.
+  std::vector<int32_t> expected{2, 1, 0, 1, 0};
+  EXPECT(modded.stackHeights == expected);
+  EXPECT(modded.positions[3] ==
+         glm::vec2(300.0f, 100.0f) + GetStackOffset(1, modded.circleRadius));
+}
+
+TEST(StackOffsetIsAppliedAfterTheHardRockFlip) {
+  test::TempDirectory dir("stacking_hr");
+  for (int formatVersion : {5, 14}) {
+    Beatmap map(WriteStackMap(dir.path, formatVersion));
+    ModdedBeatmap modded(map, static_cast<int32_t>(Mod::HARD_ROCK));
+    EXPECT_EQ(modded.stackHeights[0], 2);
+    // Flipped to y = 284, then still moved up and left.
+    EXPECT(modded.positions[0] ==
+           glm::vec2(100.0f, 284.0f) +
+               GetStackOffset(2, modded.circleRadius));
+    EXPECT(modded.positions[0].y < 284.0f);
+  }
+}
+
+}  // namespace osrp
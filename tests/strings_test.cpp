@@ -0,0 +1,81 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "replay.hpp"
+#include "strings.hpp"
+#include "test.hpp"
+
+namespace osrp {
+
+namespace {
+// Whether ParseString<float> gives exactly the float std::stof gives.
+bool MatchesStof(const std::string& text) {
+  auto parsed = ParseString<float>(text);
+  if (!parsed) return false;
+  float expected = std::stof(text);
+  float actual = parsed.Value();
+  return std::memcmp(&expected, &actual, sizeof(float)) == 0;
+}
+}  // namespace
+
+TEST(ParseDecimalMatchesStofOnReplayFrames) {
+  auto text = ReadReplayFrameText("res/magma/wc_replay.osr");
+  size_t tokens = 0, mismatches = 0;
+  Split(text, ',', [&](std::string_view frame) {
+    int field = 0;
+    Split(frame, '|', [&](std::string_view token) {
+      // x and y are the float fields.
+      if ((field == 1 || field == 2) && !token.empty()) {
+        tokens++;
+        if (!MatchesStof(std::string(token))) mismatches++;
+      }
+      field++;
+    });
+  });
+  EXPECT(tokens > 1000);
+  EXPECT_EQ(mismatches, size_t{0});
+}
+
+TEST(ParseDecimalMatchesStofOnGeneratedNotations) {
+  // Fixed LCG so every run checks the same values.
+  uint64_t state = 42;
+  auto next = [&]() {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    return state >> 11;
+  };
+  char buffer[64];
+  size_t mismatches = 0;
+  for (int i = 0; i < 200000; i++) {
+    double magnitude = std::pow(10.0, static_cast<int>(next() % 14) - 7);
+    double value = (next() / 9007199254740992.0 - 0.5) * magnitude;
+    int precision = 1 + next() % 9;
+    // Fixed notation like osu! writes positions, and .NET style exponents
+    // such as "1.525879E-05".
+    const char* format = i % 2 ? "%.*f" : "%.*E";
+    std::snprintf(buffer, sizeof(buffer), format, precision, value);
+    if (!MatchesStof(buffer)) {
+      if (mismatches++ < 5) std::cerr << "mismatch: " << buffer << std::endl;
+    }
+  }
+  EXPECT_EQ(mismatches, size_t{0});
+}
+
+TEST(ParseDecimalSaturatesHugeExponents) {
+  double value = 0.0;
+  EXPECT(ParseDecimal("1e2147483647", value));
+  EXPECT(std::isinf(value));
+  EXPECT(ParseDecimal("1e99999999999999999999", value));
+  EXPECT(std::isinf(value));
+  EXPECT(ParseDecimal("-1e-99999999999999999999", value));
+  EXPECT_EQ(value, 0.0);
+  EXPECT(ParseDecimal("0e400", value));
+  EXPECT_EQ(value, 0.0);
+  EXPECT(ParseDecimal("12.5", value));
+  EXPECT_EQ(value, 12.5);
+  EXPECT(!ParseDecimal("1e", value));
+  EXPECT(!ParseDecimal("1.5x", value));
+}
+
+}  // namespace osrp
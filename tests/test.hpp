@@ -0,0 +1,74 @@
+#pragma once
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace osrp::test {
+
+namespace fs = std::filesystem;
+
+struct TestCase {
+  const char* name;
+  void (*func)();
+};
+
+inline std::vector<TestCase>& GetTests() {
+  static std::vector<TestCase> tests;
+  return tests;
+}
+
+inline int& GetFailureCount() {
+  static int failures = 0;
+  return failures;
+}
+
+struct Registration {
+  Registration(const char* name, void (*func)()) {
+    GetTests().push_back(TestCase{name, func});
+  }
+};
+
+// Fresh directory under the system temp directory, removed on destruction.
+struct TempDirectory {
+  fs::path path;
+
+  explicit TempDirectory(const std::string& name)
+      : path(fs::temp_directory_path() / ("osu_replay_tests_" + name)) {
+    fs::remove_all(path);
+    fs::create_directories(path);
+  }
+  ~TempDirectory() {
+    std::error_code err;
+    fs::remove_all(path, err);
+  }
+};
+
+}  // namespace osrp::test
+
+#define TEST(name)                                                   \
+  static void name();                                                \
+  static ::osrp::test::Registration name##Registration(#name, name); \
+  static void name()
+
+#define EXPECT(condition)                                              \
+  do {                                                                 \
+    if (!(condition)) {                                                \
+      ++::osrp::test::GetFailureCount();                               \
+      std::cerr << __FILE__ << ':' << __LINE__ << ": expected " #condition \
+                << std::endl;                                          \
+    }                                                                  \
+  } while (false)
+
+#define EXPECT_EQ(a, b)                                                  \
+  do {                                                                   \
+    auto&& expectA = (a);                                                \
+    auto&& expectB = (b);                                                \
+    if (!(expectA == expectB)) {                                         \
+      ++::osrp::test::GetFailureCount();                                 \
+      std::cerr << __FILE__ << ':' << __LINE__ << ": expected " #a " == " #b \
+                << ", got " << expectA << " and " << expectB << std::endl; \
+    }                                                                    \
+  } while (false)
@@ -0,0 +1,30 @@
+#include <exception>
+#include <iostream>
+#include <string_view>
+
+#include "test.hpp"
+
+// Runs every registered test, or those whose name contains argv[1].
+int main(int argc, char** argv) {
+  std::string_view filter = argc > 1 ? argv[1] : "";
+  size_t run = 0;
+  for (const auto& test : osrp::test::GetTests()) {
+    if (std::string_view(test.name).find(filter) == std::string_view::npos) {
+      continue;
+    }
+    int failuresBefore = osrp::test::GetFailureCount();
+    try {
+      test.func();
+    } catch (const std::exception& e) {
+      ++osrp::test::GetFailureCount();
+      std::cerr << test.name << ": uncaught exception: " << e.what()
+                << std::endl;
+    }
+    bool passed = osrp::test::GetFailureCount() == failuresBefore;
+    std::cout << (passed ? "[ OK ] " : "[FAIL] ") << test.name << std::endl;
+    run++;
+  }
+  std::cout << run << " tests, " << osrp::test::GetFailureCount()
+            << " failed expectations" << std::endl;
+  return osrp::test::GetFailureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "test.hpp"
+#include "thread_pool.hpp"
+
+namespace osrp {
+
+TEST(ParallelForRunsEveryIndex) {
+  ThreadPool pool(4);
+  std::atomic<size_t> sum{0};
+  ParallelFor(pool, 1000, [&](size_t i) { sum += i; });
+  EXPECT_EQ(sum.load(), size_t{999 * 1000 / 2});
+}
+
+TEST(ParallelForRethrowsTaskExceptions) {
+  ThreadPool pool(4);
+  std::atomic<size_t> ran{0};
+  bool caught = false;
+  try {
+    ParallelFor(pool, 100, [&](size_t i) {
+      ran++;
+      if (i == 42) throw std::runtime_error("task failed");
+    });
+  } catch (const std::runtime_error&) {
+    caught = true;
+  }
+  EXPECT(caught);
+  EXPECT_EQ(ran.load(), size_t{100});
+
+  // The error is reported once; the pool stays usable.
+  ParallelFor(pool, 10, [&](size_t) { ran++; });
+  EXPECT_EQ(ran.load(), size_t{110});
+}
+
+TEST(ThreadPoolRunsQueuedTasksInSubmissionOrder) {
+  ThreadPool pool(1);
+  // Hold the only worker so every task below is queued before any runs.
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  pool.Submit([released]() { released.wait(); });
+  std::vector<size_t> order;
+  for (size_t i = 0; i < 8; i++) {
+    pool.Submit([&order, i]() { order.push_back(i); });
+  }
+  release.set_value();
+  pool.Wait();
+  EXPECT((order == std::vector<size_t>{0, 1, 2, 3, 4, 5, 6, 7}));
+}
+
+TEST(ThreadPoolRejectsWaitsFromItsTasks) {
+  ThreadPool pool(2);
+  size_t caught = 0;
+  try {
+    ParallelFor(pool, 2, [&](size_t) { pool.Wait(); });
+  } catch (const std::logic_error&) {
+    caught++;
+  }
+  try {
+    ParallelFor(pool, 2, [&](size_t) { ParallelFor(pool, 4, [](size_t) {}); });
+  } catch (const std::logic_error&) {
+    caught++;
+  }
+  EXPECT_EQ(caught, size_t{2});
+}
+
+}  // namespace osrp
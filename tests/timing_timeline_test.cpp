@@ -0,0 +1,78 @@
+#include <random>
+#include <vector>
+
+#include "test.hpp"
+#include "timing_timeline.hpp"
+
+namespace osrp {
+
+namespace {
+TimingPoint Uninherited(double time, double beatLength, int32_t meter) {
+  return {time, beatLength, meter, 1, 0, 100, true, 0};
+}
+
+TimingPoint Inherited(double time, double velocity) {
+  return {time, -100.0 / velocity, 4, 1, 0, 100, false, 0};
+}
+}  // namespace
+
+TEST(TimingTimelineMergesInheritedBeforeUninheritedAtSameTime) {
+  TimingTimeline timeline({Inherited(0.0, 2.0), Uninherited(0.0, 300.0, 4),
+                           Uninherited(1000.0, 400.0, 3)});
+  EXPECT_EQ(timeline.size(), size_t{2});
+  const auto& state = timeline.At(500.0);
+  EXPECT_EQ(state.beatLength, 300.0);
+  EXPECT_EQ(state.beatOffset, 0.0);
+  EXPECT_EQ(state.meter, 4);
+  // The inherited point at the same time keeps its velocity.
+  EXPECT_EQ(state.sliderVelocity, 2.0);
+  EXPECT_EQ(timeline.At(1500.0).beatLength, 400.0);
+  EXPECT_EQ(timeline.At(1500.0).sliderVelocity, 1.0);
+}
+
+TEST(TimingTimelineLeadInUsesFirstUninheritedPoint) {
+  TimingTimeline timeline({Inherited(100.0, 0.5), Inherited(200.0, 1.5),
+                           Uninherited(1000.0, 250.0, 7),
+                           Uninherited(2000.0, 600.0, 3)});
+  for (double time : {-500.0, 100.0, 250.0, 999.0}) {
+    const auto& state = timeline.At(time);
+    EXPECT_EQ(state.beatLength, 250.0);
+    EXPECT_EQ(state.beatOffset, 1000.0);
+    EXPECT_EQ(state.meter, 7);
+  }
+  EXPECT_EQ(timeline.At(-500.0).sliderVelocity, 0.5);
+  EXPECT_EQ(timeline.At(250.0).sliderVelocity, 1.5);
+  EXPECT_EQ(timeline.At(1000.0).sliderVelocity, 1.0);
+  EXPECT_EQ(timeline.At(2500.0).beatLength, 600.0);
+
+  TimingTimeline empty(std::vector<TimingPoint>{});
+  EXPECT_EQ(empty.size(), size_t{1});
+  EXPECT_EQ(empty.At(1000.0).beatLength, 500.0);
+}
+
+TEST(TimingCursorMatchesAt) {
+  std::mt19937 rng(9);
+  std::vector<TimingPoint> points;
+  double time = 0.0;
+  for (int i = 0; i < 300; i++) {
+    // Several points may share a time.
+    time += rng() % 4 == 0 ? 0.0 : rng() % 2000;
+    points.push_back(rng() % 3 == 0
+                         ? Uninherited(time, 200.0 + rng() % 400, 3 + rng() % 2)
+                         : Inherited(time, 0.5 + (rng() % 20) / 10.0));
+  }
+  TimingTimeline timeline(points);
+  TimingCursor cursor(timeline);
+  size_t mismatches = 0;
+  // Forward walks with small and large steps, then random seeks.
+  for (int query = 0; query < 20000; query++) {
+    double seek = query < 10000 ? query * time / 10000.0 - 100.0
+                                : static_cast<double>(rng() % 700000) - 1000.0;
+    const auto& state = cursor.Seek(seek);
+    mismatches += &state != &timeline.At(seek);
+    mismatches += cursor.GetIndex() != timeline.Find(seek);
+  }
+  EXPECT_EQ(mismatches, size_t{0});
+}
+
+}  // namespace osrp